@@ -61,6 +61,10 @@ struct config_parse_error : config_error {
     using config_error::config_error;
 };
 
+/// Extracts the seqno from the start of a serialized config message without parsing the rest of
+/// the message.  Returns nullopt if the message does not start with a valid "#" seqno.
+std::optional<seqno_t> peek_seqno(ustring_view serialized);
+
 /// Class for a parsed, read-only config message; also serves as the base class of a
 /// MutableConfigMessage which allows setting values.
 class ConfigMessage {
@@ -89,6 +93,11 @@ class ConfigMessage {
 
     bool verified_signature_ = false;
 
+    // The signature this message was loaded with (empty if unsigned or not loaded from serialized
+    // data).  Re-serializing an unmodified message reuses it so that the serialized message (and
+    // thus its hash) is unchanged.
+    ustring signature_;
+
     // This will be set during construction from configs based on the merge result:
     // -1 means we had to merge one or more configs together into a new merged config
     // >= 0 indicates the index of the config we used if we did not merge (i.e. there was only one
@@ -151,6 +160,11 @@ class ConfigMessage {
     /// set, thus allowing unsigned messages (though messages with an invalid signature are still
     /// not allowed).  This option is ignored when verifier is not set.
     ///
+    /// trust_first - if true then the first message of `configs` is exempt from signature
+    /// verification, and may be unsigned even when a verifier is set.  This is intended for the
+    /// caller's own current config, re-serialized to be merged with incoming messages, which may
+    /// not be signed (e.g. if the caller can verify but not sign) and has no need to be verified.
+    ///
     /// error_handler - if set then any config message parsing error will be passed to this function
     /// for handling with the index of `configs` that failed and the error exception: the callback
     /// typically warns and, if the overall construction should abort, rethrows the error.  If this
@@ -158,13 +172,19 @@ class ConfigMessage {
     /// only aborts construction if *all* messages fail to parse.  A simple handler such as
     /// `[](size_t, const auto& e) { throw e; }` can be used to make any parse error of any message
     /// fatal.
+    ///
+    /// Messages are parsed in descending seqno order (as determined by a cheap peek at the leading
+    /// seqno), and messages that are too old or redundant given an already-parsed message are
+    /// dropped without being parsed at all; such messages are never passed to `error_handler`,
+    /// even if they are invalid.
     explicit ConfigMessage(
             const std::vector<ustring_view>& configs,
             verify_callable verifier = nullptr,
             sign_callable signer = nullptr,
             int lag = DEFAULT_DIFF_LAGS,
             bool signature_optional = false,
-            std::function<void(size_t, const config_error&)> error_handler = nullptr);
+            std::function<void(size_t, const config_error&)> error_handler = nullptr,
+            bool trust_first = false);
 
     /// Returns a read-only reference to the contained data.  (To get a mutable config object use
     /// MutableConfigMessage).
@@ -186,6 +206,12 @@ class ConfigMessage {
     /// mergeable.
     int lag = DEFAULT_DIFF_LAGS;
 
+    /// If positive and less than `lag` then serializing only includes this many lagged config diffs
+    /// (including this message).  The lagged diffs of the full `lag` are still retained (and
+    /// carried forward into messages derived from this one), so that a later message can include
+    /// them again.
+    int serialized_lag = 0;
+
     /// The diff structure for changes in *this* config message.  Subclasses that need to override
     /// should populate into `diff_` and return a reference to it (internal code assumes `diff_` is
     /// correct immediately after a call to this).
@@ -216,6 +242,17 @@ class ConfigMessage {
     /// verification function; or had no signature and a signature wasn't required).
     bool verified_signature() const { return verified_signature_; }
 
+    /// Returns the total serialized size of the lagged diffs that `serialize()` leaves out because
+    /// of a `serialized_lag` value smaller than `lag`.
+    size_t omitted_lags_size() const;
+
+    /// Returns true if leaving out the lagged diffs that `serialize()` omits because of
+    /// `serialized_lag` can't change the result of merging this message with any others: that is,
+    /// if every change in an omitted diff is made again by a newer diff that is included (or by
+    /// this message's own diff).  Always true if nothing is omitted.  For a mutable message,
+    /// `diff()` must have been called since the last change.
+    bool omitted_lags_overridden() const;
+
     /// Constructs a new MutableConfigMessage from this config message with an incremented seqno.
     /// The new config message's diff will reflect changes made after this construction.
     virtual MutableConfigMessage increment() const;
@@ -228,8 +265,20 @@ class ConfigMessage {
     /// typically for a local serialization value that isn't being pushed to the server).  Note that
     /// signing is always disabled if there is no signing callback set, regardless of the value of
     /// this argument.
+    ///
+    /// A message that was loaded with a signature, and not modified since, is serialized with that
+    /// same signature rather than being signed again (regardless of `enable_signing`): this keeps
+    /// the serialized value identical to the original even when signing is non-deterministic (as
+    /// with XEd25519), or when we are only able to verify and not sign.
     virtual ustring serialize(bool enable_signing = true);
 
+    /// Same as `serialize()`, but takes the diff as already obtained from `diff()` rather than
+    /// calling `diff()` itself (which, for a mutable message, recomputes it).  This lets the caller
+    /// separate the cost of computing the diff from the cost of the serialization.
+    ustring serialize(const oxenc::bt_dict& curr_diff, bool enable_signing = true) {
+        return serialize_impl(curr_diff, enable_signing);
+    }
+
   protected:
     ustring serialize_impl(const oxenc::bt_dict& diff, bool enable_signing = true);
 };
@@ -284,7 +333,8 @@ class MutableConfigMessage : public ConfigMessage {
             sign_callable signer = nullptr,
             int lag = DEFAULT_DIFF_LAGS,
             bool signature_optional = false,
-            std::function<void(size_t, const config_error&)> error_handler = nullptr);
+            std::function<void(size_t, const config_error&)> error_handler = nullptr,
+            bool trust_first = false);
 
     /// Wrapper around the above that takes a single string view to load a single message, doesn't
     /// take an error handler and instead always throws on parse errors (the above also throws for
@@ -62,7 +62,8 @@ typedef enum config_log_level {
 ///
 /// Can be called with callback set to NULL to clear an existing logger.
 ///
-/// The config object itself has no log level: the caller should filter by level as needed.
+/// Messages below the config object's minimum log level (see `config_set_log_level`; by default
+/// all messages are logged) are discarded without invoking the callback.
 ///
 /// Declaration:
 /// ```cpp
@@ -80,6 +81,25 @@ typedef enum config_log_level {
 LIBSESSION_EXPORT void config_set_logger(
         config_object* conf, void (*callback)(config_log_level, const char*, void*), void* ctx);
 
+/// API: base/config_set_log_level
+///
+/// Sets the minimum level of log messages passed to the logger set with `config_set_logger`.
+/// Messages below this level are discarded before they are even formatted, making disabled log
+/// statements essentially free.  The default level is LOG_LEVEL_DEBUG (i.e. everything is logged).
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_set_log_level(
+///     [in, out]   config_object*      conf,
+///     [in]        config_log_level    level
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+/// - `level` -- [in] the minimum level to log
+LIBSESSION_EXPORT void config_set_log_level(config_object* conf, config_log_level level);
+
 /// API: base/config_storage_namespace
 ///
 /// Returns the numeric namespace in which config messages of this type should be stored.
@@ -205,6 +225,126 @@ LIBSESSION_EXPORT config_push_data* config_push(config_object* conf);
 LIBSESSION_EXPORT void config_confirm_pushed(
         config_object* conf, seqno_t seqno, const char* msg_hash);
 
+/// API: base/config_set_executor
+///
+/// Sets the executor used to run the asynchronous operations (`config_merge_async` and
+/// `config_push_async`) of this config object.  When an operation needs to run, the library calls
+/// `executor(run, task, ctx)`; the executor must then arrange for `run(task)` to be called exactly
+/// once, on any thread of its choosing (e.g. by posting it to an application thread pool).
+///
+/// By default (or if `executor` is NULL) asynchronous operations run on a single background thread
+/// managed by the library.  However they are executed, the asynchronous operations of one config
+/// object are always run one at a time, in the order they were requested.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_set_executor(
+///     [in, out]   config_object*                                      conf,
+///     [in]        void(*)(void(*)(void*), void*, void*)               executor,
+///     [in]        void*                                               ctx
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in, out] Pointer to config_object object
+/// - `executor` -- [in] Executor function, or NULL to use the library's background thread
+/// - `ctx` -- [in, optional] Pointer to an optional context passed to `executor`.  Set to NULL if
+///   unused
+LIBSESSION_EXPORT void config_set_executor(
+        config_object* conf,
+        void (*executor)(void (*run)(void* task), void* task, void* ctx),
+        void* ctx);
+
+/// API: base/config_merge_async
+///
+/// Asynchronous version of `config_merge`: the message data is copied and the merge is queued to
+/// run on the executor (see `config_set_executor`), after which `callback` is invoked (on the
+/// executor thread) with the config object, the number of merged messages, an error string (NULL
+/// on success), and the given `ctx` pointer.  On error (or if the operation is cancelled because
+/// the object is freed) the merged count is -1; the error string is only valid for the duration
+/// of the callback.
+///
+/// While any asynchronous operation is outstanding the caller must not use the config object other
+/// than to queue further asynchronous operations or to call `config_wait_async`.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_merge_async(
+///     [in, out]   config_object*                                          conf,
+///     [in]        const char**                                            msg_hashes,
+///     [in]        const unsigned char**                                   configs,
+///     [in]        const size_t*                                           lengths,
+///     [in]        size_t                                                  count,
+///     [in]        void(*)(config_object*, int, const char*, void*)        callback,
+///     [in]        void*                                                   ctx
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in, out] Pointer to config_object object
+/// - `msg_hashes` -- [in] is an array of null-terminated C strings containing the hashes of the
+/// configs being provided.
+/// - `configs` -- [in] is an array of pointers to the start of the (binary) data.
+/// - `lengths` -- [in] is an array of lengths of the binary data
+/// - `count` -- [in] is the length of all three arrays.
+/// - `callback` -- [in] completion callback
+/// - `ctx` -- [in, optional] Pointer passed to the callback.  Set to NULL if unused
+LIBSESSION_EXPORT void config_merge_async(
+        config_object* conf,
+        const char** msg_hashes,
+        const unsigned char** configs,
+        const size_t* lengths,
+        size_t count,
+        void (*callback)(config_object* conf, int merged, const char* error, void* ctx),
+        void* ctx);
+
+/// API: base/config_push_async
+///
+/// Asynchronous version of `config_push`: the push is queued to run on the executor, after which
+/// `callback` is invoked (on the executor thread) with the config object, the push data (as would
+/// be returned by `config_push`, and which the callback must `free()`), an error string, and the
+/// given `ctx` pointer.
+///
+/// If an earlier push is still queued (i.e. has not started) when this is called then the earlier
+/// push is cancelled: its callback is invoked with NULL push data and an error string.  The push
+/// data is likewise NULL if the push fails or is cancelled because the object is freed.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_push_async(
+///     [in, out]   config_object*                                                      conf,
+///     [in]        void(*)(config_object*, config_push_data*, const char*, void*)      callback,
+///     [in]        void*                                                               ctx
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in, out] Pointer to config_object object
+/// - `callback` -- [in] completion callback
+/// - `ctx` -- [in, optional] Pointer passed to the callback.  Set to NULL if unused
+LIBSESSION_EXPORT void config_push_async(
+        config_object* conf,
+        void (*callback)(
+                config_object* conf, config_push_data* push, const char* error, void* ctx),
+        void* ctx);
+
+/// API: base/config_wait_async
+///
+/// Blocks until all queued asynchronous operations of the config object have completed.  Must not
+/// be called from within a completion callback.  This should be called before `config_free` if
+/// there may be asynchronous operations still running.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_wait_async(
+///     [in, out]   config_object*      conf
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+LIBSESSION_EXPORT void config_wait_async(config_object* conf);
+
 /// API: base/config_dump
 ///
 /// Returns a binary dump of the current state of the config object.  This dump can be used to
@@ -427,6 +567,172 @@ LIBSESSION_EXPORT bool config_has_key(const config_object* conf, const unsigned
 /// - `unsigned char*` -- binary data of the key, exactly 32 bytes and is not null terminated
 LIBSESSION_EXPORT const unsigned char* config_key(const config_object* conf, size_t i);
 
+/// API: base/config_set_sig_keys
+///
+/// Sets an Ed25519 signing key: outgoing messages get signed with it, and incoming messages must
+/// be signed by it.  Replaces any existing signing key or signature pubkey.  See
+/// `ConfigBase::set_sig_keys` for details.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_set_sig_keys(
+///     [in, out]       config_object*          conf,
+///     [in]            const unsigned char*    secret
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in, out] Pointer to config_object object
+/// - `secret` -- [in] Pointer to the 64-byte Ed25519 secret key
+LIBSESSION_EXPORT void config_set_sig_keys(config_object* conf, const unsigned char* secret);
+
+/// API: base/config_set_xed25519_sig_keys
+///
+/// Same as `config_set_sig_keys`, but for an X25519 private key, with messages signed and verified
+/// using XEd25519.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_set_xed25519_sig_keys(
+///     [in, out]       config_object*          conf,
+///     [in]            const unsigned char*    x25519_privkey
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in, out] Pointer to config_object object
+/// - `x25519_privkey` -- [in] Pointer to the 32-byte X25519 private key
+LIBSESSION_EXPORT void config_set_xed25519_sig_keys(
+        config_object* conf, const unsigned char* x25519_privkey);
+
+/// API: base/config_set_sig_pubkey
+///
+/// Sets an Ed25519 pubkey that incoming messages must be signed by, without a signing key, making
+/// the object read-only.  Replaces any existing signing key or signature pubkey.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_set_sig_pubkey(
+///     [in, out]       config_object*          conf,
+///     [in]            const unsigned char*    pubkey
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in, out] Pointer to config_object object
+/// - `pubkey` -- [in] Pointer to the 32-byte Ed25519 pubkey
+LIBSESSION_EXPORT void config_set_sig_pubkey(config_object* conf, const unsigned char* pubkey);
+
+/// API: base/config_set_xed25519_sig_pubkey
+///
+/// Same as `config_set_sig_pubkey`, but for the X25519 pubkey of an XEd25519 signer.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_set_xed25519_sig_pubkey(
+///     [in, out]       config_object*          conf,
+///     [in]            const unsigned char*    x25519_pubkey
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in, out] Pointer to config_object object
+/// - `x25519_pubkey` -- [in] Pointer to the 32-byte X25519 pubkey
+LIBSESSION_EXPORT void config_set_xed25519_sig_pubkey(
+        config_object* conf, const unsigned char* x25519_pubkey);
+
+/// API: base/config_clear_sig_keys
+///
+/// Removes any signing key and signature pubkey, so that messages are neither signed nor verified.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_clear_sig_keys(
+///     [in, out]       config_object*          conf
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in, out] Pointer to config_object object
+LIBSESSION_EXPORT void config_clear_sig_keys(config_object* conf);
+
+/// API: base/config_get_sig_pubkey
+///
+/// Retrieves the Ed25519 pubkey that messages are signed and verified with, if set.
+///
+/// Declaration:
+/// ```cpp
+/// BOOL config_get_sig_pubkey(
+///     [in]            const config_object*    conf,
+///     [out]           unsigned char*          pubkey
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+/// - `pubkey` -- [out] Pointer to a 32-byte buffer that is set to the pubkey, if set
+///
+/// Outputs:
+/// - `bool` -- True if a pubkey is set (and was written to `pubkey`), false otherwise
+LIBSESSION_EXPORT bool config_get_sig_pubkey(const config_object* conf, unsigned char* pubkey);
+
+/// API: base/config_is_readonly
+///
+/// Returns true if the object has a signature pubkey but no signing key, and so cannot push.
+///
+/// Declaration:
+/// ```cpp
+/// BOOL config_is_readonly(
+///     [in]            const config_object*    conf
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+///
+/// Outputs:
+/// - `bool` -- True if the object is read-only
+LIBSESSION_EXPORT bool config_is_readonly(const config_object* conf);
+
+/// API: base/config_set_adaptive_lags
+///
+/// Enables or disables adaptive lags (disabled by default).  When enabled, the number of lagged
+/// diffs carried in pushed messages is gradually lowered while no other client is seen updating
+/// the config, and restored to the full amount as soon as one is (or a conflict has to be
+/// resolved).  See `ConfigBase::set_adaptive_lags` for details.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_set_adaptive_lags(
+///     [in]    config_object*  conf,
+///     [in]    bool            enabled
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+/// - `enabled` -- [in] true to enable adaptive lags, false to disable them
+LIBSESSION_EXPORT void config_set_adaptive_lags(config_object* conf, bool enabled);
+
+/// API: base/config_carried_lags
+///
+/// Returns the number of config lags that will be carried in the next new message pushed.  This is
+/// always the config type's full number of lags unless adaptive lags are enabled.
+///
+/// Declaration:
+/// ```cpp
+/// INT config_carried_lags(
+///     [in]    const config_object*    conf
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+///
+/// Outputs:
+/// - `int` -- the number of lags to be carried
+LIBSESSION_EXPORT int config_carried_lags(const config_object* conf);
+
 /// API: base/config_encryption_domain
 ///
 /// Returns the encryption domain C-str used to encrypt values for this config object.  (This is
@@ -1,14 +1,23 @@
 #pragma once
 
 #include <cassert>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
+#include <optional>
 #include <session/config.hpp>
+#include <stdexcept>
 #include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 #include <variant>
 #include <vector>
 
 #include "base.h"
+#include "encrypt.hpp"
+#include "metrics.hpp"
 #include "namespaces.hpp"
 
 namespace session::config {
@@ -28,6 +37,13 @@ static constexpr bool is_dict_value =
 // Levels for the logging callback
 enum class LogLevel { debug = 0, info, warning, error };
 
+/// Exception delivered (via the returned future or the completion callback) to an asynchronous
+/// operation that was cancelled before it started: either a `push_async()` superseded by a newer
+/// `push_async()` call, or any operation still queued when the config object is destroyed.
+struct async_cancelled : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
 /// Our current config state
 enum class ConfigState : int {
     /// Clean means the config is confirmed stored on the server and we haven't changed anything.
@@ -65,6 +81,10 @@ class ConfigBase {
     size_t _keys_size = 0;
     size_t _keys_capacity = 0;
 
+    // Encryption keys derived from `_keys` (identified by index) for the message sizes we have
+    // recently encrypted or decrypted.  Cleared whenever the key list changes.
+    derived_key_cache _key_cache;
+
     // Contains the current active message hash, as fed into us in `confirm_pushed()`.  Empty if we
     // don't know it yet.  When we dirty the config this value gets moved into `old_hashes_` to be
     // removed by the next push.
@@ -74,6 +94,95 @@ class ConfigBase {
     // these are returned (and cleared) when `push` is called.
     std::unordered_set<std::string> _old_hashes;
 
+    // Maximum number of entries in `_processed`.
+    static constexpr size_t PROCESSED_HASHES_LIMIT = 256;
+
+    // Hashes of incoming messages that `merge()` has successfully decrypted and parsed (along with
+    // the seqno of each), so that merge can skip them without decrypting or parsing them again
+    // when they are passed in again by later polls.  `_processed_order` holds the same hashes in
+    // insertion order so that the oldest get evicted once we reach PROCESSED_HASHES_LIMIT.  These
+    // are persisted in the dump.
+    std::unordered_map<std::string, seqno_t> _processed;
+    std::deque<std::string> _processed_order;
+
+    // Adds a hash to `_processed`, evicting the oldest entry if at the limit.
+    void add_processed(std::string hash, seqno_t seqno);
+
+    // Empties `_processed`; called when the signing or encryption keys change so that previously
+    // processed messages get checked again under the new keys.
+    void clear_processed();
+
+    // Incremented whenever the config data may have changed, i.e. on every `dirty()` access and
+    // whenever a merge replaces the current config message.
+    uint64_t _data_version = 0;
+
+    // The most recently published read-only snapshot of this config (see `publish()`).  This is
+    // only accessed via std::atomic_load/std::atomic_store so that other threads can obtain it
+    // without locking.
+    std::shared_ptr<const ConfigBase> _snapshot;
+
+    // The `_data_version` value when `_snapshot` was published
+    std::optional<uint64_t> _snapshot_version;
+
+    // Set by the first `publish()` call, after which `merge()` and `push()` publish automatically.
+    // Until then we don't pay for snapshots (a full copy of the config data) that nobody uses.
+    bool _publishing = false;
+
+    // Performance metrics of merge/push/dump operations
+    metrics_registry _metrics;
+
+    // Adaptive lag state (see `set_adaptive_lags()`): the number of lags carried in the messages we
+    // push (0 means the full `config_lags()`), and the number of pushes since it last changed.  The
+    // diffs left out of pushed messages are still kept in `_config` (see
+    // `ConfigMessage::serialized_lag`).
+    // This isn't persisted in the dump, so a reloaded object starts out carrying the full lags.
+    bool _adaptive_lags = false;
+    int _carried_lags = 0;
+    int _quiet_pushes = 0;
+
+    // Returns to carrying the full `config_lags()`; called when merge sees another client's update.
+    void raise_lags() {
+        _carried_lags = 0;
+        _quiet_pushes = 0;
+    }
+
+    // Serializes the current config message, recording the diff and serialization times.
+    ustring serialize_config(bool enable_signing = true);
+
+    // Compresses (if enabled and smaller), pads, and encrypts a serialized config message into a
+    // single pre-sized buffer, returning the encrypted message to push.
+    ustring build_push_message(ustring_view serialized);
+
+    // Signing keys, verification pubkey, and signature caches used for signed configs; null unless
+    // signing keys or a signature pubkey have been set (see `set_sig_keys()`, etc.).
+    struct sig_state;
+    std::unique_ptr<sig_state> _sig;
+
+    // Returns the signing and verification functions to give to config messages: these sign with
+    // and verify against `_sig`, or are nullptr if it has no signing key or pubkey, respectively.
+    ConfigMessage::sign_callable message_signer();
+    ConfigMessage::verify_callable message_verifier();
+
+    // Updates the signing and verification functions of the current config message after a change
+    // to the signing keys (and clears the processed message cache).
+    void update_sig_callbacks();
+
+    // Queue and executor state for the `*_async` methods; created on first use.  This is shared
+    // with the tasks given to the executor so that it remains valid even if a task only gets run
+    // after this object has been destroyed.
+    struct async_state;
+    std::shared_ptr<async_state> _async;
+
+    // Queues an asynchronous operation, starting the queue on the executor if not already running.
+    // The operation is invoked with nullptr to run it, or with the reason if it gets cancelled
+    // instead.  If `push` is true then any not-yet-started push already in the queue is cancelled.
+    // Throws std::logic_error if this object isn't an `async_config`.
+    void queue_async(bool push, std::function<void(const char* cancelled)> op);
+
+    // Overridden by `async_config` (which cancels asynchronous operations on destruction) to
+    // return true; asynchronous operations can't be queued on any other object.
+    virtual bool cancels_async() const { return false; }
+
   protected:
     // Constructs a base config by loading the data from a dump as produced by `dump()`.  If the
     // dump is nullopt then an empty base config is constructed with no config settings and seqno
@@ -89,16 +198,60 @@ class ConfigBase {
     // deleted at the next push.
     void set_state(ConfigState s);
 
-    // Invokes the `logger` callback if set, does nothing if there is no logger.
+    // Returns true if a message at the given level would be logged, i.e. if there is a logger and
+    // the level is not below `log_level`.
+    bool log_enabled(LogLevel lvl) const { return logger && lvl >= log_level; }
+
+    // Invokes the `logger` callback if set and `lvl` is not filtered out by `log_level`; does
+    // nothing otherwise.
     void log(LogLevel lvl, std::string msg) {
-        if (logger)
+        if (log_enabled(lvl))
             logger(lvl, std::move(msg));
     }
+    void log(LogLevel lvl, const char* msg) {
+        if (log_enabled(lvl))
+            logger(lvl, msg);
+    }
+
+    // Lazy version of the above: `make_msg` is a callable returning the message string, and is
+    // only invoked if the message will actually be logged, so that a disabled log statement costs
+    // nothing more than a branch.  For example:
+    //
+    //     log(LogLevel::debug, [&] { return "merged " + std::to_string(n) + " messages"; });
+    template <typename MakeMsg, typename = std::enable_if_t<std::is_invocable_v<MakeMsg&>>>
+    void log(LogLevel lvl, MakeMsg&& make_msg) {
+        if (log_enabled(lvl))
+            logger(lvl, std::string{make_msg()});
+    }
 
     // Returns a reference to the current MutableConfigMessage.  If the current message is not
     // already dirty (i.e. Clean or Waiting) then calling this increments the seqno counter.
     MutableConfigMessage& dirty();
 
+    // Returns a counter that changes whenever the config data may have been modified.  Subclasses
+    // that maintain auxiliary indices of the config data can compare against this to detect
+    // changes they did not make themselves (such as a merge, or direct writes to `data`).
+    uint64_t data_version() const { return _data_version; }
+
+    struct snapshot_t {};
+    static constexpr inline snapshot_t snapshot_tag{};
+
+    // Constructs a read-only copy of `other`'s current config data and state, for use as a
+    // published snapshot.  The copy has no encryption keys (and so cannot merge or push).
+    ConfigBase(const ConfigBase& other, snapshot_t);
+
+    // Subclasses must implement this to return a new snapshot copy of the object, i.e. a new
+    // instance of the subclass constructed with the `snapshot_t` constructor.  Any lazily computed
+    // state that const accessors rely on must be computed when constructing the copy, as snapshots
+    // are accessed concurrently from multiple threads.
+    virtual std::shared_ptr<const ConfigBase> make_snapshot() const = 0;
+
+    // Cancels any queued asynchronous operations that have not yet started, and waits for one that
+    // is currently running to finish (unless called from that operation's own thread, i.e. from
+    // its completion callback).  Called by the `async_config` destructor, before any of the
+    // config object is destroyed.
+    void cancel_async();
+
   public:
     // class for proxying subfield access; this class should never be stored but only used
     // ephemerally (most of its methods are rvalue-qualified).  This lets constructs such as
@@ -690,6 +843,10 @@ class ConfigBase {
     // If set then we log things by calling this callback
     std::function<void(LogLevel lvl, std::string msg)> logger;
 
+    // The minimum level of messages passed to `logger`; messages below this level are discarded
+    // without being formatted.  Defaults to `debug`, i.e. everything is logged.
+    LogLevel log_level = LogLevel::debug;
+
     /// API: base/ConfigBase::storage_namespace
     ///
     /// Accesses the storage namespace where this config type is to be stored/loaded from.  See
@@ -739,6 +896,121 @@ class ConfigBase {
     /// - `int` -- Returns how many config lags
     virtual int config_lags() const { return 5; }
 
+    /// API: base/ConfigBase::min_config_lags
+    ///
+    /// The fewest config lags that adaptive lags (see `set_adaptive_lags()`) will lower the lags
+    /// carried in pushed messages to; default to 2, i.e. always carrying the diff of the previous
+    /// seqno, so that our own previous message (which may not yet have been deleted from the
+    /// server) is always recognized as included rather than needing a merge.  Values below 2 are
+    /// treated as 2, and values above `config_lags()` disable lowering.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `int` -- Returns the minimum number of carried config lags
+    virtual int min_config_lags() const { return 2; }
+
+    /// Number of consecutive pushes, without seeing an update from another client, after which
+    /// adaptive lags lowers the carried lags by one.
+    static constexpr int ADAPTIVE_LAG_QUIET_PUSHES = 3;
+
+    /// API: base/ConfigBase::set_adaptive_lags
+    ///
+    /// Enables or disables adaptive lags (disabled by default).  When enabled, the number of lagged
+    /// diffs carried in pushed messages starts at `config_lags()` and is lowered by one (down to
+    /// `min_config_lags()`) after every `ADAPTIVE_LAG_QUIET_PUSHES` pushes made without `merge()`
+    /// seeing an update from another client.  As soon as `merge()` sees such an update, or has to
+    /// resolve a conflict, the full `config_lags()` are carried again.  This shrinks the messages
+    /// pushed by a client that is the only one making changes, while keeping the full conflict
+    /// window whenever multiple clients are active.
+    ///
+    /// A pushed message only ever leaves out lagged diffs whose changes are all made again by a
+    /// newer diff that it does carry, so conflicts resolve exactly as they would with the full
+    /// lags; if a push would leave out any other change then the full `config_lags()` are carried
+    /// again.  Incoming messages are always merged using the full `config_lags()` window.
+    /// The bytes left out of pushed messages are counted in the `lag_bytes_saved` metric.
+    ///
+    /// Inputs:
+    /// - `enabled` -- true to enable adaptive lags, false to always carry `config_lags()`
+    void set_adaptive_lags(bool enabled);
+
+    /// API: base/ConfigBase::adaptive_lags
+    ///
+    /// Returns true if adaptive lags are enabled (see `set_adaptive_lags()`).
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `bool` -- true if adaptive lags are enabled
+    bool adaptive_lags() const { return _adaptive_lags; }
+
+    /// API: base/ConfigBase::carried_lags
+    ///
+    /// Returns the number of config lags that will be carried in the next new message we push.
+    /// This is always `config_lags()` unless adaptive lags are enabled.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `int` -- the number of lags to be carried
+    int carried_lags() const;
+
+    /// API: base/ConfigBase::publish
+    ///
+    /// Publishes a new read-only snapshot of the current config data (if it has changed since the
+    /// last published snapshot) to be returned by `snapshot()`.
+    ///
+    /// Publishing is opt-in, as each snapshot is a full copy of the config data: no snapshot exists
+    /// until the first call to this method, after which `merge()` and `push()` also publish
+    /// automatically.  A writer making local changes can call it again to make the changes visible
+    /// to snapshot readers immediately.
+    ///
+    /// Like all other non-const methods this must not be called concurrently with other access to
+    /// the config object; it is only `snapshot()` that may be called concurrently.
+    ///
+    /// Inputs: None
+    void publish();
+
+    /// API: base/ConfigBase::snapshot
+    ///
+    /// Returns the most recently published snapshot of the config, or nullptr if `publish()` has
+    /// never been called.  The snapshot is an immutable, reference-counted copy of the config (of
+    /// the same subclass type) on which all the const accessors may be used, and which remains
+    /// valid (and unchanged) while this object is merged, modified, or destroyed.
+    ///
+    /// Unlike every other method, this may be called from any thread concurrently with other
+    /// access to the config object; obtaining the snapshot does not lock.  Subclasses provide an
+    /// overload returning a pointer to the subclass type.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `std::shared_ptr<const ConfigBase>` -- the current snapshot
+    std::shared_ptr<const ConfigBase> snapshot() const { return std::atomic_load(&_snapshot); }
+
+    /// API: base/ConfigBase::metrics
+    ///
+    /// Returns a snapshot of the performance metrics of this config object: counters (messages,
+    /// decryption attempts and failures, and byte counts before and after (de)compression) and
+    /// latency histograms of each phase of `merge()`, `push()`, and `dump()`, accumulated since
+    /// construction or the last `reset_metrics()` call.
+    ///
+    /// Metrics collection is always on: it consists only of a few relaxed atomic updates and clock
+    /// reads per operation.  This method may be called from any thread.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `metrics_snapshot` -- the current metrics values
+    metrics_snapshot metrics() const { return _metrics.snapshot(); }
+
+    /// API: base/ConfigBase::reset_metrics
+    ///
+    /// Resets all of the metrics of this config object to zero.
+    ///
+    /// Inputs: None
+    void reset_metrics() { _metrics.reset(); }
+
     /// API: base/ConfigBase::merge
     ///
     /// This takes all of the messages pulled down from the server and does whatever is necessary to
@@ -772,6 +1044,27 @@ class ConfigBase {
     // Same as merge (above )but takes the values as ustring's as sometimes that is more convenient.
     int merge(const std::vector<std::pair<std::string, ustring>>& configs);
 
+    /// API: base/ConfigBase::processed_seqno
+    ///
+    /// Returns the seqno of the message with the given hash if `merge()` has already successfully
+    /// processed it (and it is still held in the bounded cache of processed messages); returns
+    /// nullopt otherwise.
+    ///
+    /// Messages in this cache are skipped by `merge()` without being decrypted or parsed again
+    /// (since their content has already been merged), and so are not counted in merge's return
+    /// value.  Other than the current config message, skipped messages are never newer than the
+    /// current config and so become obsolete hashes to be deleted by the next push.
+    ///
+    /// The cache is cleared whenever the signing keys change or an encryption key is removed, so
+    /// that messages are checked again under the new keys.
+    ///
+    /// Inputs:
+    /// - `msg_hash` -- the message hash
+    ///
+    /// Outputs:
+    /// - `std::optional<seqno_t>` -- the seqno of the message, if previously processed
+    std::optional<seqno_t> processed_seqno(const std::string& msg_hash) const;
+
     /// API: base/ConfigBase::is_dirty
     ///
     /// Returns true if we are currently dirty (i.e. have made changes that haven't been serialized
@@ -810,7 +1103,8 @@ class ConfigBase {
     /// Returns true if this object contains updated data that has not yet been confirmed stored on
     /// the server.  This will be true whenever `is_clean()` is false: that is, if we are currently
     /// "dirty" (i.e.  have changes that haven't been pushed) or are still awaiting confirmation of
-    /// storage of the most recent serialized push data.
+    /// storage of the most recent serialized push data.  Always false for a read-only object (see
+    /// `is_readonly()`), which cannot push.
     ///
     /// Inputs: None
     ///
@@ -839,6 +1133,9 @@ class ConfigBase {
     /// Subclasses that need to perform pre-push tasks (such as pruning stale data) can override
     /// this to prune and then call the base method to perform the actual push generation.
     ///
+    /// Throws std::logic_error if there is no encryption key, or if the object is read-only (i.e.
+    /// it has a signature pubkey but no signing key; see `is_readonly()`).
+    ///
     /// Inputs: None
     ///
     /// Outputs:
@@ -870,6 +1167,104 @@ class ConfigBase {
     /// - `msg_hash` -- message hash that was pushed
     virtual void confirm_pushed(seqno_t seqno, std::string msg_hash);
 
+    /// Result of a push: the same values as returned by `push()`.
+    using push_result = std::tuple<seqno_t, ustring, std::vector<std::string>>;
+
+    /// Executor used to run asynchronous operations: it is given a task which it must invoke,
+    /// exactly once, on some thread of its choosing.
+    using async_executor = std::function<void(std::function<void()> task)>;
+
+    /// API: base/ConfigBase::set_executor
+    ///
+    /// Sets the executor used to run the `merge_async()` and `push_async()` operations of this
+    /// object.  By default (or if set to nullptr) these run on a single background thread managed
+    /// by the library and shared by all config objects.
+    ///
+    /// Whatever the executor, the asynchronous operations of a single object never run
+    /// concurrently: they are queued and run one at a time, in the order they were requested.
+    ///
+    /// Inputs:
+    /// - `executor` -- the executor to use, or nullptr to use the library's background thread
+    void set_executor(async_executor executor);
+
+    /// API: base/ConfigBase::merge_async
+    ///
+    /// Asynchronous version of `merge()`: queues the merge of the given messages to be run on the
+    /// executor (see `set_executor()`), rather than doing the decryption, decompression, parsing,
+    /// and merging on the calling thread.
+    ///
+    /// Asynchronous operations can only be used on an object created as an `async_config` (e.g.
+    /// `async_config<Contacts>`), which takes care of them when it is destroyed; on any other
+    /// object this throws std::logic_error.
+    ///
+    /// There are two versions of this method: one returns a future for the result of the merge;
+    /// the other instead invokes a callback when the merge completes (on the executor thread).  The
+    /// callback is passed the number of merged messages and, if the merge threw an exception (or
+    /// was cancelled by the destruction of the object), the exception.  Callbacks must not throw.
+    ///
+    /// While any asynchronous operation is outstanding the caller must not access the object
+    /// other than to queue further asynchronous operations, to call `snapshot()` (which, once
+    /// publishing has been started, is published as usual when the merge completes), to call
+    /// `wait_async()`, or to destroy it.
+    ///
+    /// Declaration:
+    /// ```cpp
+    /// std::future<int> merge_async(std::vector<std::pair<std::string, ustring>> configs);
+    /// void merge_async(
+    ///         std::vector<std::pair<std::string, ustring>> configs,
+    ///         std::function<void(int merged, std::exception_ptr error)> on_done);
+    /// ```
+    ///
+    /// Inputs:
+    /// - `configs` -- vector of pairs containing the message hash and the raw message body
+    /// - `on_done` -- callback to invoke on completion
+    ///
+    /// Outputs:
+    /// - `std::future<int>` -- future for the value `merge()` returns (first version only)
+    std::future<int> merge_async(std::vector<std::pair<std::string, ustring>> configs);
+    void merge_async(
+            std::vector<std::pair<std::string, ustring>> configs,
+            std::function<void(int merged, std::exception_ptr error)> on_done);
+
+    /// API: base/ConfigBase::push_async
+    ///
+    /// Asynchronous version of `push()`: queues the generation of the push data (i.e. the
+    /// serialization, compression, and encryption) to be run on the executor.  As with
+    /// `merge_async()` the result is available either through the returned future or via a
+    /// completion callback, and the same restrictions on accessing the object apply.
+    ///
+    /// If an earlier `push_async()` is still waiting in the queue (i.e. it has not started yet)
+    /// then it is superseded by this one: the earlier one is cancelled, with its future or callback
+    /// receiving an `async_cancelled` exception, as only the newest push data needs to be sent.
+    ///
+    /// Declaration:
+    /// ```cpp
+    /// std::future<push_result> push_async();
+    /// void push_async(std::function<void(push_result result, std::exception_ptr error)> on_done);
+    /// ```
+    ///
+    /// Inputs:
+    /// - `on_done` -- callback to invoke on completion; `result` is empty if `error` is set
+    ///
+    /// Outputs:
+    /// - `std::future<push_result>` -- future for the value `push()` returns (first version only)
+    std::future<push_result> push_async();
+    void push_async(std::function<void(push_result result, std::exception_ptr error)> on_done);
+
+    /// API: base/ConfigBase::wait_async
+    ///
+    /// Blocks until all queued asynchronous operations on this object have completed.  This must
+    /// not be called from a completion callback.
+    ///
+    /// Calling this before destroying the object is only needed to let every queued operation
+    /// complete: destroying an `async_config` cancels the operations that have not yet started
+    /// (delivering `async_cancelled` to them) and waits for one that is already running, unless it
+    /// is destroyed from that operation's completion callback, in which case the operation simply
+    /// finishes once the callback returns.
+    ///
+    /// Inputs: None
+    void wait_async();
+
     /// API: base/ConfigBase::dump
     ///
     /// Returns a dump of the current state for storage in the database; this value would get passed
@@ -981,6 +1376,83 @@ class ConfigBase {
     /// - `bool` -- Returns true if it does exist
     bool has_key(ustring_view key) const;
 
+    /// API: base/ConfigBase::set_sig_keys
+    ///
+    /// Signing key methods.  Once a signing key or signature pubkey has been set, every config
+    /// message pushed by this object is signed, and every incoming message must carry a valid
+    /// signature from the signing key: `merge()` drops (as if unparseable) any message that is
+    /// unsigned or has a bad signature.  Messages that have already passed verification are not
+    /// verified again if seen again, and re-serializing unchanged config data reuses its existing
+    /// signature rather than signing it again.
+    ///
+    /// Sets an Ed25519 signing key, used both to sign outgoing messages and to verify incoming
+    /// messages.  Replaces any existing signing key or signature pubkey.  Throws
+    /// std::invalid_argument if the key is not a 64-byte Ed25519 secret key.
+    ///
+    /// Inputs:
+    /// - `secret` -- the 64-byte libsodium-style Ed25519 secret key (i.e. seed and pubkey)
+    void set_sig_keys(ustring_view secret);
+
+    /// API: base/ConfigBase::set_xed25519_sig_keys
+    ///
+    /// Same as `set_sig_keys()`, but for an X25519 private key, with messages signed and verified
+    /// using XEd25519.  Throws std::invalid_argument if the key is not 32 bytes.
+    ///
+    /// Inputs:
+    /// - `x25519_privkey` -- the 32-byte X25519 private key
+    void set_xed25519_sig_keys(ustring_view x25519_privkey);
+
+    /// API: base/ConfigBase::set_sig_pubkey
+    ///
+    /// Sets an Ed25519 pubkey that incoming messages must be signed by, without a signing key: the
+    /// object becomes read-only (see `is_readonly()`).  Replaces any existing signing key or
+    /// signature pubkey.  Throws std::invalid_argument if the key is not 32 bytes.
+    ///
+    /// Inputs:
+    /// - `pubkey` -- the 32-byte Ed25519 pubkey
+    void set_sig_pubkey(ustring_view pubkey);
+
+    /// API: base/ConfigBase::set_xed25519_sig_pubkey
+    ///
+    /// Same as `set_sig_pubkey()`, but for the X25519 pubkey of an XEd25519 signer.  Throws
+    /// std::invalid_argument if the key is not 32 bytes.
+    ///
+    /// Inputs:
+    /// - `x25519_pubkey` -- the 32-byte X25519 pubkey
+    void set_xed25519_sig_pubkey(ustring_view x25519_pubkey);
+
+    /// API: base/ConfigBase::clear_sig_keys
+    ///
+    /// Removes any signing key and signature pubkey, so that messages are neither signed nor
+    /// verified.
+    ///
+    /// Inputs: None
+    void clear_sig_keys();
+
+    /// API: base/ConfigBase::get_sig_pubkey
+    ///
+    /// Returns the Ed25519 pubkey that messages are signed and verified with, if signing keys or a
+    /// signature pubkey are set.  For XEd25519 keys this is the (positive) Ed25519 pubkey that the
+    /// XEd25519 signatures verify against.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `std::optional<std::array<unsigned char, 32>>` -- the pubkey, or nullopt if not set
+    std::optional<std::array<unsigned char, 32>> get_sig_pubkey() const;
+
+    /// API: base/ConfigBase::is_readonly
+    ///
+    /// Returns true if this object has a signature pubkey but no signing key, and so can only
+    /// verify, not produce, config messages.  A read-only object never needs a push, and `push()`
+    /// throws.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `bool` -- true if read-only
+    bool is_readonly() const;
+
     /// API: base/ConfigBase::key
     ///
     /// Accesses the key at position i (0 if omitted).  There must be at least one key, and i must
@@ -998,6 +1470,26 @@ class ConfigBase {
     }
 };
 
+/// Final wrapper around a concrete config type that adds support for the asynchronous operations
+/// (`merge_async()`, `push_async()`): on destruction it cancels any queued operations that haven't
+/// started and waits for a running one, *before* any part of the config object is destroyed (a
+/// running operation uses the whole object).  For example:
+///
+///     session::config::async_config<session::config::Contacts> contacts{seed, dump};
+///     auto merged = contacts.merge_async(std::move(messages));
+template <typename ConfigT>
+class async_config final : public ConfigT {
+    static_assert(std::is_base_of_v<ConfigBase, ConfigT>);
+
+  public:
+    using ConfigT::ConfigT;
+
+    ~async_config() override { this->cancel_async(); }
+
+  private:
+    bool cancels_async() const override { return true; }
+};
+
 // The C++ struct we hold opaquely inside the C internals struct.  This is designed so that any
 // internals<T> has the same layout so that it doesn't matter whether we unbox to an
 // internals<ConfigBase> or internals<SubType>.
@@ -1006,23 +1498,28 @@ template <
         std::enable_if_t<std::is_base_of_v<ConfigBase, ConfigT>, int> = 0>
 struct internals final {
     std::unique_ptr<ConfigBase> config;
+    // Set (instead of `config`) when the box refers to a config object owned by something else,
+    // such as one of the configs of a user_config_set.  config_free does nothing for such a box.
+    ConfigBase* borrowed = nullptr;
     std::string error;
 
+    ConfigBase* get() const { return borrowed ? borrowed : config.get(); }
+
     /// Dereferencing falls through to the ConfigBase object
     ConfigT* operator->() {
         if constexpr (std::is_same_v<ConfigT, ConfigBase>)
-            return config.get();
+            return get();
         else {
-            auto* c = dynamic_cast<ConfigT*>(config.get());
+            auto* c = dynamic_cast<ConfigT*>(get());
             assert(c);
             return c;
         }
     }
     const ConfigT* operator->() const {
         if constexpr (std::is_same_v<ConfigT, ConfigBase>)
-            return config.get();
+            return get();
         else {
-            auto* c = dynamic_cast<ConfigT*>(config.get());
+            auto* c = dynamic_cast<ConfigT*>(get());
             assert(c);
             return c;
         }
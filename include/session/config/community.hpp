@@ -10,6 +10,8 @@
 
 namespace session::config {
 
+struct community_key;
+
 /// Base class for types representing a community; this base type handles the url/room/pubkey that
 /// such a type need.  Generally a class inherits from this to extend with the local
 /// community-related values.
@@ -36,6 +38,11 @@ struct community {
     // constructing a new `community` object.
     explicit community(std::string_view full_url);
 
+    // Constructs a community struct (without a pubkey) from a pre-canonicalized key.  This does
+    // not need to re-canonicalize the url or room; the room keeps the case it had when the key was
+    // constructed.
+    explicit community(const community_key& key);
+
     /// API: community/community::set_full_url
     ///
     /// Replaces the baseurl/room/pubkey of this object from a URL.  This parses the URL, then
@@ -219,6 +226,35 @@ struct community {
     /// - `std::string` -- Returns the canonical room
     static std::string canonical_room(std::string_view room);
 
+    /// API: community/community::valid_room
+    ///
+    /// Returns whether the given room token is valid, i.e. whether `canonical_room` would accept
+    /// it.  Unlike `canonical_room` this doesn't allocate or throw.
+    ///
+    /// Inputs:
+    /// - `room` -- the room token to check (in any case)
+    ///
+    /// Outputs:
+    /// - `bool` -- true if the room token is valid
+    static bool valid_room(std::string_view room);
+
+    /// API: community/community::intern_base_url
+    ///
+    /// Returns the canonical form of the given base URL (as `canonical_url` does) from a shared,
+    /// process-wide intern table, so that repeatedly canonicalizing the same URL (for example,
+    /// when constructing `community_key`s for many rooms on the same server) does not have to
+    /// re-parse the URL each time, and so that all holders of the same base URL share the same
+    /// string.  The table only keeps a URL while the returned string is still held somewhere.
+    /// Throws the same exceptions as `canonical_url` for an invalid URL.  Thread-safe (the table is
+    /// protected by a mutex, which is why plain `community` objects don't use it).
+    ///
+    /// Inputs:
+    /// - `url` -- string of the url to canonicalize
+    ///
+    /// Outputs:
+    /// - `std::shared_ptr<const std::string>` -- the shared, canonical URL
+    static std::shared_ptr<const std::string> intern_base_url(std::string_view url);
+
     /// API: community/community::canonicalize_url
     ///
     /// Same as above canonical_url, but modifies the argument in-place instead of returning a
@@ -292,6 +328,55 @@ struct community {
     community(std::string_view base_url, std::string_view room);
 };
 
+/// A pre-canonicalized community base url and room token, for use as a lookup key.
+///
+/// Constructing a community_key does the url and room canonicalization (and validation) once; the
+/// key can then be reused for any number of lookups and updates (e.g. in ConvoInfoVolatile and
+/// UserGroups) without redoing that work.  The base url is obtained through
+/// `community::intern_base_url`, so keys for rooms on the same server share the same string.
+struct community_key {
+    /// API: community/community_key::community_key
+    ///
+    /// Constructs a key from a base url and room token, canonicalizing both.  Throws
+    /// std::invalid_argument if either is invalid.  The room token is also kept as given, so that
+    /// a `community` constructed from the key preserves its case.
+    ///
+    /// Declaration:
+    /// ```cpp
+    /// community_key(std::string_view base_url, std::string_view room);
+    /// explicit community_key(const community& c);
+    /// ```
+    ///
+    /// Inputs:
+    /// - `base_url` -- the base url (need not be canonical)
+    /// - `room` -- the room token (need not be lower-case)
+    /// - `c` -- alternatively, an existing community object, whose base url and room are already
+    ///   canonical (its case-preserved `room()` is kept as well)
+    community_key(std::string_view base_url, std::string_view room);
+    explicit community_key(const community& c);
+
+    /// Returns the canonical base url
+    const std::string& base_url() const { return *base_url_; }
+    /// Returns the canonical (lower-case) room token
+    const std::string& room() const { return room_; }
+    /// Returns the room token with its case preserved, as given when constructing the key.  This
+    /// is not used for comparisons.
+    const std::string& localized_room() const { return localized_room_; }
+
+    bool operator==(const community_key& other) const {
+        return room_ == other.room_ &&
+               (base_url_ == other.base_url_ || *base_url_ == *other.base_url_);
+    }
+    bool operator!=(const community_key& other) const { return !(*this == other); }
+    bool operator<(const community_key& other) const {
+        return std::tie(*base_url_, room_) < std::tie(*other.base_url_, other.room_);
+    }
+
+  private:
+    std::shared_ptr<const std::string> base_url_;
+    std::string room_, localized_room_;
+};
+
 struct comm_iterator_helper {
 
     comm_iterator_helper(dict::const_iterator it_server, dict::const_iterator end_server) :
@@ -399,4 +484,40 @@ struct comm_iterator_helper {
     }
 };
 
+/// Allocation-free counterpart of comm_iterator_helper used by the config `view()` iterators.  This
+/// walks the same nested server/room dicts, but exposes the stored base url, room, pubkey, and room
+/// dict directly rather than constructing a `community` (which canonicalizes the url and room and
+/// copies the pubkey) for every room.  Like comm_iterator_helper, it skips servers and rooms with
+/// an invalid base url, pubkey, or room token.
+struct comm_view_helper {
+    comm_view_helper() = default;  // Constructs an empty/end helper
+    explicit comm_view_helper(const dict& servers);
+
+    bool done() const { return it_server == end_server; }
+
+    bool operator==(const comm_view_helper& other) const {
+        return done() ? other.done() : !other.done() && it_room == other.it_room;
+    }
+
+    // Accessors for the current room; must not be called when `done()`.
+    std::string_view base_url() const { return it_server->first; }
+    std::string_view room() const { return it_room->first; }
+    ustring_view pubkey() const {
+        return {reinterpret_cast<const unsigned char*>(pubkey_->data()), pubkey_->size()};
+    }
+    const dict& room_info() const { return std::get<dict>(it_room->second); }
+
+    void advance() {
+        ++it_room;
+        settle();
+    }
+
+  private:
+    dict::const_iterator it_server, end_server, it_room, end_room;
+    const std::string* pubkey_ = nullptr;  // Set when it_room/end_room are valid
+
+    // Moves forward, if necessary, to the first valid room at or after the current position.
+    void settle();
+};
+
 }  // namespace session::config
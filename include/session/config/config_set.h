@@ -0,0 +1,293 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+// Holds all of the user-level configs (user profile, contacts, convo info volatile, and user
+// groups) so that they can be merged, pushed, and dumped together.  See `ConfigSet` in
+// config_set.hpp for details.
+typedef struct user_config_set {
+    // Internal opaque object pointer; calling code should leave this alone.
+    void* internals;
+    // When an error occurs in the C API this string will be set to the specific error message.  May
+    // be empty.
+    const char* last_error;
+
+    // Sometimes used as the backing buffer for `last_error`.  Should not be touched externally.
+    char _error_buf[256];
+} user_config_set;
+
+/// API: config_set/user_config_set_init
+///
+/// Constructs a user config set holding all of the user-level configs, and sets a pointer to it in
+/// `set`.
+///
+/// When done with the object the `user_config_set` must be destroyed by passing the pointer to
+/// user_config_set_free().
+///
+/// Declaration:
+/// ```cpp
+/// INT user_config_set_init(
+///     [out]   user_config_set**       set,
+///     [in]    const unsigned char*    ed25519_secretkey,
+///     [in]    const unsigned char*    dump,
+///     [in]    size_t                  dumplen,
+///     [out]   char*                   error
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [out] Pointer to the config set object
+/// - `ed25519_secretkey` -- [in] must be the 32-byte secret key seed value.  (You can also pass the
+/// pointer to the beginning of the 64-byte value libsodium calls the "secret key" as the first 32
+/// bytes of that are the seed).  This field cannot be null.
+/// - `dump` -- [in] if non-NULL this restores the state from the combined dump produced by a past
+/// instantiation's call to `user_config_set_dump()`.  To construct new, empty configs this should
+/// be NULL.
+/// - `dumplen` -- [in] the length of `dump` when restoring from a dump, or 0 when `dump` is NULL.
+/// - `error` -- [out] the pointer to a buffer in which we will write an error string if an error
+/// occurs; error messages are discarded if this is given as NULL.  If non-NULL this must be a
+/// buffer of at least 256 bytes.
+///
+/// Outputs:
+/// - `int` -- Returns 0 on success; returns a non-zero error code and write the exception message
+/// as a C-string into `error` (if not NULL) on failure.
+LIBSESSION_EXPORT int user_config_set_init(
+        user_config_set** set,
+        const unsigned char* ed25519_secretkey,
+        const unsigned char* dump,
+        size_t dumplen,
+        char* error);
+
+/// API: config_set/user_config_set_free
+///
+/// Frees a config set object created with user_config_set_init, including all of the contained
+/// config objects.
+///
+/// Declaration:
+/// ```cpp
+/// VOID user_config_set_free(
+///     [in, out]   user_config_set*    set
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [in] Pointer to the user_config_set object
+LIBSESSION_EXPORT void user_config_set_free(user_config_set* set);
+
+/// API: config_set/user_config_set_get
+///
+/// Returns the config object for the given storage namespace, which can then be used with the
+/// config-specific C functions (e.g. `contacts_get`, or `user_profile_set_name`).  The returned
+/// object is owned by the config set and remains valid until the set is freed; passing it to
+/// `config_free` does nothing.
+///
+/// Declaration:
+/// ```cpp
+/// CONFIG_OBJECT* user_config_set_get(
+///     [in]    user_config_set*    set,
+///     [in]    int16_t             ns
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [in] Pointer to the user_config_set object
+/// - `ns` -- [in] the storage namespace of the config (2, 3, 4, or 5)
+///
+/// Outputs:
+/// - `config_object*` -- the contained config object, or NULL if `ns` is not a namespace of one of
+///   the contained configs.
+LIBSESSION_EXPORT config_object* user_config_set_get(user_config_set* set, int16_t ns);
+
+/// API: config_set/user_config_set_set_executor
+///
+/// Sets the executor (see `config_set_executor`) of every contained config, and lets
+/// `user_config_set_merge` merge the different configs concurrently: the first affected config is
+/// merged on the calling thread and the others are given to the executor.  As
+/// `user_config_set_merge` waits for them to finish, the executor must run the tasks on other
+/// threads (or immediately).  Without an executor (the default, or if `executor` is NULL) the
+/// configs are merged one after another on the calling thread.
+///
+/// Declaration:
+/// ```cpp
+/// VOID user_config_set_set_executor(
+///     [in, out]   user_config_set*                                    set,
+///     [in]        void(*)(void(*)(void*), void*, void*)               executor,
+///     [in]        void*                                               ctx
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [in, out] Pointer to the user_config_set object
+/// - `executor` -- [in] Executor function, or NULL for none
+/// - `ctx` -- [in, optional] Pointer to an optional context passed to `executor`.  Set to NULL if
+///   unused
+LIBSESSION_EXPORT void user_config_set_set_executor(
+        user_config_set* set,
+        void (*executor)(void (*run)(void* task), void* task, void* ctx),
+        void* ctx);
+
+/// API: config_set/user_config_set_merge
+///
+/// Merges a batch of config messages retrieved from the swarm, such as all the config messages
+/// returned by one poll, into the contained configs.  The messages are grouped by namespace and
+/// each affected config is merged once with all of its messages; the configs are merged
+/// concurrently if an executor has been set with `user_config_set_set_executor`, and otherwise one
+/// after another on the calling thread.
+///
+/// Declaration:
+/// ```cpp
+/// INT user_config_set_merge(
+///     [in]    user_config_set*        set,
+///     [in]    const int16_t*          namespaces,
+///     [in]    const char**            msg_hashes,
+///     [in]    const unsigned char**   configs,
+///     [in]    const size_t*           lengths,
+///     [in]    size_t                  count
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [in] Pointer to the user_config_set object
+/// - `namespaces` -- [in] array of the storage namespace of each message
+/// - `msg_hashes` -- [in] array of the message hash of each message
+/// - `configs` -- [in] array of the message data of each message
+/// - `lengths` -- [in] array of the length of each message
+/// - `count` -- [in] the number of messages (i.e. the length of each of the above arrays)
+///
+/// Outputs:
+/// - `int` -- the number of messages successfully parsed and merged, or -1 if an error occurs (in
+///   which case `set->last_error` is set).  If any message has an unknown namespace then nothing is
+///   merged.
+LIBSESSION_EXPORT int user_config_set_merge(
+        user_config_set* set,
+        const int16_t* namespaces,
+        const char** msg_hashes,
+        const unsigned char** configs,
+        const size_t* lengths,
+        size_t count);
+
+/// API: config_set/user_config_set_needs_push
+///
+/// Returns true if any of the contained configs needs to be pushed.
+///
+/// Declaration:
+/// ```cpp
+/// BOOL user_config_set_needs_push(
+///     [in]    const user_config_set*      set
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [in] Pointer to the user_config_set object
+///
+/// Outputs:
+/// - `bool` -- true if `user_config_set_push` would return any messages.
+LIBSESSION_EXPORT bool user_config_set_needs_push(const user_config_set* set);
+
+typedef struct user_config_set_push_data {
+    // The number of configs with a message to push; this is the length of both `namespaces` and
+    // `pushes`.
+    size_t len;
+    // The storage namespace of each message to push.
+    int16_t* namespaces;
+    // The message to push for each namespace; each element has the same meaning as the value
+    // returned by `config_push`.  (Elements must not be freed individually).
+    config_push_data* pushes;
+} user_config_set_push_data;
+
+/// API: config_set/user_config_set_push
+///
+/// Returns the messages to push for all of the contained configs that currently need to be pushed.
+/// The storage of each push should be reported back by calling `user_config_set_confirm_pushed`.
+///
+/// The returned pointer belongs to the caller and must be freed via `free()` when done with it.
+///
+/// Declaration:
+/// ```cpp
+/// USER_CONFIG_SET_PUSH_DATA* user_config_set_push(
+///     [in]    user_config_set*    set
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [in] Pointer to the user_config_set object
+///
+/// Outputs:
+/// - `user_config_set_push_data*` -- the messages to push (with `len` set to 0 if nothing needs to
+///   be pushed).
+LIBSESSION_EXPORT user_config_set_push_data* user_config_set_push(user_config_set* set);
+
+/// API: config_set/user_config_set_confirm_pushed
+///
+/// Reports that a message returned by `user_config_set_push` was stored; see
+/// `config_confirm_pushed`.
+///
+/// Declaration:
+/// ```cpp
+/// BOOL user_config_set_confirm_pushed(
+///     [in]    user_config_set*    set,
+///     [in]    int16_t             ns,
+///     [in]    seqno_t             seqno,
+///     [in]    const char*         msg_hash
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [in] Pointer to the user_config_set object
+/// - `ns` -- [in] the storage namespace of the pushed message
+/// - `seqno` -- [in] the seqno of the pushed message
+/// - `msg_hash` -- [in] the message hash returned by the swarm
+///
+/// Outputs:
+/// - `bool` -- true on success, false if `ns` is not a namespace of the set (in which case
+///   `set->last_error` is set).
+LIBSESSION_EXPORT bool user_config_set_confirm_pushed(
+        user_config_set* set, int16_t ns, seqno_t seqno, const char* msg_hash);
+
+/// API: config_set/user_config_set_needs_dump
+///
+/// Returns true if any of the contained configs has changes that need to be dumped.
+///
+/// Declaration:
+/// ```cpp
+/// BOOL user_config_set_needs_dump(
+///     [in]    const user_config_set*      set
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [in] Pointer to the user_config_set object
+///
+/// Outputs:
+/// - `bool` -- true if a new dump should be made
+LIBSESSION_EXPORT bool user_config_set_needs_dump(const user_config_set* set);
+
+/// API: config_set/user_config_set_dump
+///
+/// Returns a single combined dump of all the contained configs, which can be passed to
+/// `user_config_set_init` to restore them.  The returned buffer is malloced and must be freed by
+/// the caller.
+///
+/// Declaration:
+/// ```cpp
+/// VOID user_config_set_dump(
+///     [in]    user_config_set*        set,
+///     [out]   unsigned char**         out,
+///     [out]   size_t*                 outlen
+/// );
+/// ```
+///
+/// Inputs:
+/// - `set` -- [in] Pointer to the user_config_set object
+/// - `out` -- [out] set to a pointer to the (malloced) dump data
+/// - `outlen` -- [out] set to the length of the dump data
+LIBSESSION_EXPORT void user_config_set_dump(
+        user_config_set* set, unsigned char** out, size_t* outlen);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "base.hpp"
+#include "contacts.hpp"
+#include "convo_info_volatile.hpp"
+#include "namespaces.hpp"
+#include "user_groups.hpp"
+#include "user_profile.hpp"
+
+namespace session::config {
+
+/// Aggregate owning all of the user-level configs (UserProfile, Contacts, ConvoInfoVolatile and
+/// UserGroups) so that a client's sync loop can feed in all the messages retrieved from a poll at
+/// once, get a single batch of messages to push, and store a single combined dump, rather than
+/// driving each config object separately.
+///
+/// The individual config objects remain accessible (e.g. via `contacts()`) for reading and
+/// modifying the config data.
+class ConfigSet {
+  public:
+    /// The storage namespaces of the configs contained in a ConfigSet, in the order used for
+    /// pushes and dumps.
+    static constexpr std::array<Namespace, 4> NAMESPACES{
+            Namespace::UserProfile,
+            Namespace::Contacts,
+            Namespace::ConvoInfoVolatile,
+            Namespace::UserGroups};
+
+    /// API: config_set/ConfigSet::ConfigSet
+    ///
+    /// Constructs the full set of user configs from the user's ed25519 secret key and, optionally,
+    /// a combined dump previously produced by `dump()`.  Configs missing from the dump (or all of
+    /// them, if no dump is given) are constructed empty.
+    ///
+    /// Throws if the dump (or any config dump contained within it) is invalid.
+    ///
+    /// Inputs:
+    /// - `ed25519_secretkey` -- 64-byte (or 32-byte seed) ed25519 secret key
+    /// - `dump` -- optional combined dump produced by `ConfigSet::dump()`
+    ConfigSet(ustring_view ed25519_secretkey, std::optional<ustring_view> dump = std::nullopt);
+
+    ConfigSet(const ConfigSet&) = delete;
+    ConfigSet& operator=(const ConfigSet&) = delete;
+
+    /// Accessors for the individual contained configs.
+    UserProfile& user_profile() { return get<UserProfile>(Namespace::UserProfile); }
+    const UserProfile& user_profile() const { return get<UserProfile>(Namespace::UserProfile); }
+    Contacts& contacts() { return get<Contacts>(Namespace::Contacts); }
+    const Contacts& contacts() const { return get<Contacts>(Namespace::Contacts); }
+    ConvoInfoVolatile& convo_info_volatile() {
+        return get<ConvoInfoVolatile>(Namespace::ConvoInfoVolatile);
+    }
+    const ConvoInfoVolatile& convo_info_volatile() const {
+        return get<ConvoInfoVolatile>(Namespace::ConvoInfoVolatile);
+    }
+    UserGroups& user_groups() { return get<UserGroups>(Namespace::UserGroups); }
+    const UserGroups& user_groups() const { return get<UserGroups>(Namespace::UserGroups); }
+
+    /// API: config_set/ConfigSet::config
+    ///
+    /// Returns the contained config for the given storage namespace.  Throws std::invalid_argument
+    /// if the namespace is not one of the namespaces in `NAMESPACES`.
+    ///
+    /// Inputs:
+    /// - `ns` -- the storage namespace
+    ///
+    /// Outputs:
+    /// - `ConfigBase&` -- reference to the config object for that namespace
+    ConfigBase& config(Namespace ns) { return *_configs[index(ns)]; }
+    const ConfigBase& config(Namespace ns) const { return *_configs[index(ns)]; }
+
+    /// API: config_set/ConfigSet::set_executor
+    ///
+    /// Sets the executor (see `ConfigBase::set_executor`) of every contained config, and lets
+    /// `merge()` merge the different configs concurrently: when the messages given to `merge()`
+    /// are for more than one config, the first config is merged on the calling thread and the
+    /// others are given to the executor as separate tasks.  Since `merge()` blocks until all of
+    /// them have finished, the executor must run its tasks on other threads (e.g. a thread pool),
+    /// or immediately, rather than deferring them to the calling thread.
+    ///
+    /// Without an executor (the default, or if set to nullptr) `merge()` merges the configs one
+    /// after another on the calling thread, and asynchronous operations on the contained configs
+    /// use the library's background thread.
+    ///
+    /// Inputs:
+    /// - `executor` -- the executor to use, or nullptr for none
+    void set_executor(ConfigBase::async_executor executor);
+
+    /// A config message retrieved from the swarm, as passed to `merge()`.
+    struct message {
+        Namespace ns;
+        std::string hash;
+        ustring_view data;
+    };
+
+    /// API: config_set/ConfigSet::merge
+    ///
+    /// Merges a batch of retrieved config messages (such as all the messages returned by a single
+    /// poll of the user's config namespaces) into the contained configs.  The messages are grouped
+    /// by namespace and each config receives its messages in a single `ConfigBase::merge` call.
+    /// The configs are merged concurrently if an executor has been set (see `set_executor()`), and
+    /// otherwise one after another on the calling thread.  If merging one config throws the others
+    /// are still merged, and then the first exception (in `NAMESPACES` order) is rethrown.
+    ///
+    /// Note that when merging concurrently any `logger` callbacks set on the individual configs
+    /// may be invoked from the executor's threads during the call.
+    ///
+    /// Throws std::invalid_argument, without merging anything, if any message has a namespace that
+    /// is not part of this set.
+    ///
+    /// Inputs:
+    /// - `messages` -- the messages to merge
+    ///
+    /// Outputs:
+    /// - `int` -- the total number of messages that were successfully parsed and merged.
+    int merge(const std::vector<message>& messages);
+
+    /// API: config_set/ConfigSet::needs_push
+    ///
+    /// Returns true if any of the contained configs needs to be pushed.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `bool` -- true if `push()` would return any messages.
+    bool needs_push() const;
+
+    /// A message to push to the swarm, as returned by `push()`; the fields are the same as the
+    /// values returned by `ConfigBase::push`.
+    struct push_data {
+        Namespace ns;
+        seqno_t seqno;
+        ustring data;
+        std::vector<std::string> obsolete;
+    };
+
+    /// API: config_set/ConfigSet::push
+    ///
+    /// Returns the messages to push for all of the contained configs that currently need to be
+    /// pushed (in `NAMESPACES` order).  As with `ConfigBase::push`, each successful store must be
+    /// reported back via `confirm_pushed()`.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `std::vector<push_data>` -- the messages to push; empty if nothing needs pushing.
+    std::vector<push_data> push();
+
+    /// API: config_set/ConfigSet::confirm_pushed
+    ///
+    /// Confirms that a message returned by `push()` was stored; see `ConfigBase::confirm_pushed`.
+    /// Throws std::invalid_argument if the namespace is not part of this set.
+    ///
+    /// Inputs:
+    /// - `ns` -- the namespace of the pushed message
+    /// - `seqno` -- the seqno of the pushed message
+    /// - `msg_hash` -- the message hash returned by the swarm
+    void confirm_pushed(Namespace ns, seqno_t seqno, std::string msg_hash);
+
+    /// API: config_set/ConfigSet::needs_dump
+    ///
+    /// Returns true if any of the contained configs has changes that need to be dumped.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `bool` -- true if a new dump should be made
+    bool needs_dump() const;
+
+    /// API: config_set/ConfigSet::dump
+    ///
+    /// Returns a single combined dump of all the contained configs, suitable for passing to the
+    /// ConfigSet constructor to restore the configs.
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `ustring` -- the combined dump
+    ustring dump();
+
+  private:
+    // Contained configs, in NAMESPACES order
+    std::array<std::unique_ptr<ConfigBase>, NAMESPACES.size()> _configs;
+
+    // Executor for concurrent merges; if empty we merge on the calling thread.
+    ConfigBase::async_executor _executor;
+
+    // Returns the index into NAMESPACES/_configs of the given namespace; throws if not found.
+    static size_t index(Namespace ns);
+
+    template <typename ConfigT>
+    ConfigT& get(Namespace ns) {
+        return static_cast<ConfigT&>(*_configs[index(ns)]);
+    }
+    template <typename ConfigT>
+    const ConfigT& get(Namespace ns) const {
+        return static_cast<const ConfigT&>(*_configs[index(ns)]);
+    }
+};
+
+}  // namespace session::config
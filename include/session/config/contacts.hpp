@@ -140,6 +140,18 @@ class Contacts : public ConfigBase {
     /// - `const char*` - Will return "Contacts"
     const char* encryption_domain() const override { return "Contacts"; }
 
+    std::shared_ptr<const Contacts> snapshot() const {
+        return std::static_pointer_cast<const Contacts>(ConfigBase::snapshot());
+    }
+
+  protected:
+    Contacts(const Contacts& other, snapshot_t t) : ConfigBase{other, t} {}
+    std::shared_ptr<const ConfigBase> make_snapshot() const override {
+        return std::shared_ptr<const Contacts>(new Contacts{*this, snapshot_tag});
+    }
+
+  public:
+
     /// API: contacts/Contacts::get
     ///
     /// Looks up and returns a contact by session ID (hex).  Returns nullopt if the session ID was
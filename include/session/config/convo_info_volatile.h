@@ -327,6 +327,43 @@ LIBSESSION_EXPORT void convo_info_volatile_set_community(
 LIBSESSION_EXPORT void convo_info_volatile_set_legacy_group(
         config_object* conf, const convo_info_volatile_legacy_group* convo);
 
+/// API: convo_info_volatile/convo_info_volatile_mark_read
+///
+/// Marks conversations as read in bulk: each conversation of the selected types has its unread
+/// flag cleared and its last_read value raised to `last_read` (conversations with a later
+/// last_read value keep it).  This is much more efficient than getting and setting each
+/// conversation individually.  The config is only marked dirty if something actually changes.
+///
+/// As when setting a conversation, a `last_read` value older than the prune cutoff (30 days) is not
+/// stored, but the unread flags are still cleared.
+///
+/// Declaration:
+/// ```cpp
+/// SIZE_T convo_info_volatile_mark_read(
+///     [in]    config_object*  conf,
+///     [in]    int64_t         last_read,
+///     [in]    bool            one_to_one,
+///     [in]    bool            communities,
+///     [in]    bool            legacy_groups
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to the config object
+/// - `last_read` -- [in] The last read timestamp (unix epoch milliseconds) to apply
+/// - `one_to_one` -- [in] True to update 1-to-1 conversations
+/// - `communities` -- [in] True to update community conversations
+/// - `legacy_groups` -- [in] True to update legacy group conversations
+///
+/// Outputs:
+/// - `size_t` -- the number of conversations that were changed
+LIBSESSION_EXPORT size_t convo_info_volatile_mark_read(
+        config_object* conf,
+        int64_t last_read,
+        bool one_to_one,
+        bool communities,
+        bool legacy_groups);
+
 /// API: convo_info_volatile/convo_info_volatile_erase_1to1
 ///
 /// Erases a conversation from the conversation list.  Returns true if the conversation was found
@@ -469,6 +506,78 @@ LIBSESSION_EXPORT size_t convo_info_volatile_size_communities(const config_objec
 /// - `size_t` -- number of legacy groups
 LIBSESSION_EXPORT size_t convo_info_volatile_size_legacy_groups(const config_object* conf);
 
+/// API: convo_info_volatile/convo_info_volatile_size_unread
+///
+/// Returns the number of conversations with the unread flag set.
+///
+/// Declaration:
+/// ```cpp
+/// SIZE_T convo_info_volatile_size_unread(
+///     [in]    const config_object*    conf
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to the config object
+///
+/// Outputs:
+/// - `size_t` -- number of unread conversations
+LIBSESSION_EXPORT size_t convo_info_volatile_size_unread(const config_object* conf);
+
+/// API: convo_info_volatile/convo_info_volatile_size_unread_1to1
+///
+/// Returns the number of 1-to-1 conversations with the unread flag set.
+///
+/// Declaration:
+/// ```cpp
+/// SIZE_T convo_info_volatile_size_unread_1to1(
+///     [in]    const config_object*    conf
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to the config object
+///
+/// Outputs:
+/// - `size_t` -- number of unread 1-to-1 conversations
+LIBSESSION_EXPORT size_t convo_info_volatile_size_unread_1to1(const config_object* conf);
+
+/// API: convo_info_volatile/convo_info_volatile_size_unread_communities
+///
+/// Returns the number of community conversations with the unread flag set.
+///
+/// Declaration:
+/// ```cpp
+/// SIZE_T convo_info_volatile_size_unread_communities(
+///     [in]    const config_object*    conf
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to the config object
+///
+/// Outputs:
+/// - `size_t` -- number of unread communities
+LIBSESSION_EXPORT size_t convo_info_volatile_size_unread_communities(const config_object* conf);
+
+/// API: convo_info_volatile/convo_info_volatile_size_unread_legacy_groups
+///
+/// Returns the number of legacy group conversations with the unread flag set.
+///
+/// Declaration:
+/// ```cpp
+/// SIZE_T convo_info_volatile_size_unread_legacy_groups(
+///     [in]    const config_object*    conf
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to the config object
+///
+/// Outputs:
+/// - `size_t` -- number of unread legacy groups
+LIBSESSION_EXPORT size_t convo_info_volatile_size_unread_legacy_groups(const config_object* conf);
+
 typedef struct convo_info_volatile_iterator convo_info_volatile_iterator;
 
 /// API: convo_info_volatile/convo_info_volatile_iterator_new
@@ -580,6 +689,35 @@ LIBSESSION_EXPORT convo_info_volatile_iterator* convo_info_volatile_iterator_new
 LIBSESSION_EXPORT convo_info_volatile_iterator* convo_info_volatile_iterator_new_legacy_groups(
         const config_object* conf);
 
+/// API: convo_info_volatile/convo_info_volatile_iterator_new_most_recent
+///
+/// Starts a new iterator over the `limit` most recently read conversations (of any type), in order
+/// from most to least recent `last_read`.  If `unread_only` is true then only conversations with
+/// the `unread` flag set are included.  The iterator is used in the same way as one returned by
+/// `convo_info_volatile_iterator_new`.
+///
+/// The returned conversations are a snapshot taken when the iterator is created, so (unlike the
+/// other iterators) records may be modified while iterating.
+///
+/// Declaration:
+/// ```cpp
+/// CONVO_INFO_VOLATILE_ITERATOR* convo_info_volatile_iterator_new_most_recent(
+///     [in]    const config_object*    conf,
+///     [in]    size_t                  limit,
+///     [in]    bool                    unread_only
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to the config object
+/// - `limit` -- [in] Maximum number of conversations to iterate over
+/// - `unread_only` -- [in] If true, only include conversations with the unread flag set
+///
+/// Outputs:
+/// - `convo_info_volatile_iterator*` -- Iterator
+LIBSESSION_EXPORT convo_info_volatile_iterator* convo_info_volatile_iterator_new_most_recent(
+        const config_object* conf, size_t limit, bool unread_only);
+
 /// API: convo_info_volatile/convo_info_volatile_iterator_free
 ///
 /// Frees an iterator once no longer needed.
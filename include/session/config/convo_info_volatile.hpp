@@ -3,8 +3,13 @@
 #include <chrono>
 #include <cstddef>
 #include <iterator>
+#include <map>
 #include <memory>
+#include <optional>
 #include <session/config.hpp>
+#include <set>
+#include <tuple>
+#include <vector>
 
 #include "base.hpp"
 #include "community.hpp"
@@ -173,6 +178,18 @@ class ConvoInfoVolatile : public ConfigBase {
     /// - `const char*` - Will return "ConvoInfoVolatile"
     const char* encryption_domain() const override { return "ConvoInfoVolatile"; }
 
+    std::shared_ptr<const ConvoInfoVolatile> snapshot() const {
+        return std::static_pointer_cast<const ConvoInfoVolatile>(ConfigBase::snapshot());
+    }
+
+  protected:
+    ConvoInfoVolatile(const ConvoInfoVolatile& other, snapshot_t t);
+    std::shared_ptr<const ConfigBase> make_snapshot() const override {
+        return std::shared_ptr<const ConvoInfoVolatile>(new ConvoInfoVolatile{*this, snapshot_tag});
+    }
+
+  public:
+
     /// Our pruning ages.  We ignore added conversations that are more than PRUNE_LOW before now,
     /// and we actively remove (when doing a new push) any conversations that are more than
     /// PRUNE_HIGH before now.  Clients can mostly ignore these and just add all conversations; the
@@ -249,6 +266,18 @@ class ConvoInfoVolatile : public ConfigBase {
     /// - `std::optional<convo::community>` - Returns a community
     std::optional<convo::community> get_community(std::string_view partial_url) const;
 
+    /// API: convo_info_volatile/ConvoInfoVolatile::get_community(key)
+    ///
+    /// Same as above, but takes a pre-canonicalized `community_key` (which can be constructed
+    /// once and reused) rather than a url and room that need to be canonicalized on every call.
+    ///
+    /// Inputs:
+    /// - `key` -- the community key (base url and room token)
+    ///
+    /// Outputs:
+    /// - `std::optional<convo::community>` - Returns a community
+    std::optional<convo::community> get_community(const community_key& key) const;
+
     /// API: convo_info_volatile/ConvoInfoVolatile::get_legacy_group
     ///
     /// Looks up and returns a legacy group conversation by ID.  The ID looks like a hex Session ID,
@@ -333,6 +362,20 @@ class ConvoInfoVolatile : public ConfigBase {
     /// - `convo::community` - Returns a group
     convo::community get_or_construct_community(std::string_view full_url) const;
 
+    /// API: convo_info_volatile/ConvoInfoVolatile::get_or_construct_community(key)
+    ///
+    /// Same as the above `get_or_construct_community`, but takes a pre-canonicalized
+    /// `community_key` rather than a base url and room.
+    ///
+    /// Inputs:
+    /// - `key` -- the community key (base url and room token)
+    /// - `pubkey` -- the binary, 32-byte server pubkey
+    ///
+    /// Outputs:
+    /// - `convo::community` - Returns a group
+    convo::community get_or_construct_community(
+            const community_key& key, ustring_view pubkey) const;
+
     /// API: convo_info_volatile/ConvoInfoVolatile::set
     ///
     /// Inserts or replaces existing conversation info.  For example, to update a 1-to-1
@@ -359,6 +402,33 @@ class ConvoInfoVolatile : public ConfigBase {
     void set(const convo::community& c);
     void set(const convo::any& c);  // Variant which can be any of the above
 
+    /// API: convo_info_volatile/ConvoInfoVolatile::mark_read
+    ///
+    /// Marks conversations as read in bulk: every selected conversation has its `unread` flag
+    /// cleared and its `last_read` value raised to `last_read` (conversations that already have a
+    /// later `last_read` value keep it).  This updates the conversations in a single pass through
+    /// the config data, and so is considerably more efficient than loading and calling `set()` on
+    /// each conversation individually.
+    ///
+    /// As with `set()`, a `last_read` value more than PRUNE_LOW before now is not stored, though
+    /// the selected conversations are still marked as read.
+    ///
+    /// The config is only marked dirty if at least one conversation actually changes.
+    ///
+    /// Inputs:
+    /// - `last_read` -- the last read timestamp (unix epoch milliseconds) to apply
+    /// - `oneto1` -- if true (the default) then 1-to-1 conversations are updated
+    /// - `communities` -- if true (the default) then community conversations are updated
+    /// - `legacy_groups` -- if true (the default) then legacy group conversations are updated
+    ///
+    /// Outputs:
+    /// - `size_t` -- the number of conversations that were changed
+    size_t mark_read(
+            int64_t last_read,
+            bool oneto1 = true,
+            bool communities = true,
+            bool legacy_groups = true);
+
   protected:
     void set_base(const convo::base& c, DictFieldProxy& info);
 
@@ -367,6 +437,50 @@ class ConvoInfoVolatile : public ConfigBase {
     DictFieldProxy community_field(
             const convo::community& og, ustring_view* get_pubkey = nullptr) const;
 
+  private:
+    // Location of a conversation in the config data: the top-level type key ('1', 'C', or 'o'),
+    // the binary session id (or, for communities, the base url), and the normalized room token
+    // (communities only; empty for other types).
+    using index_key = std::tuple<char, std::string, std::string>;
+    struct index_entry {
+        int64_t last_read;
+        bool unread;
+    };
+    using index_value = std::map<index_key, index_entry>::value_type;
+    struct by_last_read {
+        bool operator()(const index_value* a, const index_value* b) const {
+            return std::tie(a->second.last_read, a->first) <
+                   std::tie(b->second.last_read, b->first);
+        }
+    };
+
+    // Index of all conversations, plus the same conversations (and just the unread ones) ordered
+    // by last_read, so that pruning only has to look at the conversations that are actually old
+    // enough to be pruned, and so that we can find the most recent ones without sorting.  Our own
+    // set/erase methods keep these updated as they go; any other change to the data (a merge, or
+    // direct modification of `data`) is detected via the data version and causes the index to be
+    // lazily rebuilt the next time it is needed.
+    mutable std::map<index_key, index_entry> _index;
+    mutable std::set<const index_value*, by_last_read> _index_by_last_read, _unread_by_last_read;
+    mutable std::optional<uint64_t> _index_version;
+    // Number of indexed conversations with the unread flag set, by type.
+    mutable size_t _unread_1to1 = 0, _unread_communities = 0, _unread_legacy_groups = 0;
+    size_t& unread_count(char type) const;
+
+    // Rebuilds the index from the current data if anything changed since it was last synced.
+    void sync_index() const;
+    // Inserts or updates the index entry for a single conversation from its info dict.
+    void index_insert(index_key key, const dict& info) const;
+    // Removes a single conversation from the index, if present.
+    void index_erase(const index_key& key) const;
+    // Updates the index after we have modified the given conversation.
+    void reindex(index_key key, const DictFieldProxy& info);
+    // Removes a conversation given its raw index location; returns true if it existed.
+    bool erase_indexed(const index_key& key);
+    // Constructs the conversation object for an index entry; returns nullopt if the entry is not a
+    // valid conversation (e.g. a community with an invalid url or room).
+    std::optional<convo::any> load_indexed(const index_value& val) const;
+
   public:
     /// API: convo_info_volatile/ConvoInfoVolatile::erase_1to1
     ///
@@ -392,6 +506,17 @@ class ConvoInfoVolatile : public ConfigBase {
     /// - `bool` - Returns true if found and removed, otherwise false
     bool erase_community(std::string_view base_url, std::string_view room);
 
+    /// API: convo_info_volatile/ConvoInfoVolatile::erase_community(key)
+    ///
+    /// Same as above, but takes a pre-canonicalized `community_key`.
+    ///
+    /// Inputs:
+    /// - `key` -- the community key (base url and room token)
+    ///
+    /// Outputs:
+    /// - `bool` - Returns true if found and removed, otherwise false
+    bool erase_community(const community_key& key);
+
     /// API: convo_info_volatile/ConvoInfoVolatile::erase_legacy_group
     ///
     /// Removes a legacy group conversation.  Returns true if found and removed, false if not
@@ -452,6 +577,50 @@ class ConvoInfoVolatile : public ConfigBase {
     size_t size_communities() const;
     size_t size_legacy_groups() const;
 
+    /// API: convo_info_volatile/ConvoInfoVolatile::size_unread
+    ///
+    /// Returns the number of conversations that have the `unread` flag set.  These counts are
+    /// maintained as conversations are updated, and so do not require iterating through the
+    /// conversations.
+    ///
+    /// Declaration:
+    /// ```cpp
+    /// size_t size_unread() const;
+    /// size_t size_unread_1to1() const;
+    /// size_t size_unread_communities() const;
+    /// size_t size_unread_legacy_groups() const;
+    /// ```
+    ///
+    /// Inputs: None
+    ///
+    /// Outputs:
+    /// - `size_t` - Returns the number of unread conversations (of all types, or of a single type)
+    size_t size_unread() const;
+
+    /// Returns the number of unread 1-to-1, community, and legacy group conversations,
+    /// respectively.
+    size_t size_unread_1to1() const;
+    size_t size_unread_communities() const;
+    size_t size_unread_legacy_groups() const;
+
+    /// API: convo_info_volatile/ConvoInfoVolatile::most_recent
+    ///
+    /// Returns up to `limit` conversations (of any type), ordered from most to least recently read
+    /// (i.e. by descending `last_read`).  Conversations with the same `last_read` are returned in a
+    /// consistent (but otherwise unspecified) order.
+    ///
+    /// This does not need to sort the conversations: the order is maintained incrementally as
+    /// conversations are updated, so the cost of this call depends on `limit` rather than the
+    /// total number of conversations.
+    ///
+    /// Inputs:
+    /// - `limit` -- the maximum number of conversations to return
+    /// - `unread_only` -- if true then only conversations with the `unread` flag set are returned.
+    ///
+    /// Outputs:
+    /// - `std::vector<convo::any>` -- the most recently read conversations
+    std::vector<convo::any> most_recent(size_t limit, bool unread_only = false) const;
+
     /// API: convo_info_volatile/ConvoInfoVolatile::empty
     ///
     /// Returns true if the conversation list is empty.
@@ -511,6 +680,36 @@ class ConvoInfoVolatile : public ConfigBase {
     /// - `iterator` - Returns an iterator for the end of the conversations
     iterator end() const { return iterator{}; }
 
+    struct view_range;
+    /// API: convo_info_volatile/ConvoInfoVolatile::view
+    ///
+    /// Returns a lightweight, allocation-free alternative to the regular iterators.  Rather than
+    /// constructing a full conversation object for each record, the view iterators yield a
+    /// `convo_view` that references the stored record directly; values are only decoded when
+    /// requested through its accessors:
+    ///
+    /// ```cpp
+    ///     for (const auto& c : conversations.view()) {
+    ///         if (c.is_one_to_one() && c.unread()) {
+    ///             // c.id is the binary session id; c.id_hex() returns it in hex
+    ///         }
+    ///     }
+    /// ```
+    ///
+    /// This visits conversations in the same order as `begin()`.  As with the regular iterators, it
+    /// is NOT permitted to modify the config while iterating (which invalidates both the iterators
+    /// and any `convo_view` values obtained from them).
+    ///
+    /// Inputs:
+    /// - `one_to_one` -- if true (the default) then one-to-one conversations are included
+    /// - `communities` -- if true (the default) then community conversations are included
+    /// - `legacy_groups` -- if true (the default) then legacy group conversations are included
+    ///
+    /// Outputs:
+    /// - `view_range` -- iterable range of `convo_view` values
+    view_range view(
+            bool one_to_one = true, bool communities = true, bool legacy_groups = true) const;
+
     template <typename ConvoType>
     struct subtype_iterator;
 
@@ -577,6 +776,81 @@ class ConvoInfoVolatile : public ConfigBase {
             return copy;
         }
     };
+
+    /// Lightweight, non-owning view of a single conversation record, as yielded when iterating
+    /// over `view()`.  The fields reference the config data directly, and the record values are
+    /// only decoded when requested via the accessor methods.
+    struct convo_view {
+        /// The conversation type: '1' (one-to-one), 'o' (community), or 'C' (legacy group)
+        char type = 0;
+        /// The binary (33-byte) session id or legacy group id; for communities, the base url.
+        std::string_view id;
+        /// The (lower-case) room token; empty for non-communities.
+        std::string_view room;
+        /// The 32-byte server pubkey; empty for non-communities.
+        ustring_view pubkey;
+        /// The conversation record
+        const dict* info = nullptr;
+
+        bool is_one_to_one() const { return type == '1'; }
+        bool is_community() const { return type == 'o'; }
+        bool is_legacy_group() const { return type == 'C'; }
+
+        /// Returns the last read timestamp (unix epoch milliseconds) of the conversation.
+        int64_t last_read() const;
+        /// Returns true if the conversation is explicitly marked unread.
+        bool unread() const;
+        /// Returns the session id (or legacy group id) in hex; returns an empty string for
+        /// communities.
+        std::string id_hex() const;
+        /// Constructs the full conversation object for this record.  Throws if the stored
+        /// community url or room are not valid.
+        convo::any load() const;
+    };
+
+    struct view_iterator {
+      private:
+        dict::const_iterator _it_11, _end_11, _it_lgroup, _end_lgroup;
+        comm_view_helper _it_comm;
+        convo_view _val;
+        void _load_val();
+        view_iterator() = default;  // Constructs an end tombstone
+        view_iterator(const dict* one_to_one, const dict* communities, const dict* legacy_groups);
+        friend struct view_range;
+
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = convo_view;
+        using reference = const convo_view&;
+        using pointer = const convo_view*;
+        using difference_type = std::ptrdiff_t;
+
+        bool operator==(const view_iterator& other) const;
+        bool operator!=(const view_iterator& other) const { return !(*this == other); }
+        bool done() const {
+            return _it_11 == _end_11 && _it_comm.done() && _it_lgroup == _end_lgroup;
+        }
+        const convo_view& operator*() const { return _val; }
+        const convo_view* operator->() const { return &_val; }
+        view_iterator& operator++();
+        view_iterator operator++(int) {
+            auto copy{*this};
+            ++*this;
+            return copy;
+        }
+    };
+
+    struct view_range {
+      private:
+        const dict* _one_to_one = nullptr;
+        const dict* _communities = nullptr;
+        const dict* _legacy_groups = nullptr;
+        friend class ConvoInfoVolatile;
+
+      public:
+        view_iterator begin() const { return {_one_to_one, _communities, _legacy_groups}; }
+        view_iterator end() const { return {}; }
+    };
 };
 
 }  // namespace session::config
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "../types.hpp"
 
@@ -47,6 +51,75 @@ ustring encrypt(ustring_view message, ustring_view key_base, std::string_view do
 /// - `domain` -- short string for the keyed hash
 void encrypt_inplace(ustring& message, ustring_view key_base, std::string_view domain);
 
+/// API: encrypt/derived_key_cache
+///
+/// Cache of the encryption keys that `encrypt()` and `decrypt()` derive from the key base, message
+/// size, and domain.  Because messages are padded to a limited set of sizes, the same derivations
+/// are needed over and over by callers that repeatedly encrypt and decrypt with the same keys;
+/// passing a cache to `encrypt_inplace()` or `decrypt_many()` lets them skip the recomputation.
+///
+/// Derived keys are held in sodium-allocated (guarded and locked) memory, which is securely wiped
+/// by `clear()` and on destruction.  Key bases are identified by a caller-chosen id (typically an
+/// index into the caller's list of keys): the caller must call `clear()` whenever the key base that
+/// an id refers to changes.  Not thread-safe.
+class derived_key_cache {
+  public:
+    static constexpr size_t DEFAULT_CAPACITY = 32;
+
+    explicit derived_key_cache(size_t capacity = DEFAULT_CAPACITY);
+    ~derived_key_cache();
+
+    derived_key_cache(const derived_key_cache&) = delete;
+    derived_key_cache& operator=(const derived_key_cache&) = delete;
+
+    /// Returns a pointer to the 32-byte key derived from `key_base` (identified by `key_id`),
+    /// `message_size` and `domain`, deriving and caching it (evicting the least recently used key
+    /// when full) if not already cached.  The pointer remains valid until the next call to `get()`
+    /// or `clear()`.  Throws std::invalid_argument if the key base or domain are invalid.
+    const unsigned char* get(
+            size_t key_id, ustring_view key_base, uint64_t message_size, std::string_view domain);
+
+    /// Securely wipes and removes all cached keys.
+    void clear();
+
+    /// Returns the number of currently cached keys.
+    size_t size() const { return _entries.size(); }
+
+  private:
+    struct entry {
+        size_t key_id;
+        uint64_t message_size;
+        std::string domain;
+        uint64_t last_used;
+    };
+    std::vector<entry> _entries;  // entry i's derived key is at _keys + 32*i
+    unsigned char* _keys = nullptr;  // sodium_allocarray'ed, allocated on first use
+    size_t _capacity;
+    uint64_t _uses = 0;
+};
+
+/// API: encrypt/encrypt_inplace(raw)
+///
+/// Same as above, but encrypts a message within a caller-provided buffer rather than a `ustring`,
+/// so that callers that build the message in a pre-sized buffer need no reallocation.  The `size`
+/// bytes at `data` get encrypted in place and the extra data and nonce are written immediately
+/// after them: `data` must point to a buffer of at least `size + ENCRYPT_DATA_OVERHEAD` bytes.
+///
+/// Inputs:
+/// - `data` -- pointer to the message to encrypt, followed by ENCRYPT_DATA_OVERHEAD bytes of space
+/// - `size` -- size of the message to encrypt
+/// - `key_base` -- Fixed key that all clients, must be 32 bytes.
+/// - `domain` -- short string for the keyed hash
+/// - `cache` -- optional cache of derived keys to use
+/// - `key_id` -- the id of `key_base` in `cache`; ignored if `cache` is nullptr
+void encrypt_inplace(
+        unsigned char* data,
+        size_t size,
+        ustring_view key_base,
+        std::string_view domain,
+        derived_key_cache* cache = nullptr,
+        size_t key_id = 0);
+
 /// Constant amount of extra bytes required to be appended when encrypting.
 constexpr size_t ENCRYPT_DATA_OVERHEAD = 40;  // ABYTES + NPUBBYTES
 
@@ -81,6 +154,185 @@ ustring decrypt(ustring_view ciphertext, ustring_view key_base, std::string_view
 /// - `domain` -- short string for the keyed hash
 void decrypt_inplace(ustring& ciphertext, ustring_view key_base, std::string_view domain);
 
+/// Result of decrypting one message with `decrypt_many()`.
+struct decrypt_result {
+    /// The decrypted message, with any leading null padding removed.  Points into the arena passed
+    /// to `decrypt_many()`.  Empty if decryption failed.
+    ustring_view plaintext;
+    /// The index of the key that decrypted the message, or -1 if no key could decrypt it.
+    int key = -1;
+
+    explicit operator bool() const { return key >= 0; }
+};
+
+/// API: encrypt/decrypt_many
+///
+/// Decrypts a batch of values produced by `encrypt()`, trying each of the given keys in order for
+/// each message.  Each message is decrypted directly from the ciphertext into its own slot of
+/// `arena` (without any intermediate copy), and the returned plaintexts are views into the arena
+/// with the leading null padding added by `pad_message()` already stripped off.
+///
+/// `arena` is resized (only if needed) to hold all of the plaintexts; a caller decrypting many
+/// batches can pass the same arena each time to reuse its allocation.  Doing so (or otherwise
+/// modifying the arena) invalidates the plaintext views returned by the previous call.
+///
+/// Unlike `decrypt()`, failure to decrypt a message does not throw: instead the corresponding
+/// result has a `key` of -1.
+///
+/// Inputs:
+/// - `ciphertexts` -- messages to decrypt
+/// - `key_bases` -- keys to try, in order, for each message; each must be 32 bytes.
+/// - `domain` -- short string for the keyed hash
+/// - `arena` -- buffer into which the messages are decrypted
+/// - `cache` -- optional cache of derived keys to use; the ids of the keys are their indices in
+///   `key_bases`.
+///
+/// Outputs:
+/// - `std::vector<decrypt_result>` -- the result for each element of `ciphertexts`
+std::vector<decrypt_result> decrypt_many(
+        const std::vector<ustring_view>& ciphertexts,
+        const std::vector<ustring_view>& key_bases,
+        std::string_view domain,
+        ustring& arena,
+        derived_key_cache* cache = nullptr);
+
+/// API: encrypt/encrypt_batch
+///
+/// Encrypts a batch of independent messages in place, producing for each message exactly what
+/// `encrypt_inplace()` would.  Each message is still encrypted on its own, with the same libsodium
+/// calls as `encrypt_inplace()`: the only difference is that a large batch is split into
+/// contiguous slices that are encrypted in parallel.  The extra threads are started (and joined)
+/// by each call, so batches too small to make that worthwhile are encrypted on the calling thread.
+///
+/// All keys and the domain are validated before anything is encrypted: if any are invalid then
+/// std::invalid_argument is thrown and no message is modified.
+///
+/// Inputs:
+/// - `messages` -- messages to encrypt; each is replaced by its encrypted value
+/// - `key_bases` -- either a single key used for every message, or one key per message; each must
+///   be 32 bytes.
+/// - `domain` -- short string for the keyed hash
+/// - `threads` -- maximum number of threads to use, including the calling thread; 0 (the default)
+///   means one per hardware thread, and 1 means to not start any threads.  Small batches use fewer
+///   threads than requested.
+void encrypt_batch(
+        std::vector<ustring>& messages,
+        const std::vector<ustring_view>& key_bases,
+        std::string_view domain,
+        size_t threads = 0);
+
+/// API: encrypt/decrypt_batch
+///
+/// The inverse of `encrypt_batch()`: decrypts a batch of independent messages in place, each with
+/// its own key (or all with the same key).  Unlike `decrypt_inplace()`, failure to decrypt a
+/// message does not throw: instead such a message is cleared and has a false value in the returned
+/// vector.
+///
+/// Inputs:
+/// - `ciphertexts` -- messages to decrypt; each is replaced by its plaintext (or cleared, if
+///   decryption fails)
+/// - `key_bases` -- either a single key used for every message, or one key per message; each must
+///   be 32 bytes.
+/// - `domain` -- short string for the keyed hash
+/// - `threads` -- maximum number of threads to use, as in `encrypt_batch()`
+///
+/// Outputs:
+/// - `std::vector<bool>` -- whether each message was successfully decrypted
+std::vector<bool> decrypt_batch(
+        std::vector<ustring>& ciphertexts,
+        const std::vector<ustring_view>& key_bases,
+        std::string_view domain,
+        size_t threads = 0);
+
+/// API: encrypt/stream_encryptor
+///
+/// Streaming version of `encrypt()` for large messages that should not (or cannot) be held in
+/// memory all at once, e.g. when reading from a file or mmap'ed region.  Because the nonce is a
+/// hash of the entire plaintext, encrypting takes two passes over the plaintext:
+///
+/// 1. call `hash()` with each chunk of the plaintext, in order;
+/// 2. call `encrypt()` with each chunk of the same plaintext again, in order, writing out the
+///    returned (or output) ciphertext chunks;
+/// 3. call `finish()` and write out the returned value.
+///
+/// The concatenation of the output is identical to what `encrypt()` would return for the entire
+/// plaintext.  The chunks in the two passes do not need to be the same sizes, but the data must be
+/// identical: `finish()` throws std::logic_error if it is not (in which case the output must not be
+/// used).  Memory use is constant, regardless of the message size.
+class stream_encryptor {
+  public:
+    /// Constructs a stream encryptor.  Throws std::invalid_argument on invalid input (i.e. from an
+    /// invalid key_base or domain).
+    stream_encryptor(ustring_view key_base, std::string_view domain);
+    ~stream_encryptor();
+
+    stream_encryptor(stream_encryptor&&) noexcept;
+    stream_encryptor& operator=(stream_encryptor&&) noexcept;
+
+    /// First pass: adds the next chunk of plaintext to the nonce hash.  Throws std::logic_error if
+    /// called after `encrypt()`.
+    void hash(ustring_view chunk);
+
+    /// Second pass: encrypts the next chunk of plaintext, writing the ciphertext (of the same size)
+    /// to `out`, which may be the same as `chunk.data()` to encrypt in place.  The first call ends
+    /// the hashing pass.  Throws std::logic_error if called after `finish()`.
+    void encrypt(ustring_view chunk, unsigned char* out);
+
+    /// Same as above, but returns the encrypted chunk.
+    ustring encrypt(ustring_view chunk);
+
+    /// Finishes encryption, returning the final ENCRYPT_DATA_OVERHEAD bytes (authentication tag and
+    /// nonce) to be appended to the ciphertext.  Throws std::logic_error if the data given to
+    /// `encrypt()` was not the same as the data given to `hash()`.
+    ustring finish();
+
+  private:
+    struct state;
+    std::unique_ptr<state> _state;
+};
+
+/// API: encrypt/stream_decryptor
+///
+/// Streaming version of `decrypt()`.  Because the nonce and authentication tag are at the end of an
+/// encrypted message, the caller must provide those final ENCRYPT_DATA_OVERHEAD bytes (and the
+/// total size) of the encrypted message up front; the rest of the message is then passed to
+/// `decrypt()` in chunks, followed by a call to `finish()` to authenticate it.
+///
+/// NB: the decrypted chunks are *unauthenticated* until `finish()` returns successfully; callers
+/// must not act on (and should discard) the decrypted data if `finish()` throws.
+class stream_decryptor {
+  public:
+    /// Constructs a stream decryptor.  `ciphertext_size` is the total size of the encrypted message
+    /// (including the overhead), and `trailer` is its final ENCRYPT_DATA_OVERHEAD bytes.  Throws
+    /// std::invalid_argument on invalid input (i.e. from an invalid key_base, domain, or trailer),
+    /// and decrypt_error if `ciphertext_size` is too small.
+    stream_decryptor(
+            ustring_view key_base,
+            std::string_view domain,
+            size_t ciphertext_size,
+            ustring_view trailer);
+    ~stream_decryptor();
+
+    stream_decryptor(stream_decryptor&&) noexcept;
+    stream_decryptor& operator=(stream_decryptor&&) noexcept;
+
+    /// Decrypts the next chunk of the ciphertext, not including the trailer, writing the plaintext
+    /// (of the same size) to `out`, which may be the same as `chunk.data()` to decrypt in place.
+    /// Throws decrypt_error if given more data than the encrypted message contains.
+    void decrypt(ustring_view chunk, unsigned char* out);
+
+    /// Same as above, but returns the decrypted chunk.
+    ustring decrypt(ustring_view chunk);
+
+    /// Authenticates the decrypted message.  Throws decrypt_error if authentication fails or if not
+    /// all of the message was given to `decrypt()`.
+    void finish();
+
+  private:
+    struct state;
+    std::unique_ptr<state> _state;
+};
+
 /// Returns the target size of the message with padding, assuming an additional `overhead` bytes of
 /// overhead (e.g. from encrypt() overhead) will be appended.  Will always return a value >= s +
 /// overhead.
@@ -0,0 +1,93 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "base.h"
+
+/// The timed phases of config operations; these index `config_metrics.phases`.
+typedef enum config_metric_phase {
+    CONFIG_PHASE_DECRYPT = 0,     // decrypting the incoming messages of a merge (per merge)
+    CONFIG_PHASE_DECOMPRESS = 1,  // decompressing incoming messages (per compressed message)
+    CONFIG_PHASE_PARSE = 2,       // parsing and combining the messages being merged
+    CONFIG_PHASE_MERGE = 3,       // an entire `config_merge` call
+    CONFIG_PHASE_DIFF = 4,        // computing the diff of local changes
+    CONFIG_PHASE_SERIALIZE = 5,   // serializing the config message
+    CONFIG_PHASE_COMPRESS = 6,    // compressing an outgoing message
+    CONFIG_PHASE_ENCRYPT = 7,     // encrypting an outgoing message
+    CONFIG_PHASE_PUSH = 8,        // an entire `config_push` call
+    CONFIG_PHASE_DUMP = 9,        // an entire `config_dump` call
+} config_metric_phase;
+
+#define CONFIG_METRIC_PHASES 10
+
+/// Number of buckets in a latency histogram.  Bucket 0 counts durations under 1 microsecond, bucket
+/// `i` (for 0 < i < CONFIG_METRIC_BUCKETS-1) counts durations of at least 2^(i-1) but less than 2^i
+/// microseconds, and the last bucket counts everything longer.
+#define CONFIG_METRIC_BUCKETS 24
+
+typedef struct config_latency_histogram {
+    uint64_t count;     // Number of timed operations
+    uint64_t total_ns;  // Total duration of all timed operations, in nanoseconds
+    uint64_t max_ns;    // Longest single duration, in nanoseconds
+    uint64_t buckets[CONFIG_METRIC_BUCKETS];
+} config_latency_histogram;
+
+typedef struct config_metrics {
+    uint64_t merge_messages;    // Number of messages given to merge
+    uint64_t merge_bytes;       // Total size of the (encrypted) messages given to merge
+    uint64_t merge_cache_hits;  // Number of messages given to merge skipped as already processed
+    uint64_t decrypt_attempts;  // Number of decryption attempts (one per message per key tried)
+    uint64_t decrypt_failures;  // Number of messages that could not be decrypted with any key
+    uint64_t parse_failures;    // Number of decrypted messages that could not be parsed
+    uint64_t decompress_in_bytes;   // Total compressed size of decompressed incoming messages
+    uint64_t decompress_out_bytes;  // Total decompressed size of decompressed incoming messages
+    uint64_t compress_in_bytes;     // Total size of outgoing messages before compression
+    uint64_t compress_out_bytes;    // Total size of outgoing messages after (attempted) compression
+    uint64_t push_bytes;            // Total size of the (encrypted) messages returned by push
+    uint64_t dump_bytes;            // Total size of the dumps produced
+    uint64_t merge_conflicts;       // Number of merges that required conflict resolution
+    uint64_t lag_bytes_saved;       // Lagged diff bytes left out of pushes by adaptive lags
+
+    config_latency_histogram phases[CONFIG_METRIC_PHASES];
+} config_metrics;
+
+/// API: metrics/config_get_metrics
+///
+/// Copies the current performance metrics of the config object (accumulated since construction, or
+/// since the last `config_reset_metrics()` call) into `metrics`.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_get_metrics(
+///     [in]    const config_object*    conf,
+///     [out]   config_metrics*         metrics
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to the config object
+/// - `metrics` -- [out] Pointer to the struct to populate
+LIBSESSION_EXPORT void config_get_metrics(const config_object* conf, config_metrics* metrics);
+
+/// API: metrics/config_reset_metrics
+///
+/// Resets all performance metrics of the config object to zero.
+///
+/// Declaration:
+/// ```cpp
+/// VOID config_reset_metrics(
+///     [in]    config_object*    conf
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to the config object
+LIBSESSION_EXPORT void config_reset_metrics(config_object* conf);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace session::config {
+
+/// The timed phases of config operations.  The numeric values are the same as the C
+/// `CONFIG_PHASE_*` values.
+enum class metric_phase : int {
+    decrypt = 0,     // decrypting the incoming messages of a merge (timed per merge)
+    decompress = 1,  // decompressing incoming messages (per compressed message)
+    parse = 2,       // parsing and combining the set of messages being merged
+    merge = 3,       // an entire `merge()` call
+    diff = 4,        // computing the diff of local changes
+    serialize = 5,   // serializing the config message (excluding the diff)
+    compress = 6,    // compressing an outgoing message
+    encrypt = 7,     // padding and encrypting an outgoing message
+    push = 8,        // an entire `push()` call
+    dump = 9,        // an entire `dump()` call
+};
+
+inline constexpr size_t METRIC_PHASES = 10;
+
+/// Number of latency histogram buckets: bucket 0 counts durations under 1 microsecond, bucket `i`
+/// (for 0 < i < METRIC_BUCKETS-1) counts durations of at least 2^(i-1) but less than 2^i
+/// microseconds, and the last bucket counts everything longer (i.e. 2^22us, about 4.2s, or more).
+inline constexpr size_t METRIC_BUCKETS = 24;
+
+/// Snapshot of the latency histogram of one phase.
+struct latency_histogram {
+    uint64_t count = 0;     // Number of timed operations
+    uint64_t total_ns = 0;  // Total duration of all timed operations
+    uint64_t max_ns = 0;    // Longest single duration
+    std::array<uint64_t, METRIC_BUCKETS> buckets{};
+
+    /// Returns the mean duration in microseconds, or 0 if nothing has been timed.
+    double mean_us() const { return count ? total_ns / 1000.0 / count : 0.0; }
+
+    /// Returns an upper bound, in microseconds, of the `p`th percentile (0 < p <= 1) duration: that
+    /// is, the upper limit of the bucket containing it (or `max_ns` for the final bucket).  Returns
+    /// 0 if nothing has been timed.
+    double percentile_us(double p) const;
+};
+
+/// Snapshot of the metrics of a config object, as returned by `ConfigBase::metrics()`.  The fields
+/// are the same as (and documented in) the C `config_metrics` struct.
+struct metrics_snapshot {
+    uint64_t merge_messages = 0;
+    uint64_t merge_bytes = 0;
+    uint64_t merge_cache_hits = 0;
+    uint64_t decrypt_attempts = 0;
+    uint64_t decrypt_failures = 0;
+    uint64_t parse_failures = 0;
+    uint64_t decompress_in_bytes = 0;
+    uint64_t decompress_out_bytes = 0;
+    uint64_t compress_in_bytes = 0;
+    uint64_t compress_out_bytes = 0;
+    uint64_t push_bytes = 0;
+    uint64_t dump_bytes = 0;
+    uint64_t merge_conflicts = 0;
+    uint64_t lag_bytes_saved = 0;
+
+    std::array<latency_histogram, METRIC_PHASES> phases{};
+
+    const latency_histogram& operator[](metric_phase p) const {
+        return phases[static_cast<size_t>(p)];
+    }
+
+    /// Returns the overall compression ratio of outgoing messages (compressed size divided by
+    /// uncompressed size), or 1 if nothing has been compressed.
+    double compression_ratio() const {
+        return compress_in_bytes ? static_cast<double>(compress_out_bytes) / compress_in_bytes
+                                 : 1.0;
+    }
+};
+
+/// Metrics registry held by each config object.  Updates are relaxed atomic increments so that the
+/// metrics can be left enabled in production, and can be read (via `snapshot()`) from any thread.
+/// Updates themselves come from the (single) thread operating on the config object.
+class metrics_registry {
+  public:
+    std::atomic<uint64_t> merge_messages{0};
+    std::atomic<uint64_t> merge_bytes{0};
+    std::atomic<uint64_t> merge_cache_hits{0};
+    std::atomic<uint64_t> decrypt_attempts{0};
+    std::atomic<uint64_t> decrypt_failures{0};
+    std::atomic<uint64_t> parse_failures{0};
+    std::atomic<uint64_t> decompress_in_bytes{0};
+    std::atomic<uint64_t> decompress_out_bytes{0};
+    std::atomic<uint64_t> compress_in_bytes{0};
+    std::atomic<uint64_t> compress_out_bytes{0};
+    std::atomic<uint64_t> push_bytes{0};
+    std::atomic<uint64_t> dump_bytes{0};
+    std::atomic<uint64_t> merge_conflicts{0};
+    std::atomic<uint64_t> lag_bytes_saved{0};
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // Records a duration in the given phase's histogram.
+    void record(metric_phase phase, std::chrono::nanoseconds elapsed);
+
+    // RAII timer that records the time from construction to destruction in a phase histogram.
+    class timer {
+      public:
+        timer(metrics_registry& metrics, metric_phase phase) :
+                metrics{metrics}, phase{phase}, start{std::chrono::steady_clock::now()} {}
+        timer(const timer&) = delete;
+        timer& operator=(const timer&) = delete;
+        ~timer() { metrics.record(phase, std::chrono::steady_clock::now() - start); }
+
+      private:
+        metrics_registry& metrics;
+        metric_phase phase;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Starts a timer for the given phase, to be recorded when the returned object is destroyed.
+    timer time(metric_phase phase) { return {*this, phase}; }
+
+    metrics_snapshot snapshot() const;
+
+    void reset();
+
+  private:
+    struct histogram {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total_ns{0};
+        std::atomic<uint64_t> max_ns{0};
+        std::array<std::atomic<uint64_t>, METRIC_BUCKETS> buckets{};
+    };
+    std::array<histogram, METRIC_PHASES> _phases;
+};
+
+}  // namespace session::config
@@ -344,6 +344,168 @@ LIBSESSION_EXPORT bool user_groups_erase_community(
 /// - `bool` -- Returns True if conversation was found and removed
 LIBSESSION_EXPORT bool user_groups_erase_legacy_group(config_object* conf, const char* group_id);
 
+/// API: user_groups/user_groups_legacy_add_member
+///
+/// Adds a member to an existing legacy group stored in the config, or changes the admin status of
+/// an existing member.  This modifies only the affected member of the stored group, and so is more
+/// efficient than getting the group, modifying its members, and setting it again.
+///
+/// Declaration:
+/// ```cpp
+/// BOOL user_groups_legacy_add_member(
+///     [in]    config_object*      conf,
+///     [in]    const char*         group_id,
+///     [in]    const char*         session_id,
+///     [in]    bool                admin
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+/// - `group_id` -- [in] null terminated hex string of the legacy group id
+/// - `session_id` -- [in] null terminated hex string of the member's session id
+/// - `admin` -- [in] true if the member should be an admin
+///
+/// Outputs:
+/// - `bool` -- Returns true if the member was added or had its admin status changed.  Returns false
+///   if nothing changed, if the group does not exist, or if an id is invalid (in which case
+///   `conf->last_error` is set).
+LIBSESSION_EXPORT bool user_groups_legacy_add_member(
+        config_object* conf, const char* group_id, const char* session_id, bool admin);
+
+/// API: user_groups/user_groups_legacy_remove_member
+///
+/// Removes a member from an existing legacy group stored in the config.  This modifies only the
+/// affected member of the stored group.
+///
+/// Declaration:
+/// ```cpp
+/// BOOL user_groups_legacy_remove_member(
+///     [in]    config_object*      conf,
+///     [in]    const char*         group_id,
+///     [in]    const char*         session_id
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+/// - `group_id` -- [in] null terminated hex string of the legacy group id
+/// - `session_id` -- [in] null terminated hex string of the member's session id
+///
+/// Outputs:
+/// - `bool` -- Returns true if the member was found and removed.  Returns false if not found, or if
+///   an id is invalid (in which case `conf->last_error` is set).
+LIBSESSION_EXPORT bool user_groups_legacy_remove_member(
+        config_object* conf, const char* group_id, const char* session_id);
+
+/// API: user_groups/user_groups_legacy_set_admin
+///
+/// Changes the admin status of an existing member of a legacy group stored in the config.  Does
+/// nothing if the session id is not a member of the group.
+///
+/// Declaration:
+/// ```cpp
+/// BOOL user_groups_legacy_set_admin(
+///     [in]    config_object*      conf,
+///     [in]    const char*         group_id,
+///     [in]    const char*         session_id,
+///     [in]    bool                admin
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+/// - `group_id` -- [in] null terminated hex string of the legacy group id
+/// - `session_id` -- [in] null terminated hex string of the member's session id
+/// - `admin` -- [in] true to make the member an admin, false to make them a regular member
+///
+/// Outputs:
+/// - `bool` -- Returns true if the admin status was changed.  Returns false if the member was not
+///   found or already had the given status, or if an id is invalid (in which case
+///   `conf->last_error` is set).
+LIBSESSION_EXPORT bool user_groups_legacy_set_admin(
+        config_object* conf, const char* group_id, const char* session_id, bool admin);
+
+typedef struct ugroups_legacy_members_view ugroups_legacy_members_view;
+
+/// API: user_groups/ugroups_legacy_members_view_begin
+///
+/// Starts a new iterator over the members of a legacy group stored in the config.  Unlike
+/// `ugroups_legacy_members_begin` this does not require loading the group, and reads the member
+/// session ids directly from the config data, which is considerably cheaper for groups with many
+/// members.
+///
+/// Intended use is:
+/// ```cpp
+///     const unsigned char* session_id;
+///     bool admin;
+///     ugroups_legacy_members_view* it = ugroups_legacy_members_view_begin(conf, group_id);
+///     while (ugroups_legacy_members_view_next(it, &session_id, &admin)) {
+///         // session_id points at the 33-byte binary session id
+///     }
+///     ugroups_legacy_members_view_free(it);
+/// ```
+///
+/// It is NOT permitted to modify the config while iterating.
+///
+/// Declaration:
+/// ```cpp
+/// UGROUPS_LEGACY_MEMBERS_VIEW* ugroups_legacy_members_view_begin(
+///     [in]    config_object*      conf,
+///     [in]    const char*         group_id
+/// );
+/// ```
+///
+/// Inputs:
+/// - `conf` -- [in] Pointer to config_object object
+/// - `group_id` -- [in] null terminated hex string of the legacy group id
+///
+/// Outputs:
+/// - `ugroups_legacy_members_view*` -- The iterator (which yields no members if the group does
+///   not exist), or NULL if the group id is invalid (in which case `conf->last_error` is set).
+LIBSESSION_EXPORT ugroups_legacy_members_view* ugroups_legacy_members_view_begin(
+        config_object* conf, const char* group_id);
+
+/// API: user_groups/ugroups_legacy_members_view_next
+///
+/// Advances the iterator, setting `session_id` to point at the (binary, 33-byte) session id of the
+/// next member, and `admin` to the member's admin status.  The session id pointer remains valid
+/// until the config is modified.
+///
+/// Declaration:
+/// ```cpp
+/// BOOL ugroups_legacy_members_view_next(
+///     [in]    ugroups_legacy_members_view*    it,
+///     [out]   const unsigned char**           session_id,
+///     [out]   bool*                           admin
+/// );
+/// ```
+///
+/// Inputs:
+/// - `it` -- [in] The iterator
+/// - `session_id` -- [out] set to the member's 33-byte binary session id (not null terminated)
+/// - `admin` -- [out] set to the member's admin status
+///
+/// Outputs:
+/// - `bool` -- Returns true if a member was loaded, false if the iteration is finished.
+LIBSESSION_EXPORT bool ugroups_legacy_members_view_next(
+        ugroups_legacy_members_view* it, const unsigned char** session_id, bool* admin);
+
+/// API: user_groups/ugroups_legacy_members_view_free
+///
+/// Frees an iterator once no longer needed.
+///
+/// Declaration:
+/// ```cpp
+/// VOID ugroups_legacy_members_view_free(
+///     [in]    ugroups_legacy_members_view*    it
+/// );
+/// ```
+///
+/// Inputs:
+/// - `it` -- [in] The iterator
+LIBSESSION_EXPORT void ugroups_legacy_members_view_free(ugroups_legacy_members_view* it);
+
 typedef struct ugroups_legacy_members_iterator ugroups_legacy_members_iterator;
 
 /// API: user_groups/ugroups_legacy_members_begin
@@ -227,6 +227,18 @@ class UserGroups : public ConfigBase {
     /// - `const char*` - Returns "UserGroups"
     const char* encryption_domain() const override { return "UserGroups"; }
 
+    std::shared_ptr<const UserGroups> snapshot() const {
+        return std::static_pointer_cast<const UserGroups>(ConfigBase::snapshot());
+    }
+
+  protected:
+    UserGroups(const UserGroups& other, snapshot_t t) : ConfigBase{other, t} {}
+    std::shared_ptr<const ConfigBase> make_snapshot() const override {
+        return std::shared_ptr<const UserGroups>(new UserGroups{*this, snapshot_tag});
+    }
+
+  public:
+
     /// API: user_groups/UserGroups::get_community
     ///
     /// Looks up and returns a community (aka open group) conversation.  Takes the base URL and room
@@ -251,6 +263,18 @@ class UserGroups : public ConfigBase {
     /// is not used or needed by this call).
     std::optional<community_info> get_community(std::string_view partial_url) const;
 
+    /// API: user_groups/UserGroups::get_community(key)
+    ///
+    /// Same as above, but takes a pre-canonicalized `community_key` (which can be constructed
+    /// once and reused) rather than a url and room that need to be canonicalized on every call.
+    ///
+    /// Inputs:
+    /// - `key` -- the community key (base url and room token)
+    ///
+    /// Outputs:
+    /// - `std::optional<community_info>` - Returns the filled out community_info struct if found
+    std::optional<community_info> get_community(const community_key& key) const;
+
     /// API: user_groups/UserGroups::get_legacy_group
     ///
     /// Looks up and returns a legacy group by group ID (hex, looks like a Session ID).  Returns
@@ -313,6 +337,20 @@ class UserGroups : public ConfigBase {
     /// - `community_info` - Returns the filled out community_info struct
     community_info get_or_construct_community(std::string_view full_url) const;
 
+    /// API: user_groups/UserGroups::get_or_construct_community(key)
+    ///
+    /// Same as the above `get_or_construct_community`, but takes a pre-canonicalized
+    /// `community_key` rather than a base url and room.  If the community is not found then the
+    /// returned object's room will be the normalized (lower-case) room token of the key.
+    ///
+    /// Inputs:
+    /// - `key` -- the community key (base url and room token)
+    /// - `pubkey` -- the binary, 32-byte server pubkey
+    ///
+    /// Outputs:
+    /// - `community_info` - Returns the filled out community_info struct
+    community_info get_or_construct_community(const community_key& key, ustring_view pubkey) const;
+
     /// API: user_groups/UserGroups::get_or_construct_legacy_group
     ///
     /// Gets or constructs a blank legacy_group_info for the given group id.
@@ -350,6 +388,9 @@ class UserGroups : public ConfigBase {
     DictFieldProxy community_field(
             const community_info& og, ustring_view* get_pubkey = nullptr) const;
 
+    // Loads the stored details of the given community into it, if it exists.
+    std::optional<community_info> get_community_impl(community_info og) const;
+
     void set_base(const base_group_info& bg, DictFieldProxy& info) const;
 
   public:
@@ -366,6 +407,17 @@ class UserGroups : public ConfigBase {
     /// - `bool` - Returns true if found and removed, false otherwise
     bool erase_community(std::string_view base_url, std::string_view room);
 
+    /// API: user_groups/UserGroups::erase_community(key)
+    ///
+    /// Same as above, but takes a pre-canonicalized `community_key`.
+    ///
+    /// Inputs:
+    /// - `key` -- the community key (base url and room token)
+    ///
+    /// Outputs:
+    /// - `bool` - Returns true if found and removed, false otherwise
+    bool erase_community(const community_key& key);
+
     /// API: user_groups/UserGroups::erase_legacy_group
     ///
     /// Removes a legacy group conversation.  Returns true if found and removed, false if not
@@ -378,6 +430,86 @@ class UserGroups : public ConfigBase {
     /// - `bool` - Returns true if found and removed, false otherwise
     bool erase_legacy_group(std::string_view pubkey_hex);
 
+    /// API: user_groups/UserGroups::add_member
+    ///
+    /// Adds a member to an existing legacy group, or updates the admin status of an existing
+    /// member.  Unlike loading the group, modifying its `members()` and passing it to `set()`, this
+    /// only touches the affected member entries in the stored group, which is considerably more
+    /// efficient for groups with many members.
+    ///
+    /// A session id stored as both a member and an admin (which other clients could produce) is
+    /// treated as a regular member, as when loading the group; this method and `set_admin` leave
+    /// it stored with just the requested status.
+    ///
+    /// Throws std::invalid_argument if the group id or session id is invalid.
+    ///
+    /// Inputs:
+    /// - `group_id` -- legacy group ID (hex, looks like a session ID)
+    /// - `session_id` -- hex session id of the member to add
+    /// - `admin` -- true if the member should be an admin, false for a regular member
+    ///
+    /// Outputs:
+    /// - `bool` -- true if the member was added or had its admin status changed; false if the
+    ///   member was already present with the given admin status, or if the group does not exist.
+    bool add_member(std::string_view group_id, std::string_view session_id, bool admin = false);
+
+    /// API: user_groups/UserGroups::remove_member
+    ///
+    /// Removes a member (or admin) from an existing legacy group, touching only the affected
+    /// member entry of the stored group.  Throws std::invalid_argument if the group id or session
+    /// id is invalid.
+    ///
+    /// Inputs:
+    /// - `group_id` -- legacy group ID (hex, looks like a session ID)
+    /// - `session_id` -- hex session id of the member to remove
+    ///
+    /// Outputs:
+    /// - `bool` -- true if the member was found and removed, false otherwise.
+    bool remove_member(std::string_view group_id, std::string_view session_id);
+
+    /// API: user_groups/UserGroups::set_admin
+    ///
+    /// Changes the admin status of an existing member of a legacy group, touching only the
+    /// affected member entry of the stored group.  Unlike `add_member` this does nothing if the
+    /// session id is not already a member of the group.  Throws std::invalid_argument if the group
+    /// id or session id is invalid.
+    ///
+    /// Inputs:
+    /// - `group_id` -- legacy group ID (hex, looks like a session ID)
+    /// - `session_id` -- hex session id of the member
+    /// - `admin` -- true to make the member an admin, false to make the member a regular member
+    ///
+    /// Outputs:
+    /// - `bool` -- true if the member's admin status was changed, false if the member was not
+    ///   found or already had the given status.
+    bool set_admin(std::string_view group_id, std::string_view session_id, bool admin);
+
+    struct legacy_members_view;
+    /// API: user_groups/UserGroups::legacy_members
+    ///
+    /// Returns a lightweight view over the members of a legacy group that reads directly from the
+    /// stored member and admin sets, without loading the group or materializing (hex) member
+    /// strings.  This is the preferred way to enumerate the members of large groups:
+    /// ```cpp
+    ///     for (const auto& m : usergroups.legacy_members(group_id)) {
+    ///         // m.session_id is the 33-byte binary session id, m.admin is the admin flag
+    ///     }
+    /// ```
+    ///
+    /// Members are visited in session id order (the same order as `legacy_group_info::members()`).
+    /// The returned view (and its iterators) reference the config data and are invalidated by any
+    /// modification of the config.
+    ///
+    /// Throws std::invalid_argument if the group id is invalid.  If the group does not exist the
+    /// returned view is empty.
+    ///
+    /// Inputs:
+    /// - `group_id` -- legacy group ID (hex, looks like a session ID)
+    ///
+    /// Outputs:
+    /// - `legacy_members_view` -- iterable view of the group's members.
+    legacy_members_view legacy_members(std::string_view group_id) const;
+
     /// API: user_groups/UserGroups::erase
     ///
     /// Removes a conversation taking the community_info or legacy_group_info instance (rather than
@@ -477,6 +609,34 @@ class UserGroups : public ConfigBase {
     /// - `iterator` - Returns an iterator for the end of the groups
     iterator end() const { return iterator{}; }
 
+    struct view_range;
+    /// API: user_groups/UserGroups::view
+    ///
+    /// Returns a lightweight, allocation-free alternative to the regular iterators.  Rather than
+    /// constructing a full group object for each record, the view iterators yield a `group_view`
+    /// that references the stored record directly; values are only decoded when requested through
+    /// its accessors:
+    ///
+    /// ```cpp
+    ///     for (const auto& g : usergroups.view()) {
+    ///         if (g.is_legacy_group() && g.priority() > 0) {
+    ///             // g.id is the binary group id; g.id_hex() returns it in hex
+    ///         }
+    ///     }
+    /// ```
+    ///
+    /// This visits groups in the same order as `begin()`.  As with the regular iterators, it is NOT
+    /// permitted to modify the config while iterating (which invalidates both the iterators and any
+    /// `group_view` values obtained from them).
+    ///
+    /// Inputs:
+    /// - `communities` -- if true (the default) then communities are included
+    /// - `legacy_groups` -- if true (the default) then legacy groups are included
+    ///
+    /// Outputs:
+    /// - `view_range` -- iterable range of `group_view` values
+    view_range view(bool communities = true, bool legacy_groups = true) const;
+
     template <typename GroupType>
     struct subtype_iterator;
 
@@ -539,6 +699,131 @@ class UserGroups : public ConfigBase {
             return copy;
         }
     };
+
+    /// Member value yielded when iterating a `legacy_members_view`.  `session_id` is the binary,
+    /// 33-byte session id and points directly into the config data.
+    struct legacy_member {
+        std::string_view session_id;
+        bool admin = false;
+
+        /// Returns the session id as a 66-character hex string.
+        std::string session_id_hex() const;
+    };
+
+    struct legacy_members_iterator {
+      private:
+        config::set::const_iterator _m, _m_end, _a, _a_end;
+        legacy_member _val;
+        void _load_val();
+        legacy_members_iterator() = default;  // Constructs an end tombstone
+        legacy_members_iterator(const config::set* members, const config::set* admins);
+        friend struct legacy_members_view;
+
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = legacy_member;
+        using reference = const legacy_member&;
+        using pointer = const legacy_member*;
+        using difference_type = std::ptrdiff_t;
+
+        bool operator==(const legacy_members_iterator& other) const;
+        bool operator!=(const legacy_members_iterator& other) const { return !(*this == other); }
+        bool done() const { return _m == _m_end && _a == _a_end; }
+        const legacy_member& operator*() const { return _val; }
+        const legacy_member* operator->() const { return &_val; }
+        legacy_members_iterator& operator++();
+        legacy_members_iterator operator++(int) {
+            auto copy{*this};
+            ++*this;
+            return copy;
+        }
+    };
+
+    struct legacy_members_view {
+      private:
+        const config::set* _members = nullptr;
+        const config::set* _admins = nullptr;
+        friend class UserGroups;
+
+      public:
+        legacy_members_iterator begin() const { return {_members, _admins}; }
+        legacy_members_iterator end() const { return {}; }
+        bool empty() const { return begin().done(); }
+    };
+
+    /// Lightweight, non-owning view of a single group record, as yielded when iterating over
+    /// `view()`.  The fields reference the config data directly, and the record values are only
+    /// decoded when requested via the accessor methods.
+    struct group_view {
+        /// The group type: 'o' (community) or 'C' (legacy group)
+        char type = 0;
+        /// The binary (33-byte) legacy group id; for communities, the base url.
+        std::string_view id;
+        /// The (lower-case) room token; empty for legacy groups.
+        std::string_view room;
+        /// The 32-byte server pubkey; empty for legacy groups.
+        ustring_view pubkey;
+        /// The group record
+        const dict* info = nullptr;
+
+        bool is_community() const { return type == 'o'; }
+        bool is_legacy_group() const { return type == 'C'; }
+
+        /// Accessors for the fields of `base_group_info`
+        int priority() const;
+        int64_t joined_at() const;
+        notify_mode notifications() const;
+        int64_t mute_until() const;
+        /// Returns the stored group name, for legacy groups, or the room name (with its original
+        /// capitalization) for communities.
+        std::string_view name() const;
+        /// Returns the legacy group id in hex; returns an empty string for communities.
+        std::string id_hex() const;
+        /// Constructs the full group object for this record.  Throws if the stored community url
+        /// or room are not valid.
+        any_group_info load() const;
+    };
+
+    struct view_iterator {
+      private:
+        comm_view_helper _it_comm;
+        dict::const_iterator _it_legacy, _end_legacy;
+        group_view _val;
+        void _load_val();
+        view_iterator() = default;  // Constructs an end tombstone
+        view_iterator(const dict* communities, const dict* legacy_groups);
+        friend struct view_range;
+
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = group_view;
+        using reference = const group_view&;
+        using pointer = const group_view*;
+        using difference_type = std::ptrdiff_t;
+
+        bool operator==(const view_iterator& other) const;
+        bool operator!=(const view_iterator& other) const { return !(*this == other); }
+        bool done() const { return _it_comm.done() && _it_legacy == _end_legacy; }
+        const group_view& operator*() const { return _val; }
+        const group_view* operator->() const { return &_val; }
+        view_iterator& operator++();
+        view_iterator operator++(int) {
+            auto copy{*this};
+            ++*this;
+            return copy;
+        }
+    };
+
+    struct view_range {
+      private:
+        const dict* _communities = nullptr;
+        const dict* _legacy_groups = nullptr;
+        friend class UserGroups;
+
+      public:
+        view_iterator begin() const { return {_communities, _legacy_groups}; }
+        view_iterator end() const { return {}; }
+    };
 };
 
 }  // namespace session::config
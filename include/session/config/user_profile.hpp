@@ -25,7 +25,7 @@ using namespace std::literals;
 ///     omitted if the setting has not been explicitly set (or has been explicitly cleared for some
 ///     reason).
 
-class UserProfile final : public ConfigBase {
+class UserProfile : public ConfigBase {
 
   public:
     // No default constructor
@@ -69,6 +69,18 @@ class UserProfile final : public ConfigBase {
     /// - `const char*` - Will return "UserProfile"
     const char* encryption_domain() const override { return "UserProfile"; }
 
+    std::shared_ptr<const UserProfile> snapshot() const {
+        return std::static_pointer_cast<const UserProfile>(ConfigBase::snapshot());
+    }
+
+  protected:
+    UserProfile(const UserProfile& other, snapshot_t t) : ConfigBase{other, t} {}
+    std::shared_ptr<const ConfigBase> make_snapshot() const override {
+        return std::shared_ptr<const UserProfile>(new UserProfile{*this, snapshot_tag});
+    }
+
+  public:
+
     /// API: user_profile/UserProfile::get_name
     ///
     /// Returns the user profile name, or std::nullopt if there is no profile name set.
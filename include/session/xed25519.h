@@ -4,6 +4,8 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
 /// XEd25519-signed a message given a curve25519 privkey and message.  Writes the 64-byte signature
 /// to `sig` on success and returns 0.  Returns non-zero on failure.
 __attribute__((warn_unused_result)) int session_xed25519_sign(
@@ -20,6 +22,22 @@ __attribute__((warn_unused_result)) int session_xed25519_verify(
         const unsigned char* msg,
         const unsigned int msg_len);
 
+/// Verifies a batch of `n` XEd25519-signed messages.  `signatures`, `pubkeys`, `msgs`, and
+/// `msg_lens` are arrays of `n` elements, where element `i` of each describes the `i`th signature:
+/// a 64-byte signature, 32-byte curve25519 pubkey, the message, and message length.  If `results`
+/// is non-NULL then `results[i]` is set to 1 if signature `i` verified and 0 if it did not.
+///
+/// Returns 0 if every signature verifies successfully, non-zero if any failed.  This is equivalent
+/// to, but faster than, calling `session_xed25519_verify()` on each message when the batch is large
+/// or contains repeated pubkeys.
+__attribute__((warn_unused_result)) int session_xed25519_verify_batch(
+        unsigned char* results /* n-element output buffer, or NULL */,
+        const unsigned char* const* signatures /* n x 64 bytes */,
+        const unsigned char* const* pubkeys /* n x 32 bytes */,
+        const unsigned char* const* msgs,
+        const size_t* msg_lens,
+        size_t n);
+
 /// Given a curve25519 pubkey, this writes the associated XEd25519-derived Ed25519 pubkey into
 /// ed25519_pubkey.  Note, however, that there are *two* possible Ed25519 pubkeys that could result
 /// in a given curve25519 pubkey: this always returns the positive value.  You can get the other
@@ -29,6 +47,53 @@ __attribute__((warn_unused_result)) int session_xed25519_pubkey(
         unsigned char* ed25519_pubkey /* 32-byte output buffer */,
         const unsigned char* curve25519_pubkey /* 32 bytes */);
 
+/// Opaque verification context for verifying many signatures from the same curve25519 pubkey,
+/// without converting the pubkey to its Ed25519 pubkey for every verification.
+typedef struct session_xed25519_verifier session_xed25519_verifier;
+
+/// Creates a verification context for the given 32-byte curve25519 pubkey.  Returns NULL on
+/// failure.  The returned pointer must be freed with `session_xed25519_verifier_free()`.
+__attribute__((warn_unused_result)) session_xed25519_verifier* session_xed25519_verifier_new(
+        const unsigned char* curve25519_pubkey /* 32 bytes */);
+
+/// Frees a verification context created by `session_xed25519_verifier_new()`.
+void session_xed25519_verifier_free(session_xed25519_verifier* verifier);
+
+/// Verifies an XEd25519-signed message using a verification context.  Returns 0 if the signature
+/// verifies successfully, non-zero on failure.
+__attribute__((warn_unused_result)) int session_xed25519_verifier_verify(
+        const session_xed25519_verifier* verifier,
+        const unsigned char* signature /* 64 bytes */,
+        const unsigned char* msg,
+        const unsigned int msg_len);
+
+/// Opaque signing context for signing many messages with the same curve25519 privkey, without
+/// recomputing the privkey's Ed25519 conversion for every signature.
+typedef struct session_xed25519_signer session_xed25519_signer;
+
+/// Creates a signing context for the given 32-byte curve25519 privkey.  Returns NULL on failure.
+/// The returned pointer must be freed with `session_xed25519_signer_free()`, which also wipes the
+/// private key.
+__attribute__((warn_unused_result)) session_xed25519_signer* session_xed25519_signer_new(
+        const unsigned char* curve25519_privkey /* 32 bytes */);
+
+/// Frees (and wipes) a signing context created by `session_xed25519_signer_new()`.
+void session_xed25519_signer_free(session_xed25519_signer* signer);
+
+/// XEd25519-signs a message using a signing context.  Writes the 64-byte signature to `signature`
+/// and returns 0 on success; returns non-zero on failure.  The signature is the same as
+/// `session_xed25519_sign()` would produce with the signing context's privkey.
+__attribute__((warn_unused_result)) int session_xed25519_signer_sign(
+        const session_xed25519_signer* signer,
+        unsigned char* signature /* 64 byte buffer */,
+        const unsigned char* msg,
+        const unsigned int msg_len);
+
+/// Writes the (positive) XEd25519 Ed25519 pubkey of a signing context into `ed25519_pubkey`.
+void session_xed25519_signer_pubkey(
+        const session_xed25519_signer* signer,
+        unsigned char* ed25519_pubkey /* 32-byte output buffer */);
+
 #ifdef __cplusplus
 }
 #endif
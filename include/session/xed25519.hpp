@@ -2,6 +2,8 @@
 #include <array>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 namespace session::xed25519 {
 
@@ -14,6 +16,39 @@ std::array<unsigned char, 64> sign(
 /// "Softer" version that takes and returns strings of regular chars
 std::string sign(std::string_view curve25519_privkey /* 32 bytes */, std::string_view msg);
 
+/// XEd25519 signing context for signing many messages with the same curve25519 privkey.  `sign()`
+/// has to convert the privkey into an Ed25519 pubkey (and possibly negate the private scalar) on
+/// every call; this does it just once, at construction, and reuses the results for every signature.
+/// The private scalar is wiped when the signer is destroyed.
+class signer {
+  public:
+    /// Constructs a signer from a 32-byte curve25519 privkey.  Throws std::invalid_argument if the
+    /// key is not 32 bytes.
+    explicit signer(ustring_view curve25519_privkey);
+
+    /// "Softer" version that takes a string of regular chars
+    explicit signer(std::string_view curve25519_privkey);
+
+    signer(const signer&) = default;
+    signer& operator=(const signer&) = default;
+    ~signer();
+
+    /// XEd25519-signs a message; the result is the same as `xed25519::sign()` with the privkey this
+    /// signer was constructed with.
+    std::array<unsigned char, 64> sign(ustring_view msg) const;
+
+    /// "Softer" version that takes and returns strings of regular chars
+    std::string sign(std::string_view msg) const;
+
+    /// The (always positive) XEd25519 Ed25519 pubkey that signatures verify against; this is the
+    /// same as `xed25519::pubkey()` of the curve25519 pubkey.
+    const std::array<unsigned char, 32>& ed25519_pubkey() const { return A; }
+
+  private:
+    std::array<unsigned char, 32> a;  // Private scalar, negated if needed to make A positive
+    std::array<unsigned char, 32> A;  // Ed25519 pubkey
+};
+
 /// Verifies a curve25519 message allegedly signed by the given curve25519 pubkey
 [[nodiscard]] bool verify(
         ustring_view signature /* 64 bytes */,
@@ -26,12 +61,82 @@ std::string sign(std::string_view curve25519_privkey /* 32 bytes */, std::string
         std::string_view curve25519_pubkey /* 32 bytes */,
         std::string_view msg);
 
+/// XEd25519 verification context for verifying many signatures from the same curve25519 pubkey: the
+/// pubkey is converted to its Ed25519 pubkey once, at construction, rather than on every
+/// verification.  A verifier can be used directly as a `ConfigMessage::verify_callable`.
+class verifier {
+  public:
+    /// Constructs a verifier for a 32-byte curve25519 pubkey.  Throws std::invalid_argument if the
+    /// key is not 32 bytes.
+    explicit verifier(ustring_view curve25519_pubkey);
+
+    /// "Softer" version that takes a string of regular chars
+    explicit verifier(std::string_view curve25519_pubkey);
+
+    /// Verifies a signature of a message; returns the same result as `xed25519::verify()` with
+    /// this verifier's pubkey, except that a signature of the wrong size simply fails.
+    [[nodiscard]] bool verify(ustring_view signature /* 64 bytes */, ustring_view msg) const;
+
+    /// "Softer" version that takes strings of regular chars
+    [[nodiscard]] bool verify(
+            std::string_view signature /* 64 bytes */, std::string_view msg) const;
+
+    /// Verifies a signature with arguments in the order of `ConfigMessage::verify_callable`, i.e.
+    /// the signed data followed by the signature.
+    bool operator()(ustring_view data, ustring_view signature) const {
+        return verify(signature, data);
+    }
+
+    /// Verifies a batch of (data, signature) pairs, returning which signatures verified.
+    std::vector<bool> verify_batch(
+            const std::vector<std::pair<ustring_view, ustring_view>>& data_sigs) const;
+
+    /// The (positive) Ed25519 pubkey that signatures are verified against.
+    const std::array<unsigned char, 32>& ed25519_pubkey() const { return A; }
+
+  private:
+    std::array<unsigned char, 32> A;
+};
+
+/// One signature to check with `verify_batch()`.  The views must remain valid for the duration of
+/// the call.
+struct verify_item {
+    ustring_view signature;          // 64 bytes
+    ustring_view curve25519_pubkey;  // 32 bytes
+    ustring_view msg;
+};
+
+/// Verifies a batch of XEd25519 signatures, returning a vector of the same size as `items` where
+/// each element is true if the corresponding signature verified.  An item with a signature or
+/// pubkey of the wrong size is simply reported as failed.
+///
+/// This gives the same results as calling `verify()` on each item, but is cheaper for large
+/// batches: each distinct pubkey is converted to its Ed25519 pubkey only once, and the field
+/// inversions the conversions require are combined into a single inversion for the whole batch.
+std::vector<bool> verify_batch(const std::vector<verify_item>& items);
+
+/// Verifies a batch of messages all signed by the same curve25519 pubkey (e.g. a set of config
+/// messages being merged).  Each element of `data_sigs` is a pair of the signed data and its
+/// 64-byte signature, in the same order as the arguments of a `ConfigMessage::verify_callable`.
+/// Returns a vector of the same size as `data_sigs` indicating which signatures verified.  Throws
+/// std::invalid_argument if the pubkey is not 32 bytes.
+std::vector<bool> verify_batch(
+        ustring_view curve25519_pubkey,
+        const std::vector<std::pair<ustring_view, ustring_view>>& data_sigs);
+
 /// Given a curve25519 pubkey, this returns the associated XEd25519-derived Ed25519 pubkey.  Note,
 /// however, that there are *two* possible Ed25519 pubkeys that could result in a given curve25519
 /// pubkey: this always returns the positive value.  You can get the other possibility (the
 /// negative) by flipping the sign bit, i.e. `returned_pubkey[31] |= 0x80`.
+///
+/// Conversions are remembered in a (thread-safe) cache of the `PUBKEY_CACHE_SIZE` most recently
+/// used pubkeys, which is shared with `verify()` and `verify_batch()`, so that pubkeys that get
+/// used repeatedly are only converted once.
 std::array<unsigned char, 32> pubkey(ustring_view curve25519_pubkey);
 
+/// The number of curve25519 -> Ed25519 pubkey conversions that `pubkey()` keeps cached.
+inline constexpr size_t PUBKEY_CACHE_SIZE = 64;
+
 /// "Softer" version that takes/returns strings of regular chars
 std::string pubkey(std::string_view curve25519_pubkey);
 
@@ -8,6 +8,7 @@
 #include <sodium/crypto_aead_xchacha20poly1305.h>
 #include <sodium/crypto_generichash_blake2b.h>
 
+#include <algorithm>
 #include <limits>
 #include <optional>
 #include <stdexcept>
@@ -391,6 +392,32 @@ namespace {
         return into;
     }
 
+    // Extracts the seqno/hash pairs of the lagged diffs of a serialized config message, without
+    // parsing the data or the diffs themselves.  Stops at (and returns whatever was extracted
+    // before) anything invalid.
+    std::vector<seqno_hash_t> peek_lagged(ustring_view serialized) {
+        std::vector<seqno_hash_t> lagged;
+        try {
+            oxenc::bt_dict_consumer dict{from_unsigned_sv(serialized)};
+            if (!dict.skip_until("<"))
+                return lagged;
+            auto in = dict.consume_list_consumer();
+            while (!in.is_finished()) {
+                auto sublist = in.consume_list_consumer();
+                seqno_hash_t seqno_hash{};
+                auto& [seqno, hash] = seqno_hash;
+                seqno = sublist.consume_integer<seqno_t>();
+                auto hash_str = sublist.consume_string_view();
+                if (hash_str.size() != hash.size())
+                    break;
+                std::memcpy(hash.data(), hash_str.data(), hash.size());
+                lagged.push_back(std::move(seqno_hash));
+            }
+        } catch (const std::exception&) {
+        }
+        return lagged;
+    }
+
     /// Applies a diff update to `data`, getting diff info from `diff` and diff data from `source`.
     /// NB: this doesn't clear empty sets/hashes, which needs to be done after applying all diffs.
     void apply_diff(dict& data, const oxenc::bt_dict& diff, const dict& source) {
@@ -464,8 +491,70 @@ namespace {
             }
         }
     }
+
+    // Collects the (scalar) elements added or removed by a set diff into `into`.
+    void set_diff_elements(const oxenc::bt_list& set_diff, set& into) {
+        for (const auto& part : set_diff)
+            if (auto* elems = std::get_if<oxenc::bt_list>(&part))
+                for (const auto& e : *elems)
+                    if (auto s = get_bt_scalar(e))
+                        into.insert(std::move(*s));
+    }
+
+    /// Returns true if every change made by `diff` is made again by at least one of the `later`
+    /// diffs.  When merging, diffs are applied in seqno order and later diffs reapply their values
+    /// from their own message's data, so a change that is redone later can't affect the merged
+    /// result no matter what other changes end up applied in between.
+    bool diff_overridden(
+            const oxenc::bt_dict& diff, const std::vector<const oxenc::bt_dict*>& later) {
+        for (const auto& [k, v] : diff) {
+            bool replaced = false;
+            std::vector<const oxenc::bt_dict*> later_dicts;
+            set later_elems;
+            for (const auto* l : later) {
+                auto it = l->find(k);
+                if (it == l->end())
+                    continue;
+                // A later scalar change (or removal) replaces the whole value:
+                if (get_bt_str(it->second)) {
+                    replaced = true;
+                    break;
+                }
+                if (auto* d = std::get_if<oxenc::bt_dict>(&it->second))
+                    later_dicts.push_back(d);
+                else if (auto* sd = std::get_if<oxenc::bt_list>(&it->second))
+                    set_diff_elements(*sd, later_elems);
+            }
+            if (replaced)
+                continue;
+
+            if (auto* d = std::get_if<oxenc::bt_dict>(&v)) {
+                if (!diff_overridden(*d, later_dicts))
+                    return false;
+            } else if (auto* sd = std::get_if<oxenc::bt_list>(&v)) {
+                set elems;
+                set_diff_elements(*sd, elems);
+                for (const auto& e : elems)
+                    if (!later_elems.count(e))
+                        return false;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
 }  // namespace
 
+std::optional<seqno_t> peek_seqno(ustring_view serialized) {
+    try {
+        oxenc::bt_dict_consumer dict{from_unsigned_sv(serialized)};
+        if (auto [k, v] = dict.next_integer<seqno_t>(); k == "#")
+            return v;
+    } catch (const std::exception&) {
+    }
+    return std::nullopt;
+}
+
 bool MutableConfigMessage::prune() {
     return prune_(data_).second;
 }
@@ -498,6 +587,9 @@ void MutableConfigMessage::increment_impl() {
     seqno_hash_.first++;
     seqno_hash_.second.fill(0);  // Not strictly necessary, but makes it obvious if used
     diff_.clear();
+    // The new message will need signing anew
+    signature_.clear();
+    verified_signature_ = false;
 }
 
 MutableConfigMessage::MutableConfigMessage(ConfigMessage&& m, const retain_seqno_t&) {
@@ -584,6 +676,7 @@ ConfigMessage::ConfigMessage(
                    to_unsigned(key.data()) < serialized.data() + serialized.size());
             to_verify = serialized.substr(0, to_unsigned(key.data()) - serialized.data() - 2);
             sig = to_unsigned_sv(dict.consume_string_view());
+            signature_ = sig;
         }
 
         if (!dict.is_finished())
@@ -608,15 +701,62 @@ ConfigMessage::ConfigMessage(
         sign_callable signer_,
         int lag,
         bool signature_optional,
-        std::function<void(size_t, const config_error&)> error_handler) :
+        std::function<void(size_t, const config_error&)> error_handler,
+        bool trust_first) :
         verifier{std::move(verifier_)}, signer{std::move(signer_)}, lag{lag} {
 
-    std::vector<std::pair<ConfigMessage, bool>> configs;  // [[config, redundant], ...]
-    for (size_t i = 0; i < serialized_confs.size(); i++) {
+    // Before parsing anything we peek at the seqno of each message so that we can parse them from
+    // highest to lowest seqno.  That lets us drop messages that are stale or redundant given some
+    // higher message without ever parsing their data, which matters when merging a large backlog
+    // (e.g. after a long offline period).  Only a message that fully parsed (and verified, if
+    // signed) is allowed to make other messages redundant.
+    std::vector<std::pair<size_t, std::optional<seqno_t>>> order;  // [[index, seqno], ...]
+    order.reserve(serialized_confs.size());
+    for (size_t i = 0; i < serialized_confs.size(); i++)
+        order.emplace_back(i, peek_seqno(serialized_confs[i]));
+    // Descending by seqno; ties stay in input order so that the first of any duplicates is the one
+    // we keep.  Messages without a valid seqno sort last (and will fail to parse below).
+    std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+        return a.second > b.second;
+    });
+
+    std::vector<std::pair<ConfigMessage, size_t>> configs;  // [[config, index], ...]
+    // Seqno/hash of every message included in the messages we have kept so far, either as the
+    // message itself or via its lagged diffs (or the lagged diffs of a redundant message).
+    std::set<seqno_hash_t> included;
+    for (const auto& [i, seqno] : order) {
         const auto& data = serialized_confs[i];
+        if (seqno && !configs.empty()) {
+            // Too old: `lag` or more behind the top seqno value (which is always the first message
+            // we kept, because of the sort order).
+            if (*seqno + lag <= configs.front().first.seqno())
+                continue;
+            // Redundant: a duplicate of, or already included in the diffs of, a kept message.  We
+            // only need to hash the message if something included has the same seqno.
+            if (auto it = included.lower_bound({*seqno, hash_t{}});
+                it != included.end() && it->first == *seqno) {
+                seqno_hash_t seqno_hash{*seqno, {}};
+                hash_msg(seqno_hash.second, data);
+                if (included.count(seqno_hash)) {
+                    // Anything included in this message's diffs is redundant as well:
+                    for (auto& lagged : peek_lagged(data))
+                        included.insert(std::move(lagged));
+                    continue;
+                }
+            }
+        }
         try {
-            ConfigMessage m{data, verifier, signer, lag, signature_optional};
-            configs.emplace_back(std::move(m), false);
+            ConfigMessage m{
+                    data,
+                    trust_first && i == 0 ? nullptr : verifier,
+                    signer,
+                    lag,
+                    signature_optional};
+            m.verifier = verifier;
+            included.insert(m.seqno_hash_);
+            for (const auto& [s_h, diff] : m.lagged_diffs_)
+                included.insert(s_h);
+            configs.emplace_back(std::move(m), i);
         } catch (const config_error& e) {
             if (error_handler)
                 error_handler(i, e);
@@ -627,54 +767,17 @@ ConfigMessage::ConfigMessage(
     if (configs.empty())
         throw config_error{"Config initialization failed: no valid config messages given"};
 
-    int64_t max_seqno = std::numeric_limits<int64_t>::min();
-
-    // prune out redundant messages (i.e. messages already included in another message's diff, and
-    // duplicates)
-    for (int i = 0; i < configs.size(); i++) {
-        auto& [conf, redundant] = configs[i];
-        if (conf.seqno() > max_seqno)
-            max_seqno = conf.seqno();
-
-        for (int j = 0; !redundant && j < configs.size(); j++) {
-            if (i == j)
-                continue;
-            const auto& conf2 = configs[j].first;
-            if (conf2.lagged_diffs_.count(conf.seqno_hash_))
-                redundant = true;  // conf[j] includes conf[i], so we don't need to keep [i]
-            else if (j < i && conf2.seqno_hash_ == conf.seqno_hash_)
-                redundant = true;  // Duplicate: some earlier conf[j] has the same seqno/hash
-        }
-    }
-
-    // prune out any messages that are too old (i.e. `lag` or more behind the top seqno value)
-    for (auto& [conf, redundant] : configs)
-        if (conf.seqno() + lag <= max_seqno)
-            redundant = true;
+    int64_t max_seqno = configs.front().first.seqno();
 
-    size_t curr_confs =
-            std::count_if(configs.begin(), configs.end(), [](const auto& c) { return !c.second; });
-    assert(curr_confs >= 1);
-
-    if (curr_confs == 1) {
+    if (configs.size() == 1) {
         // We have just one config left after all that, so we become it directly as-is
-        for (int i = 0; i < configs.size(); i++) {
-            if (!configs[i].second) {
-                *this = std::move(configs[i].first);
-                unmerged_ = i;
-                return;
-            }
-        }
-        assert(false);
+        *this = std::move(configs.front().first);
+        unmerged_ = static_cast<int>(configs.front().second);
+        return;
     }
 
     unmerged_ = -1;
 
-    // Clear any redundant messages
-    configs.erase(
-            std::remove_if(configs.begin(), configs.end(), [](const auto& c) { return c.second; }),
-            configs.end());
-
     // Sort whatever is left by seqno/hash in *descending* order for diff processing (descending
     // order so that higher seqno/hash configs get precedence if multiple merged configs have the
     // same change).
@@ -719,14 +822,16 @@ MutableConfigMessage::MutableConfigMessage(
         sign_callable signer,
         int lag,
         bool signature_optional,
-        std::function<void(size_t, const config_error&)> error_handler) :
+        std::function<void(size_t, const config_error&)> error_handler,
+        bool trust_first) :
         ConfigMessage{
                 serialized_confs,
                 std::move(verifier),
                 std::move(signer),
                 lag,
                 signature_optional,
-                std::move(error_handler)} {
+                std::move(error_handler),
+                trust_first} {
     if (!merged())
         increment_impl();
 }
@@ -774,9 +879,10 @@ ustring ConfigMessage::serialize_impl(const oxenc::bt_dict& curr_diff, bool enab
 
     {
         auto lags = outer.append_list("<");
+        int max_lag = serialized_lag > 0 ? std::min(serialized_lag, lag) : lag;
         for (auto& [seqno_hash, lag_data] : lagged_diffs_) {
             const auto& [lag_seqno, lag_hash] = seqno_hash;
-            if (lag_seqno <= seqno() - lag || lag_seqno >= seqno())
+            if (lag_seqno <= seqno() - max_lag || lag_seqno >= seqno())
                 continue;
             auto lag = lags.append_list();
             lag.append(lag_seqno);
@@ -792,7 +898,9 @@ ustring ConfigMessage::serialize_impl(const oxenc::bt_dict& curr_diff, bool enab
     unknown_it = append_unknown(outer, unknown_it, unknown_.end(), "~");
     assert(unknown_it == unknown_.end());
 
-    if (signer && enable_signing) {
+    if (!signature_.empty()) {
+        outer.append("~", from_unsigned_sv(signature_));
+    } else if (signer && enable_signing) {
         auto to_sign = to_unsigned_sv(outer.view());
         // The view contains the trailing "e", but we don't sign it (we are going to append the
         // signature there instead):
@@ -806,6 +914,45 @@ ustring ConfigMessage::serialize_impl(const oxenc::bt_dict& curr_diff, bool enab
     return ustring{to_unsigned_sv(outer.view())};
 }
 
+size_t ConfigMessage::omitted_lags_size() const {
+    size_t size = 0;
+    if (serialized_lag <= 0 || serialized_lag >= lag)
+        return size;
+    for (const auto& [seqno_hash, lag_data] : lagged_diffs_) {
+        const auto& [lag_seqno, lag_hash] = seqno_hash;
+        // Skip anything that serialize_impl either includes, or drops regardless of serialized_lag
+        if (lag_seqno <= seqno() - lag || lag_seqno > seqno() - serialized_lag ||
+            lag_seqno >= seqno())
+            continue;
+        oxenc::bt_list_producer lag_list;
+        lag_list.append(lag_seqno);
+        lag_list.append(view(lag_hash));
+        lag_list.append_bt(lag_data);
+        size += lag_list.view().size();
+    }
+    return size;
+}
+
+bool ConfigMessage::omitted_lags_overridden() const {
+    if (serialized_lag <= 0 || serialized_lag >= lag)
+        return true;
+    std::vector<const oxenc::bt_dict*> later{&diff_};
+    // Walk the lagged diffs from newest to oldest so that `later` always holds the diffs that are
+    // included and newer than the one we are looking at.
+    for (auto it = lagged_diffs_.rbegin(); it != lagged_diffs_.rend(); ++it) {
+        const auto& lag_seqno = it->first.first;
+        if (lag_seqno >= seqno())
+            continue;
+        if (lag_seqno <= seqno() - lag)
+            break;
+        if (lag_seqno > seqno() - serialized_lag)
+            later.push_back(&it->second);
+        else if (!diff_overridden(it->second, later))
+            return false;
+    }
+    return true;
+}
+
 const hash_t& MutableConfigMessage::hash() {
     return hash(serialize());
 }
@@ -2,17 +2,28 @@
 
 #include <oxenc/hex.h>
 #include <sodium/core.h>
+#include <sodium/crypto_generichash_blake2b.h>
+#include <sodium/crypto_sign_ed25519.h>
 #include <sodium/utils.h>
 #include <zstd.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "internal.hpp"
 #include "session/config/base.h"
 #include "session/config/encrypt.hpp"
 #include "session/export.h"
 #include "session/util.hpp"
+#include "session/xed25519.hpp"
 
 using namespace std::literals;
 
@@ -28,6 +39,8 @@ void ConfigBase::set_state(ConfigState s) {
 }
 
 MutableConfigMessage& ConfigBase::dirty() {
+    _data_version++;
+
     if (_state != ConfigState::Dirty) {
         set_state(ConfigState::Dirty);
         _config = std::make_unique<MutableConfigMessage>(*_config, increment_seqno);
@@ -38,6 +51,172 @@ MutableConfigMessage& ConfigBase::dirty() {
     throw std::runtime_error{"Internal error: unexpected dirty but non-mutable ConfigMessage"};
 }
 
+struct ConfigBase::sig_state {
+    // Maximum number of entries in `verified`
+    static constexpr size_t VERIFIED_LIMIT = 256;
+
+    // The Ed25519 pubkey that messages are signed and verified with
+    std::array<unsigned char, 32> pubkey;
+
+    // The Ed25519 secret key, if signing with an Ed25519 key
+    std::optional<std::array<unsigned char, 64>> ed25519_sk;
+
+    // The XEd25519 signer, if signing with an X25519 key
+    std::optional<xed25519::signer> xed25519;
+
+    // Hash of the data we most recently signed, and the signature, so that re-serializing an
+    // unchanged message (as happens with each `merge()` and `push()` of an unchanged config)
+    // reuses the signature rather than signing again.
+    std::optional<hash_t> signed_hash;
+    std::array<unsigned char, 64> signed_sig;
+
+    // Hashes of the (data, signature) pairs that have passed verification (or that we signed
+    // ourselves), so that we don't need to verify them again when we see them again.
+    // `verified_order` holds the same values in insertion order, for evicting the oldest.
+    std::set<hash_t> verified;
+    std::deque<hash_t> verified_order;
+
+    ~sig_state() {
+        if (ed25519_sk)
+            sodium_memzero(ed25519_sk->data(), ed25519_sk->size());
+    }
+
+    bool can_sign() const { return ed25519_sk || xed25519; }
+
+    static hash_t hash(ustring_view data, ustring_view sig = {}) {
+        hash_t h;
+        crypto_generichash_blake2b_state st;
+        crypto_generichash_blake2b_init(&st, nullptr, 0, h.size());
+        crypto_generichash_blake2b_update(&st, data.data(), data.size());
+        crypto_generichash_blake2b_update(&st, sig.data(), sig.size());
+        crypto_generichash_blake2b_final(&st, h.data(), h.size());
+        return h;
+    }
+
+    void add_verified(const hash_t& h) {
+        if (!verified.insert(h).second)
+            return;
+        verified_order.push_back(h);
+        if (verified_order.size() > VERIFIED_LIMIT) {
+            verified.erase(verified_order.front());
+            verified_order.pop_front();
+        }
+    }
+
+    ustring sign(ustring_view data) {
+        auto h = hash(data);
+        if (signed_hash != h) {
+            if (ed25519_sk)
+                crypto_sign_ed25519_detached(
+                        signed_sig.data(), nullptr, data.data(), data.size(), ed25519_sk->data());
+            else
+                signed_sig = xed25519->sign(data);
+            signed_hash = h;
+            add_verified(hash(data, {signed_sig.data(), signed_sig.size()}));
+        }
+        return {signed_sig.data(), signed_sig.size()};
+    }
+
+    bool verify(ustring_view data, ustring_view sig) {
+        if (sig.size() != signed_sig.size())
+            return false;
+        auto h = hash(data, sig);
+        if (verified.count(h))
+            return true;
+        if (0 != crypto_sign_ed25519_verify_detached(
+                         sig.data(), data.data(), data.size(), pubkey.data()))
+            return false;
+        add_verified(h);
+        return true;
+    }
+};
+
+ConfigMessage::sign_callable ConfigBase::message_signer() {
+    if (!_sig || !_sig->can_sign())
+        return nullptr;
+    return [sig = _sig.get()](ustring_view data) { return sig->sign(data); };
+}
+
+ConfigMessage::verify_callable ConfigBase::message_verifier() {
+    if (!_sig)
+        return nullptr;
+    return [sig = _sig.get()](ustring_view data, ustring_view signature) {
+        return sig->verify(data, signature);
+    };
+}
+
+void ConfigBase::update_sig_callbacks() {
+    _config->signer = message_signer();
+    _config->verifier = message_verifier();
+    clear_processed();
+}
+
+void ConfigBase::set_sig_keys(ustring_view secret) {
+    if (secret.size() != 64)
+        throw std::invalid_argument{"set_sig_keys failed: Ed25519 secret key must be 64 bytes"};
+    auto sig = std::make_unique<sig_state>();
+    std::memcpy(sig->pubkey.data(), secret.data() + 32, 32);
+    sig->ed25519_sk.emplace();
+    std::memcpy(sig->ed25519_sk->data(), secret.data(), 64);
+    _sig = std::move(sig);
+    update_sig_callbacks();
+}
+
+void ConfigBase::set_xed25519_sig_keys(ustring_view x25519_privkey) {
+    if (x25519_privkey.size() != 32)
+        throw std::invalid_argument{"set_xed25519_sig_keys failed: key must be 32 bytes"};
+    auto sig = std::make_unique<sig_state>();
+    sig->xed25519.emplace(x25519_privkey);
+    sig->pubkey = sig->xed25519->ed25519_pubkey();
+    _sig = std::move(sig);
+    update_sig_callbacks();
+}
+
+void ConfigBase::set_sig_pubkey(ustring_view pubkey) {
+    if (pubkey.size() != 32)
+        throw std::invalid_argument{"set_sig_pubkey failed: pubkey must be 32 bytes"};
+    auto sig = std::make_unique<sig_state>();
+    std::memcpy(sig->pubkey.data(), pubkey.data(), 32);
+    _sig = std::move(sig);
+    update_sig_callbacks();
+}
+
+void ConfigBase::set_xed25519_sig_pubkey(ustring_view x25519_pubkey) {
+    if (x25519_pubkey.size() != 32)
+        throw std::invalid_argument{"set_xed25519_sig_pubkey failed: pubkey must be 32 bytes"};
+    auto sig = std::make_unique<sig_state>();
+    sig->pubkey = xed25519::pubkey(x25519_pubkey);
+    _sig = std::move(sig);
+    update_sig_callbacks();
+}
+
+void ConfigBase::clear_sig_keys() {
+    _sig.reset();
+    update_sig_callbacks();
+}
+
+std::optional<std::array<unsigned char, 32>> ConfigBase::get_sig_pubkey() const {
+    if (!_sig)
+        return std::nullopt;
+    return _sig->pubkey;
+}
+
+bool ConfigBase::is_readonly() const {
+    return _sig && !_sig->can_sign();
+}
+
+void ConfigBase::set_adaptive_lags(bool enabled) {
+    _adaptive_lags = enabled;
+    raise_lags();
+}
+
+int ConfigBase::carried_lags() const {
+    int full = config_lags();
+    if (!_adaptive_lags || !_carried_lags)
+        return full;
+    return std::clamp(_carried_lags, std::min(std::max(2, min_config_lags()), full), full);
+}
+
 int ConfigBase::merge(const std::vector<std::pair<std::string, ustring>>& configs) {
     std::vector<std::pair<std::string, ustring_view>> config_views;
     config_views.reserve(configs.size());
@@ -58,6 +237,11 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
     if (_keys_size == 0)
         throw std::logic_error{"Cannot merge configs without any decryption keys"};
 
+    auto merge_timer = _metrics.time(metric_phase::merge);
+    metrics_registry::add(_metrics.merge_messages, configs.size());
+    for (auto& [hash, conf] : configs)
+        metrics_registry::add(_metrics.merge_bytes, conf.size());
+
     const auto old_seqno = _config->seqno();
     std::vector<std::string_view> all_hashes;
     std::vector<ustring_view> all_confs;
@@ -65,12 +249,44 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
     all_confs.reserve(configs.size() + 1);
     // We serialize our current config and include it in the list of configs to be merged, as if it
     // had already been pushed to the server (so that this code will be identical whether or not the
-    // value was pushed).
-    auto mine = _config->serialize();
+    // value was pushed).  Only a mutable message gets signed here: an immutable one must serialize
+    // exactly as it was loaded (i.e. with its original signature, if any), so that its hash stays
+    // the same as the hash that other messages refer to it by.
+    auto mine = serialize_config(dynamic_cast<MutableConfigMessage*>(_config.get()) != nullptr);
     all_hashes.emplace_back(_curr_hash);
     all_confs.emplace_back(mine);
 
-    std::vector<std::pair<std::string_view, ustring>> plaintexts;
+    // Messages we've already processed are skipped entirely; we just need to mark them obsolete.
+    std::vector<std::string_view> skipped;
+
+    std::vector<size_t> indices;  // index in `configs` of each message we need to decrypt
+    std::vector<ustring_view> ciphertexts;
+    indices.reserve(configs.size());
+    ciphertexts.reserve(configs.size());
+    for (size_t ci = 0; ci < configs.size(); ci++) {
+        auto& [hash, conf] = configs[ci];
+        if (!hash.empty() && _processed.count(hash)) {
+            metrics_registry::add(_metrics.merge_cache_hits, 1);
+            skipped.push_back(hash);
+            continue;
+        }
+        indices.push_back(ci);
+        ciphertexts.push_back(conf);
+    }
+
+    std::vector<ustring_view> keys;
+    keys.reserve(_keys_size);
+    for (size_t i = 0; i < _keys_size; i++)
+        keys.push_back(key(i));
+
+    // Everything gets decrypted straight into `arena`, which then holds the plaintexts (except for
+    // those that we decompress, which end up in `decompressed`).
+    ustring arena;
+    std::vector<decrypt_result> decrypted;
+    {
+        auto decrypt_timer = _metrics.time(metric_phase::decrypt);
+        decrypted = decrypt_many(ciphertexts, keys, encryption_domain(), arena, &_key_cache);
+    }
 
     // TODO:
     // - handle multipart messages.  Each part of a multipart message starts with `m` and then is
@@ -80,33 +296,34 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
     //   - element 2 is the numeric sequence number of the message, starting from 0.
     //   - element 3 is the total number of messages in the sequence.
     //   - element 4 is a chunk of the data.
-    for (size_t ci = 0; ci < configs.size(); ci++) {
-        auto& [hash, conf] = configs[ci];
-        std::optional<ustring> plaintext;
-        bool decrypted = false;
-        for (size_t i = 0; !decrypted && i < _keys_size; i++) {
-            try {
-                plaintexts.emplace_back(hash, decrypt(conf, key(i), encryption_domain()));
-                decrypted = true;
-            } catch (const decrypt_error&) {
-                log(LogLevel::debug,
-                    "Failed to decrypt message " + std::to_string(ci) + " using key " +
-                            std::to_string(i));
-            }
+    std::vector<std::pair<std::string_view, ustring_view>> plaintexts;
+    for (size_t i = 0; i < decrypted.size(); i++) {
+        const auto& result = decrypted[i];
+        size_t ci = indices[i];
+        size_t failed_keys = result ? result.key : keys.size();
+        metrics_registry::add(_metrics.decrypt_attempts, failed_keys + (result ? 1 : 0));
+        for (size_t k = 0; k < failed_keys; k++)
+            log(LogLevel::debug, [&] {
+                return "Failed to decrypt message " + std::to_string(ci) + " using key " +
+                       std::to_string(k);
+            });
+        if (result) {
+            plaintexts.emplace_back(configs[ci].first, result.plaintext);
+        } else {
+            metrics_registry::add(_metrics.decrypt_failures, 1);
+            log(LogLevel::warning,
+                [&] { return "Failed to decrypt message " + std::to_string(ci); });
         }
-        if (!decrypted)
-            log(LogLevel::warning, "Failed to decrypt message " + std::to_string(ci));
     }
-    log(LogLevel::debug,
-        "successfully decrypted " + std::to_string(plaintexts.size()) + " of " +
-                std::to_string(configs.size()) + " incoming messages");
+    log(LogLevel::debug, [&] {
+        return "successfully decrypted " + std::to_string(plaintexts.size()) + " of " +
+               std::to_string(configs.size()) + " incoming messages";
+    });
+
+    // Holds decompressed messages; a deque so that adding one doesn't move the others.
+    std::deque<ustring> decompressed_msgs;
 
     for (auto& [hash, plain] : plaintexts) {
-        // Remove prefix padding:
-        if (auto p = plain.find_first_not_of((unsigned char)0); p > 0 && p != std::string::npos) {
-            std::memmove(plain.data(), plain.data() + p, plain.size() - p);
-            plain.resize(plain.size() - p);
-        }
         if (plain.empty()) {
             log(LogLevel::error, "Invalid config message: contains no data");
             continue;
@@ -120,6 +337,7 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
 
         // 'z' prefix indicates zstd-compressed data:
         if (plain[0] == 'z') {
+            auto decompress_timer = _metrics.time(metric_phase::decompress);
             struct zstd_decomp_freer {
                 void operator()(ZSTD_DStream* z) const { ZSTD_freeDStream(z); }
             };
@@ -146,15 +364,18 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
                 log(LogLevel::warning, "Invalid config message: decompression failed");
                 continue;
             }
-            plain = std::move(decompressed);
+            metrics_registry::add(_metrics.decompress_in_bytes, plain.size());
+            metrics_registry::add(_metrics.decompress_out_bytes, decompressed.size());
+            plain = decompressed_msgs.emplace_back(std::move(decompressed));
         }
 
         if (plain[0] != 'd')
-            log(LogLevel::error,
-                "invalid/unsupported config message with type " +
-                        (plain[0] >= 0x20 && plain[0] <= 0x7e
-                                 ? "'" + std::string{from_unsigned_sv(plain.substr(0, 1))} + "'"
-                                 : "0x" + oxenc::to_hex(plain.begin(), plain.begin() + 1)));
+            log(LogLevel::error, [&] {
+                return "invalid/unsupported config message with type " +
+                       (plain[0] >= 0x20 && plain[0] <= 0x7e
+                                ? "'" + std::string{from_unsigned_sv(plain.substr(0, 1))} + "'"
+                                : "0x" + oxenc::to_hex(plain.begin(), plain.begin() + 1));
+            });
 
         all_hashes.emplace_back(hash);
         all_confs.emplace_back(plain);
@@ -162,18 +383,30 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
 
     std::set<size_t> bad_confs;
 
+    std::optional<metrics_registry::timer> parse_timer;
+    parse_timer.emplace(_metrics, metric_phase::parse);
     auto new_conf = make_config_message(
             _state == ConfigState::Dirty,
             all_confs,
-            nullptr, /* FIXME for signed messages: verifier */
-            nullptr, /* FIXME for signed messages: signer */
+            message_verifier(),
+            message_signer(),
             config_lags(),
             false, /* signature not optional (if we have a verifier) */
             [&](size_t i, const config_error& e) {
                 log(LogLevel::warning, e.what());
                 assert(i > 0);  // i == 0 means we can't deserialize our own serialization
                 bad_confs.insert(i);
-            });
+            },
+            true /* our own config (which we may not be able to sign) needs no verification */);
+    parse_timer.reset();
+    metrics_registry::add(_metrics.parse_failures, bad_confs.size());
+
+    for (size_t i = 1; i < all_confs.size(); i++) {
+        if (bad_confs.count(i) || all_hashes[i].empty())
+            continue;
+        if (auto seqno = peek_seqno(all_confs[i]))
+            add_processed(std::string{all_hashes[i]}, *seqno);
+    }
 
     // All the given config msgs are stale except for:
     // - the message we used, if we found and used a single config that includes all configs.  (This
@@ -185,9 +418,10 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
         if (i != superconf && !bad_confs.count(i) && !all_hashes[i].empty())
             _old_hashes.emplace(all_hashes[i]);
     }
-
     if (new_conf->seqno() != old_seqno) {
         if (new_conf->merged()) {
+            metrics_registry::add(_metrics.merge_conflicts, 1);
+            raise_lags();
             if (_state != ConfigState::Dirty) {
                 // Merging resulted in a merge conflict resolution message, but won't currently be
                 // mutable (because we weren't dirty to start with).  Convert into a Mutable message
@@ -198,6 +432,7 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
                 _config = std::move(new_conf);
             }
             set_state(ConfigState::Dirty);
+            _data_version++;
         } else if (
                 _state == ConfigState::Dirty && new_conf->unmerged_index() == 0 &&
                 new_conf->seqno() == old_seqno + 1) {
@@ -207,10 +442,13 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
             // seqno increment.
             /* do nothing */
         } else {
+            // Some other client has pushed an update
+            raise_lags();
             _config = std::move(new_conf);
             assert(_config->unmerged_index() >= 1 && _config->unmerged_index() < all_hashes.size());
             set_state(ConfigState::Clean);
             _curr_hash = all_hashes[_config->unmerged_index()];
+            _data_version++;
         }
     } else {
         // the merging affect nothing (if it had seqno would have been incremented), so don't
@@ -218,10 +456,45 @@ int ConfigBase::merge(const std::vector<std::pair<std::string, ustring_view>>& c
         assert(new_conf->unmerged_index() == 0);
     }
 
+    // Skipped messages were processed by an earlier merge, and so are likewise stale (unless it is
+    // the current message being polled again):
+    for (auto& hash : skipped)
+        if (hash != _curr_hash)
+            _old_hashes.emplace(hash);
+
+    if (_publishing)
+        publish();
+
     return all_confs.size() - bad_confs.size() -
            1;  // -1 because we don't count the first one (reparsing ourself).
 }
 
+void ConfigBase::add_processed(std::string hash, seqno_t seqno) {
+    auto [it, inserted] = _processed.emplace(std::move(hash), seqno);
+    if (!inserted)
+        return;
+    _processed_order.push_back(it->first);
+    if (_processed_order.size() > PROCESSED_HASHES_LIMIT) {
+        _processed.erase(_processed_order.front());
+        _processed_order.pop_front();
+    }
+    _needs_dump = true;
+}
+
+void ConfigBase::clear_processed() {
+    if (_processed.empty())
+        return;
+    _processed.clear();
+    _processed_order.clear();
+    _needs_dump = true;
+}
+
+std::optional<seqno_t> ConfigBase::processed_seqno(const std::string& msg_hash) const {
+    if (auto it = _processed.find(msg_hash); it != _processed.end())
+        return it->second;
+    return std::nullopt;
+}
+
 std::vector<std::string> ConfigBase::current_hashes() const {
     std::vector<std::string> hashes;
     if (!_curr_hash.empty())
@@ -230,7 +503,7 @@ std::vector<std::string> ConfigBase::current_hashes() const {
 }
 
 bool ConfigBase::needs_push() const {
-    return !is_clean();
+    return !is_clean() && !is_readonly();
 }
 
 // Tries to compresses the message; if the compressed version (including the 'z' prefix tag) is
@@ -252,32 +525,118 @@ void compress_message(ustring& msg, int level) {
         msg = std::move(compressed);
 }
 
+ustring ConfigBase::build_push_message(ustring_view serialized) {
+    // Everything happens in a single buffer, allocated once: null padding at the front, then the
+    // (possibly compressed) message, then room for the encryption overhead.  The padding depends
+    // on the final size, so when compressing we compress into the start of the buffer and then
+    // shift the (smaller) compressed data up once we know how much padding it needs.
+    std::optional<int> lvl = compression_level();
+    if (lvl && !*lvl)
+        lvl.reset();
+    size_t max_size = serialized.size();
+    if (lvl)
+        max_size = std::max(max_size, 1 + ZSTD_compressBound(serialized.size()));
+    ustring buf(padded_size(max_size) + ENCRYPT_DATA_OVERHEAD, 0);
+
+    size_t size = serialized.size();
+    bool compressed = false;
+    if (lvl) {
+        auto compress_timer = _metrics.time(metric_phase::compress);
+        metrics_registry::add(_metrics.compress_in_bytes, serialized.size());
+        buf[0] = 'z';  // our zstd compression marker prefix byte
+        auto zsize = ZSTD_compress(
+                buf.data() + 1, buf.size() - 1, serialized.data(), serialized.size(), *lvl);
+        if (ZSTD_isError(zsize))
+            throw std::runtime_error{
+                    "Unable to compress message: " + std::string{ZSTD_getErrorName(zsize)}};
+        if (1 + zsize < size) {
+            size = 1 + zsize;
+            compressed = true;
+        }
+        metrics_registry::add(_metrics.compress_out_bytes, size);
+    }
+
+    auto encrypt_timer = _metrics.time(metric_phase::encrypt);
+    size_t padded = padded_size(size);
+    size_t padding = padded - size;
+    if (compressed) {
+        std::memmove(buf.data() + padding, buf.data(), size);
+        std::memset(buf.data(), 0, padding);
+    } else {
+        // The buffer may contain a failed compression attempt, which we need to clear from the
+        // padding area:
+        if (lvl)
+            std::memset(buf.data(), 0, padding);
+        std::memcpy(buf.data() + padding, serialized.data(), size);
+    }
+    buf.resize(padded + ENCRYPT_DATA_OVERHEAD);
+    encrypt_inplace(buf.data(), padded, key(), encryption_domain(), &_key_cache, 0);
+    return buf;
+}
+
 std::tuple<seqno_t, ustring, std::vector<std::string>> ConfigBase::push() {
     if (_keys_size == 0)
         throw std::logic_error{"Cannot push data without an encryption key!"};
+    if (is_readonly())
+        throw std::logic_error{"Cannot push data without a signing key!"};
+
+    auto push_timer = _metrics.time(metric_phase::push);
 
-    std::tuple<seqno_t, ustring, std::vector<std::string>> ret{
-            _config->seqno(), _config->serialize(), {}};
+    std::tuple<seqno_t, ustring, std::vector<std::string>> ret{_config->seqno(), ustring{}, {}};
 
     auto& [seqno, msg, obs] = ret;
-    if (auto lvl = compression_level())
-        compress_message(msg, *lvl);
-    pad_message(msg);  // Prefix pad with nulls
-    encrypt_inplace(msg, key(), encryption_domain());
+    // Only a new message gets the currently carried lags: one we have already pushed has to be
+    // reproduced exactly.  Leaving lagged diffs out must never change how the message merges with
+    // others, so if any left-out diff has a change that isn't redone by a newer, carried diff then
+    // we go back to carrying the full lags.
+    bool new_msg = is_dirty();
+    if (new_msg) {
+        _config->serialized_lag = carried_lags();
+        if (_config->serialized_lag < config_lags()) {
+            _config->diff();  // omitted_lags_overridden() needs the current diff
+            if (!_config->omitted_lags_overridden()) {
+                raise_lags();
+                _config->serialized_lag = config_lags();
+            }
+        }
+    }
+    msg = build_push_message(serialize_config());
+    metrics_registry::add(_metrics.push_bytes, msg.size());
 
     if (msg.size() > MAX_MESSAGE_SIZE)
         throw std::length_error{"Config data is too large"};
 
-    if (is_dirty())
+    if (new_msg) {
         set_state(ConfigState::Waiting);
 
+        if (_adaptive_lags) {
+            metrics_registry::add(
+                    _metrics.lag_bytes_saved, _config->omitted_lags_size());
+            if (++_quiet_pushes >= ADAPTIVE_LAG_QUIET_PUSHES) {
+                _quiet_pushes = 0;
+                _carried_lags = carried_lags() - 1;  // (carried_lags() applies the minimum)
+            }
+        }
+    }
+
     for (auto& old : _old_hashes)
         obs.push_back(std::move(old));
     _old_hashes.clear();
 
+    if (_publishing)
+        publish();
+
     return ret;
 }
 
+void ConfigBase::publish() {
+    _publishing = true;
+    if (_snapshot_version == _data_version)
+        return;
+    std::atomic_store(&_snapshot, make_snapshot());
+    _snapshot_version = _data_version;
+}
+
 void ConfigBase::confirm_pushed(seqno_t seqno, std::string msg_hash) {
     // Make sure seqno hasn't changed; if it has then that means we set some other data *after* the
     // caller got the last data to push, and so we don't care about this confirmation.
@@ -287,23 +646,249 @@ void ConfigBase::confirm_pushed(seqno_t seqno, std::string msg_hash) {
     }
 }
 
+namespace {
+
+    // The library-managed executor used for asynchronous operations when the caller doesn't set
+    // one: a single background thread, started on first use, that runs tasks in order.
+    class async_worker {
+      public:
+        async_worker() : thread{[this] { run(); }} {}
+
+        ~async_worker() {
+            {
+                std::lock_guard lock{mutex};
+                stop = true;
+            }
+            cv.notify_one();
+            thread.join();
+        }
+
+        void post(std::function<void()> task) {
+            {
+                std::lock_guard lock{mutex};
+                tasks.push_back(std::move(task));
+            }
+            cv.notify_one();
+        }
+
+      private:
+        void run() {
+            std::unique_lock lock{mutex};
+            while (true) {
+                cv.wait(lock, [this] { return stop || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                auto task = std::move(tasks.front());
+                tasks.pop_front();
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> tasks;
+        bool stop = false;
+        std::thread thread;  // Must be last, so that everything above is initialized first
+    };
+
+    void default_executor(std::function<void()> task) {
+        static async_worker worker;
+        worker.post(std::move(task));
+    }
+
+}  // namespace
+
+struct ConfigBase::async_state {
+    struct op {
+        bool push;
+        // Invoked with nullptr to run the operation, or with a reason string to cancel it instead
+        std::function<void(const char* cancelled)> run;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<op> queue;
+    // True while a `run()` call is queued on or running in the executor
+    bool running = false;
+    // True while an operation is actually executing, on `busy_thread`
+    bool busy = false;
+    std::thread::id busy_thread;
+    async_executor executor;
+
+    // Runs queued operations until the queue is empty; this is what we give to the executor.
+    void run() {
+        std::unique_lock lock{mutex};
+        while (!queue.empty()) {
+            auto op = std::move(queue.front().run);
+            queue.pop_front();
+            busy = true;
+            busy_thread = std::this_thread::get_id();
+            lock.unlock();
+            op(nullptr);
+            lock.lock();
+            busy = false;
+        }
+        running = false;
+        cv.notify_all();
+    }
+};
+
+void ConfigBase::set_executor(async_executor executor) {
+    if (!_async)
+        _async = std::make_shared<async_state>();
+    std::lock_guard lock{_async->mutex};
+    _async->executor = std::move(executor);
+}
+
+void ConfigBase::queue_async(bool push, std::function<void(const char* cancelled)> op) {
+    if (!cancels_async())
+        throw std::logic_error{
+                "Asynchronous operations require a config object created as an async_config"};
+    if (!_async)
+        _async = std::make_shared<async_state>();
+    auto& a = *_async;
+
+    std::optional<async_state::op> superseded;
+    async_executor executor;
+    {
+        std::lock_guard lock{a.mutex};
+        if (push) {
+            for (auto it = a.queue.begin(); it != a.queue.end(); ++it) {
+                if (it->push) {
+                    superseded = std::move(*it);
+                    a.queue.erase(it);
+                    break;
+                }
+            }
+        }
+        a.queue.push_back({push, std::move(op)});
+        if (!a.running) {
+            a.running = true;
+            executor = a.executor ? a.executor : default_executor;
+        }
+    }
+
+    if (superseded)
+        superseded->run("push cancelled: superseded by a newer push");
+
+    if (executor) {
+        try {
+            executor([state = _async] { state->run(); });
+        } catch (...) {
+            std::lock_guard lock{a.mutex};
+            a.running = false;
+            a.cv.notify_all();
+            throw;
+        }
+    }
+}
+
+void ConfigBase::wait_async() {
+    if (!_async)
+        return;
+    std::unique_lock lock{_async->mutex};
+    _async->cv.wait(lock, [this] { return !_async->running; });
+}
+
+void ConfigBase::merge_async(
+        std::vector<std::pair<std::string, ustring>> configs,
+        std::function<void(int merged, std::exception_ptr error)> on_done) {
+    queue_async(
+            false,
+            [this, configs = std::move(configs), on_done = std::move(on_done)](
+                    const char* cancelled) {
+                if (cancelled)
+                    return on_done(0, std::make_exception_ptr(async_cancelled{cancelled}));
+                int merged = 0;
+                std::exception_ptr error;
+                try {
+                    merged = merge(configs);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                on_done(merged, error);
+            });
+}
+
+std::future<int> ConfigBase::merge_async(std::vector<std::pair<std::string, ustring>> configs) {
+    auto promise = std::make_shared<std::promise<int>>();
+    auto future = promise->get_future();
+    merge_async(std::move(configs), [promise](int merged, std::exception_ptr error) {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value(merged);
+    });
+    return future;
+}
+
+void ConfigBase::push_async(
+        std::function<void(push_result result, std::exception_ptr error)> on_done) {
+    queue_async(true, [this, on_done = std::move(on_done)](const char* cancelled) {
+        if (cancelled)
+            return on_done({}, std::make_exception_ptr(async_cancelled{cancelled}));
+        push_result result;
+        std::exception_ptr error;
+        try {
+            result = push();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        on_done(std::move(result), error);
+    });
+}
+
+std::future<ConfigBase::push_result> ConfigBase::push_async() {
+    auto promise = std::make_shared<std::promise<push_result>>();
+    auto future = promise->get_future();
+    push_async([promise](push_result result, std::exception_ptr error) {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value(std::move(result));
+    });
+    return future;
+}
+
+ustring ConfigBase::serialize_config(bool enable_signing) {
+    const oxenc::bt_dict* diff;
+    {
+        auto diff_timer = _metrics.time(metric_phase::diff);
+        diff = &_config->diff();
+    }
+    auto serialize_timer = _metrics.time(metric_phase::serialize);
+    return _config->serialize(*diff, enable_signing);
+}
+
 ustring ConfigBase::dump() {
-    auto data = _config->serialize(false /* disable signing for local storage */);
+    auto dump_timer = _metrics.time(metric_phase::dump);
+    // A dirty config doesn't need signing for local storage, but otherwise we sign (which just
+    // reuses the signature of the pushed message) so that reloading from the dump reproduces the
+    // exact message we pushed.
+    auto data = serialize_config(_state != ConfigState::Dirty);
     auto data_sv = from_unsigned_sv(data);
     oxenc::bt_list old_hashes;
     for (auto& old : _old_hashes)
         old_hashes.emplace_back(old);
+    oxenc::bt_list processed;
+    for (auto& hash : _processed_order)
+        processed.push_back(oxenc::bt_list{{hash, _processed.at(hash)}});
     oxenc::bt_dict d{
             {"!", static_cast<int>(_state)},
             {"$", data_sv},
             {"(", _curr_hash},
             {")", std::move(old_hashes)},
     };
+    if (!processed.empty())
+        d.emplace("*", std::move(processed));
     if (auto extra = extra_data(); !extra.empty())
         d.emplace("+", std::move(extra));
 
     _needs_dump = false;
     auto dumped = oxenc::bt_serialize(d);
+    metrics_registry::add(_metrics.dump_bytes, dumped.size());
     return ustring{to_unsigned_sv(dumped)};
 }
 
@@ -328,11 +913,13 @@ ConfigBase::ConfigBase(std::optional<ustring_view> dump) {
         // one), but that's minor and easier than extracting and restoring all the fields we set and
         // is a little more robust against failure if we actually sent it but got killed before we
         // could store a dump.
+        //
+        // The dump is our own local data, so it isn't verified; signing keys (if any) haven't been
+        // set yet, and set the message's signer (and verifier) when they are.
         _config = std::make_unique<MutableConfigMessage>(
                 to_unsigned_sv(d.consume_string_view()),
-                nullptr,  // FIXME: verifier; but maybe want to delay setting this since it
-                          // shouldn't be signed?
-                nullptr,  // FIXME: signer
+                nullptr,
+                nullptr,
                 config_lags(),
                 true /* signature optional because we don't sign the dump */);
     else
@@ -347,12 +934,62 @@ ConfigBase::ConfigBase(std::optional<ustring_view> dump) {
             _old_hashes.insert(old.consume_string());
     }
 
+    if (d.skip_until("*")) {
+        for (auto processed = d.consume_list_consumer(); !processed.is_finished();) {
+            auto entry = processed.consume_list_consumer();
+            auto hash = entry.consume_string();
+            add_processed(std::move(hash), entry.consume_integer<seqno_t>());
+        }
+        _needs_dump = false;
+    }
+
     if (d.skip_until("+"))
         if (auto extra = d.consume_dict(); !extra.empty())
             load_extra_data(std::move(extra));
 }
 
+ConfigBase::ConfigBase(const ConfigBase& other, snapshot_t) :
+        _config{std::make_unique<ConfigMessage>(*other._config)},
+        _state{other._state},
+        _curr_hash{other._curr_hash},
+        _old_hashes{other._old_hashes},
+        _data_version{other._data_version} {
+    // The signing callbacks refer to `other`, which the snapshot may outlive (and a snapshot has
+    // no need to sign or verify anything).
+    _config->signer = nullptr;
+    _config->verifier = nullptr;
+}
+
+void ConfigBase::cancel_async() {
+    if (!_async)
+        return;
+    // Cancel anything that hasn't started yet, and wait for anything currently executing, unless
+    // that is us: an operation's completion callback destroying the object (the operation doesn't
+    // touch the object again after invoking its callback).
+    std::deque<async_state::op> cancelled;
+    {
+        std::unique_lock lock{_async->mutex};
+        cancelled.swap(_async->queue);
+        _async->cv.wait(lock, [this] {
+            return !_async->busy || _async->busy_thread == std::this_thread::get_id();
+        });
+    }
+    for (auto& op : cancelled)
+        op.run("operation cancelled: config object destroyed");
+}
+
 ConfigBase::~ConfigBase() {
+    if (_async) {
+        // Operations can only be queued on an async_config, whose destructor has already called
+        // cancel_async(), so nothing can be queued or running (on another thread) any more.  If
+        // something is, it would be using a partially destroyed object: treat that as fatal.
+        std::lock_guard lock{_async->mutex};
+        bool running_elsewhere =
+                _async->busy && _async->busy_thread != std::this_thread::get_id();
+        assert(!running_elsewhere && _async->queue.empty());
+        if (running_elsewhere || !_async->queue.empty())
+            std::terminate();
+    }
     sodium_free(_keys);
 }
 
@@ -419,6 +1056,7 @@ void ConfigBase::add_key(ustring_view key, bool high_priority) {
         std::memcpy(_keys[_keys_size].data(), key.data(), KEY_SIZE);
     }
     _keys_size++;
+    _key_cache.clear();  // Key indices have changed
 
     // *Slightly* suboptimal in that we might change buffers above even when we didn't need to, but
     // not worth worrying about optimizing.
@@ -428,7 +1066,11 @@ void ConfigBase::add_key(ustring_view key, bool high_priority) {
 
 int ConfigBase::clear_keys() {
     int ret = _keys_size;
+    if (_keys_size)
+        sodium_memzero(_keys, _keys_size * KEY_SIZE);
     _keys_size = 0;
+    _key_cache.clear();
+    clear_processed();
     return ret;
 }
 
@@ -440,10 +1082,18 @@ bool ConfigBase::remove_key(ustring_view key, size_t from) {
             if (i + 1 < _keys_size)
                 std::memmove(&_keys[i], &_keys[i + 1], (_keys_size - i - 1) * KEY_SIZE);
             _keys_size--;
+            sodium_memzero(_keys[_keys_size].data(), KEY_SIZE);
             removed = true;
             // Don't break, in case there are somehow duplicates in here
         }
     }
+    if (removed) {
+        _key_cache.clear();
+        // Messages may have been decrypted with the removed key, so must be checked again (but not
+        // if we are just removing a duplicate, i.e. when add_key moves a key to the front).
+        if (!has_key(key))
+            clear_processed();
+    }
     return removed;
 }
 
@@ -469,6 +1119,9 @@ using namespace session;
 using namespace session::config;
 
 LIBSESSION_EXPORT void config_free(config_object* conf) {
+    // Borrowed configs (e.g. from user_config_set_get) are freed along with their owner.
+    if (unbox(conf).borrowed)
+        return;
     delete conf;
 }
 
@@ -494,10 +1147,11 @@ LIBSESSION_EXPORT bool config_needs_push(const config_object* conf) {
     return unbox(conf)->needs_push();
 }
 
-LIBSESSION_EXPORT config_push_data* config_push(config_object* conf) {
-    auto& config = *unbox(conf);
-    auto [seqno, data, obs] = config.push();
+}  // extern "C"
 
+// Copies push values into a single malloc'ed config_push_data for returning to a C caller.
+static config_push_data* make_push_data(
+        seqno_t seqno, const ustring& data, const std::vector<std::string>& obs) {
     // We need to do one alloc here that holds everything:
     // - the returned struct
     // - pointers to the obsolete message hash strings
@@ -530,11 +1184,78 @@ LIBSESSION_EXPORT config_push_data* config_push(config_object* conf) {
     return ret;
 }
 
+// Returns the message of an exception_ptr, for passing to a C callback.
+static std::string error_string(const std::exception_ptr& error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        return e.what();
+    } catch (...) {
+        return "Unknown error";
+    }
+}
+
+extern "C" {
+
+LIBSESSION_EXPORT config_push_data* config_push(config_object* conf) {
+    auto& config = *unbox(conf);
+    auto [seqno, data, obs] = config.push();
+    return make_push_data(seqno, data, obs);
+}
+
 LIBSESSION_EXPORT void config_confirm_pushed(
         config_object* conf, seqno_t seqno, const char* msg_hash) {
     unbox(conf)->confirm_pushed(seqno, msg_hash);
 }
 
+LIBSESSION_EXPORT void config_set_executor(
+        config_object* conf,
+        void (*executor)(void (*run)(void* task), void* task, void* ctx),
+        void* ctx) {
+    unbox(conf)->set_executor(c_executor(executor, ctx));
+}
+
+LIBSESSION_EXPORT void config_merge_async(
+        config_object* conf,
+        const char** msg_hashes,
+        const unsigned char** configs,
+        const size_t* lengths,
+        size_t count,
+        void (*callback)(config_object* conf, int merged, const char* error, void* ctx),
+        void* ctx) {
+    std::vector<std::pair<std::string, ustring>> confs;
+    confs.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        confs.emplace_back(msg_hashes[i], ustring{configs[i], lengths[i]});
+    unbox(conf)->merge_async(
+            std::move(confs), [conf, callback, ctx](int merged, std::exception_ptr error) {
+                if (error)
+                    callback(conf, -1, error_string(error).c_str(), ctx);
+                else
+                    callback(conf, merged, nullptr, ctx);
+            });
+}
+
+LIBSESSION_EXPORT void config_push_async(
+        config_object* conf,
+        void (*callback)(
+                config_object* conf, config_push_data* push, const char* error, void* ctx),
+        void* ctx) {
+    unbox(conf)->push_async(
+            [conf, callback, ctx](ConfigBase::push_result result, std::exception_ptr error) {
+                if (error) {
+                    callback(conf, nullptr, error_string(error).c_str(), ctx);
+                    return;
+                }
+                auto& [seqno, data, obs] = result;
+                callback(conf, make_push_data(seqno, data, obs), nullptr, ctx);
+            });
+}
+
+LIBSESSION_EXPORT void config_wait_async(config_object* conf) {
+    unbox(conf)->wait_async();
+}
+
 LIBSESSION_EXPORT void config_dump(config_object* conf, unsigned char** out, size_t* outlen) {
     assert(out && outlen);
     auto data = unbox(conf)->dump();
@@ -592,6 +1313,42 @@ LIBSESSION_EXPORT const unsigned char* config_key(const config_object* conf, siz
     return unbox(conf)->key(i).data();
 }
 
+LIBSESSION_EXPORT void config_set_sig_keys(config_object* conf, const unsigned char* secret) {
+    unbox(conf)->set_sig_keys({secret, 64});
+}
+LIBSESSION_EXPORT void config_set_xed25519_sig_keys(
+        config_object* conf, const unsigned char* x25519_privkey) {
+    unbox(conf)->set_xed25519_sig_keys({x25519_privkey, 32});
+}
+LIBSESSION_EXPORT void config_set_sig_pubkey(config_object* conf, const unsigned char* pubkey) {
+    unbox(conf)->set_sig_pubkey({pubkey, 32});
+}
+LIBSESSION_EXPORT void config_set_xed25519_sig_pubkey(
+        config_object* conf, const unsigned char* x25519_pubkey) {
+    unbox(conf)->set_xed25519_sig_pubkey({x25519_pubkey, 32});
+}
+LIBSESSION_EXPORT void config_clear_sig_keys(config_object* conf) {
+    unbox(conf)->clear_sig_keys();
+}
+LIBSESSION_EXPORT bool config_get_sig_pubkey(const config_object* conf, unsigned char* pubkey) {
+    auto pk = unbox(conf)->get_sig_pubkey();
+    if (!pk)
+        return false;
+    std::memcpy(pubkey, pk->data(), pk->size());
+    return true;
+}
+LIBSESSION_EXPORT bool config_is_readonly(const config_object* conf) {
+    return unbox(conf)->is_readonly();
+}
+
+LIBSESSION_EXPORT void config_set_adaptive_lags(config_object* conf, bool enabled) {
+    unbox(conf)->set_adaptive_lags(enabled);
+}
+
+LIBSESSION_EXPORT int config_carried_lags(const config_object* conf) {
+    return unbox(conf)->carried_lags();
+}
+
 LIBSESSION_EXPORT const char* config_encryption_domain(const config_object* conf) {
     return unbox(conf)->encryption_domain();
 }
@@ -606,4 +1363,8 @@ LIBSESSION_EXPORT void config_set_logger(
         };
 }
 
+LIBSESSION_EXPORT void config_set_log_level(config_object* conf, config_log_level level) {
+    unbox(conf)->log_level = static_cast<LogLevel>(static_cast<int>(level));
+}
+
 }  // extern "C"
@@ -3,6 +3,8 @@
 #include <oxenc/hex.h>
 
 #include <charconv>
+#include <map>
+#include <mutex>
 #include <optional>
 #include <session/types.hpp>
 #include <stdexcept>
@@ -34,6 +36,19 @@ community::community(
     set_pubkey(pubkey_encoded);
 }
 
+community::community(const community_key& key) :
+        base_url_{key.base_url()}, room_{key.room()}, localized_room_{key.localized_room()} {}
+
+community_key::community_key(std::string_view base_url, std::string_view room) :
+        base_url_{community::intern_base_url(base_url)},
+        room_{community::canonical_room(room)},
+        localized_room_{room} {}
+
+community_key::community_key(const community& c) :
+        base_url_{community::intern_base_url(c.base_url())},
+        room_{c.room_norm()},
+        localized_room_{c.room()} {}
+
 void community::set_full_url(std::string_view full_url) {
     auto [b_url, r_token, s_pubkey] = parse_full_url(full_url);
     base_url_ = std::move(b_url);
@@ -183,12 +198,60 @@ std::string community::canonical_url(std::string_view url) {
     return result;
 }
 
+// Maximum number of (input url) entries in the intern table.  The table only holds weak
+// references, so entries whose string is no longer held anywhere are swept out when we reach this;
+// if every entry is still alive then further urls are returned without being interned.
+static constexpr size_t INTERN_TABLE_MAX_SIZE = 1000;
+
+std::shared_ptr<const std::string> community::intern_base_url(std::string_view url) {
+    static std::mutex intern_mutex;
+    static std::map<std::string, std::weak_ptr<const std::string>, std::less<>> intern_table;
+
+    {
+        std::lock_guard lock{intern_mutex};
+        if (auto it = intern_table.find(url); it != intern_table.end())
+            if (auto interned = it->second.lock())
+                return interned;
+    }
+
+    // Not found: canonicalize (which throws if invalid) outside the lock.  If the canonical url
+    // is already interned (under the canonical url itself) we share that value.
+    auto canonical = canonical_url(url);
+
+    std::lock_guard lock{intern_mutex};
+    if (intern_table.size() + 2 > INTERN_TABLE_MAX_SIZE) {
+        for (auto it = intern_table.begin(); it != intern_table.end();) {
+            if (it->second.expired())
+                it = intern_table.erase(it);
+            else
+                ++it;
+        }
+        if (intern_table.size() + 2 > INTERN_TABLE_MAX_SIZE)
+            return std::make_shared<const std::string>(std::move(canonical));
+    }
+    auto& weak = intern_table[canonical];
+    auto interned = weak.lock();
+    if (!interned) {
+        interned = std::make_shared<const std::string>(std::move(canonical));
+        weak = interned;
+    }
+    if (url != *interned)
+        intern_table[std::string{url}] = interned;
+    return interned;
+}
+
 std::string community::canonical_room(std::string_view room) {
     std::string r{room};
     canonicalize_room(r);
     return r;
 }
 
+bool community::valid_room(std::string_view room) {
+    return !room.empty() && room.size() <= ROOM_MAX_LENGTH &&
+           room.find_first_not_of("-0123456789_abcdefghijklmnopqrstuvwxyz"
+                                  "ABCDEFGHIJKLMNOPQRSTUVWXYZ") == std::string_view::npos;
+}
+
 std::tuple<std::string, std::string, std::optional<ustring>> community::parse_partial_url(
         std::string_view url) {
     std::tuple<std::string, std::string, std::optional<ustring>> result;
@@ -223,6 +286,53 @@ std::tuple<std::string, std::string, ustring> community::parse_full_url(std::str
     return {std::move(base), std::move(rm), std::move(*maybe_pk)};
 }
 
+comm_view_helper::comm_view_helper(const dict& servers) :
+        it_server{servers.begin()}, end_server{servers.end()} {
+    settle();
+}
+
+void comm_view_helper::settle() {
+    while (it_server != end_server) {
+        if (pubkey_) {
+            while (it_room != end_room && !(std::holds_alternative<dict>(it_room->second) &&
+                                            community::valid_room(it_room->first)))
+                ++it_room;
+            if (it_room != end_room)
+                return;
+            pubkey_ = nullptr;
+            ++it_server;
+            continue;
+        }
+
+        // Entering a new server: skip it entirely if it doesn't have a valid url, pubkey, and room
+        // dict.  (Checking the url allocates, but only once per server rather than per room).
+        auto* server_info = std::get_if<dict>(&it_server->second);
+        const dict* rooms = nullptr;
+        bool valid_url = true;
+        try {
+            community::canonical_url(it_server->first);
+        } catch (const std::exception&) {
+            valid_url = false;
+        }
+        if (server_info && valid_url) {
+            if (auto pk = server_info->find("#"); pk != server_info->end())
+                if (auto* pk_sc = std::get_if<scalar>(&pk->second))
+                    if (auto* pk_str = std::get_if<std::string>(pk_sc);
+                        pk_str && pk_str->size() == 32)
+                        pubkey_ = pk_str;
+            if (auto rit = server_info->find("R"); rit != server_info->end())
+                rooms = std::get_if<dict>(&rit->second);
+        }
+        if (!pubkey_ || !rooms) {
+            pubkey_ = nullptr;
+            ++it_server;
+            continue;
+        }
+        it_room = rooms->begin();
+        end_room = rooms->end();
+    }
+}
+
 }  // namespace session::config
 
 LIBSESSION_C_API const size_t COMMUNITY_BASE_URL_MAX_LENGTH =
@@ -0,0 +1,342 @@
+#include "session/config/config_set.hpp"
+
+#include <oxenc/bt_producer.h>
+#include <oxenc/bt_serialize.h>
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "internal.hpp"
+#include "session/config/config_set.h"
+#include "session/config/error.h"
+#include "session/export.h"
+#include "session/util.hpp"
+
+namespace session::config {
+
+// Returns the key under which the dump of the given namespace is stored in a combined dump.
+static std::string dump_key(Namespace ns) {
+    return std::to_string(static_cast<int16_t>(ns));
+}
+
+size_t ConfigSet::index(Namespace ns) {
+    for (size_t i = 0; i < NAMESPACES.size(); i++)
+        if (NAMESPACES[i] == ns)
+            return i;
+    throw std::invalid_argument{
+            "Invalid namespace " + dump_key(ns) + ": namespace is not part of the config set"};
+}
+
+ConfigSet::ConfigSet(ustring_view ed25519_secretkey, std::optional<ustring_view> dump) {
+    std::array<std::optional<ustring_view>, NAMESPACES.size()> dumps;
+    if (dump) {
+        // The combined dump is a dict of namespace => individual config dump; the keys (being
+        // single digits) sort in the same order as NAMESPACES.
+        oxenc::bt_dict_consumer d{from_unsigned_sv(*dump)};
+        for (size_t i = 0; i < NAMESPACES.size(); i++)
+            if (d.skip_until(dump_key(NAMESPACES[i])))
+                dumps[i] = to_unsigned_sv(d.consume_string_view());
+    }
+
+    // These are async_configs so that the asynchronous operations can be used on them.
+    _configs[index(Namespace::UserProfile)] = std::make_unique<async_config<UserProfile>>(
+            ed25519_secretkey, dumps[index(Namespace::UserProfile)]);
+    _configs[index(Namespace::Contacts)] = std::make_unique<async_config<Contacts>>(
+            ed25519_secretkey, dumps[index(Namespace::Contacts)]);
+    _configs[index(Namespace::ConvoInfoVolatile)] =
+            std::make_unique<async_config<ConvoInfoVolatile>>(
+                    ed25519_secretkey, dumps[index(Namespace::ConvoInfoVolatile)]);
+    _configs[index(Namespace::UserGroups)] = std::make_unique<async_config<UserGroups>>(
+            ed25519_secretkey, dumps[index(Namespace::UserGroups)]);
+}
+
+void ConfigSet::set_executor(ConfigBase::async_executor executor) {
+    for (auto& c : _configs)
+        c->set_executor(executor);
+    _executor = std::move(executor);
+}
+
+int ConfigSet::merge(const std::vector<message>& messages) {
+    std::array<std::vector<std::pair<std::string, ustring_view>>, NAMESPACES.size()> batches;
+    for (const auto& msg : messages)
+        batches[index(msg.ns)].emplace_back(msg.hash, msg.data);
+
+    // Each config is independent, so with an executor we merge them concurrently: the first
+    // config's batch is merged on this thread, the others on the executor.  Either way a failure
+    // merging one config doesn't stop the others from being merged; we rethrow the first error
+    // once all of them have finished.
+    std::array<std::future<int>, NAMESPACES.size()> results;
+    std::vector<std::shared_ptr<std::packaged_task<int()>>> local;
+    for (size_t i = 0; i < batches.size(); i++) {
+        if (batches[i].empty())
+            continue;
+        auto task = std::make_shared<std::packaged_task<int()>>(
+                [this, i, &batches] { return _configs[i]->merge(batches[i]); });
+        results[i] = task->get_future();
+        if (!_executor || local.empty()) {
+            local.push_back(std::move(task));
+            continue;
+        }
+        try {
+            _executor([task] { (*task)(); });
+        } catch (...) {
+            local.push_back(std::move(task));
+        }
+    }
+    for (auto& task : local)
+        (*task)();
+
+    int merged = 0;
+    std::exception_ptr error;
+    for (auto& r : results) {
+        if (!r.valid())
+            continue;
+        try {
+            merged += r.get();
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+    if (error)
+        std::rethrow_exception(error);
+    return merged;
+}
+
+bool ConfigSet::needs_push() const {
+    for (const auto& c : _configs)
+        if (c->needs_push())
+            return true;
+    return false;
+}
+
+std::vector<ConfigSet::push_data> ConfigSet::push() {
+    std::vector<push_data> result;
+    for (size_t i = 0; i < _configs.size(); i++) {
+        if (!_configs[i]->needs_push())
+            continue;
+        auto [seqno, data, obsolete] = _configs[i]->push();
+        result.push_back({NAMESPACES[i], seqno, std::move(data), std::move(obsolete)});
+    }
+    return result;
+}
+
+void ConfigSet::confirm_pushed(Namespace ns, seqno_t seqno, std::string msg_hash) {
+    _configs[index(ns)]->confirm_pushed(seqno, std::move(msg_hash));
+}
+
+bool ConfigSet::needs_dump() const {
+    for (const auto& c : _configs)
+        if (c->needs_dump())
+            return true;
+    return false;
+}
+
+ustring ConfigSet::dump() {
+    oxenc::bt_dict_producer d{};
+    for (size_t i = 0; i < _configs.size(); i++)
+        d.append(dump_key(NAMESPACES[i]), from_unsigned_sv(_configs[i]->dump()));
+    return ustring{to_unsigned_sv(d.view())};
+}
+
+}  // namespace session::config
+
+using namespace session;
+using namespace session::config;
+
+namespace {
+
+// The C internals of a user_config_set.  In addition to the ConfigSet itself we hold a
+// config_object for each contained config so that the existing per-config C functions can be used
+// on them; these point at (but do not own) the configs owned by the ConfigSet.
+struct user_config_set_internals {
+    std::unique_ptr<ConfigSet> set;
+    std::array<internals<>, ConfigSet::NAMESPACES.size()> boxes;
+    std::array<config_object, ConfigSet::NAMESPACES.size()> objects;
+
+    explicit user_config_set_internals(std::unique_ptr<ConfigSet> s) : set{std::move(s)} {
+        for (size_t i = 0; i < objects.size(); i++) {
+            boxes[i].borrowed = &set->config(ConfigSet::NAMESPACES[i]);
+            objects[i].internals = &boxes[i];
+            objects[i].last_error = nullptr;
+        }
+    }
+};
+
+user_config_set_internals& unbox(user_config_set* set) {
+    return *static_cast<user_config_set_internals*>(set->internals);
+}
+const user_config_set_internals& unbox(const user_config_set* set) {
+    return *static_cast<const user_config_set_internals*>(set->internals);
+}
+
+}  // namespace
+
+extern "C" {
+
+LIBSESSION_C_API int user_config_set_init(
+        user_config_set** set,
+        const unsigned char* ed25519_secretkey_bytes,
+        const unsigned char* dumpstr,
+        size_t dumplen,
+        char* error) {
+    assert(ed25519_secretkey_bytes);
+    ustring_view ed25519_secretkey{ed25519_secretkey_bytes, 32};
+    auto c_set = std::make_unique<user_config_set>();
+    std::optional<ustring_view> dump;
+    if (dumpstr && dumplen)
+        dump.emplace(dumpstr, dumplen);
+
+    std::unique_ptr<user_config_set_internals> c;
+    try {
+        c = std::make_unique<user_config_set_internals>(
+                std::make_unique<ConfigSet>(ed25519_secretkey, dump));
+    } catch (const std::exception& e) {
+        if (error) {
+            std::string msg = e.what();
+            if (msg.size() > 255)
+                msg.resize(255);
+            std::memcpy(error, msg.c_str(), msg.size() + 1);
+        }
+        return SESSION_ERR_INVALID_DUMP;
+    }
+
+    c_set->internals = c.release();
+    c_set->last_error = nullptr;
+    *set = c_set.release();
+    return SESSION_ERR_NONE;
+}
+
+LIBSESSION_C_API void user_config_set_free(user_config_set* set) {
+    delete static_cast<user_config_set_internals*>(set->internals);
+    delete set;
+}
+
+LIBSESSION_C_API config_object* user_config_set_get(user_config_set* set, int16_t ns) {
+    auto& namespaces = ConfigSet::NAMESPACES;
+    for (size_t i = 0; i < namespaces.size(); i++)
+        if (static_cast<int16_t>(namespaces[i]) == ns)
+            return &unbox(set).objects[i];
+    return nullptr;
+}
+
+LIBSESSION_C_API void user_config_set_set_executor(
+        user_config_set* set,
+        void (*executor)(void (*run)(void* task), void* task, void* ctx),
+        void* ctx) {
+    unbox(set).set->set_executor(c_executor(executor, ctx));
+}
+
+LIBSESSION_C_API int user_config_set_merge(
+        user_config_set* set,
+        const int16_t* namespaces,
+        const char** msg_hashes,
+        const unsigned char** configs,
+        const size_t* lengths,
+        size_t count) {
+    try {
+        set->last_error = nullptr;
+        std::vector<ConfigSet::message> messages;
+        messages.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            messages.push_back(
+                    {static_cast<Namespace>(namespaces[i]),
+                     msg_hashes[i],
+                     ustring_view{configs[i], lengths[i]}});
+        return unbox(set).set->merge(messages);
+    } catch (const std::exception& e) {
+        copy_c_str(set->_error_buf, e.what());
+        set->last_error = set->_error_buf;
+    }
+    return -1;
+}
+
+LIBSESSION_C_API bool user_config_set_needs_push(const user_config_set* set) {
+    return unbox(set).set->needs_push();
+}
+
+LIBSESSION_C_API user_config_set_push_data* user_config_set_push(user_config_set* set) {
+    auto pushes = unbox(set).set->push();
+
+    // As with config_push we do a single allocation that holds everything:
+    // - the returned struct
+    // - the namespaces array
+    // - the config_push_data array
+    // - pointers to the obsolete message hash strings (of all pushes)
+    // - the data of each push
+    // - the message hash strings
+    size_t n_obsolete = 0, data_size = 0;
+    for (auto& p : pushes) {
+        n_obsolete += p.obsolete.size();
+        data_size += p.data.size();
+        for (auto& o : p.obsolete)
+            data_size += o.size() + 1;
+    }
+
+    static_assert(alignof(user_config_set_push_data) >= alignof(config_push_data));
+    static_assert(alignof(config_push_data) >= alignof(char*));
+    static_assert(alignof(char*) >= alignof(int16_t));
+    size_t buffer_size = sizeof(user_config_set_push_data) +
+                         pushes.size() * sizeof(config_push_data) + n_obsolete * sizeof(char*) +
+                         pushes.size() * sizeof(int16_t) + data_size;
+
+    auto* ret = static_cast<user_config_set_push_data*>(std::malloc(buffer_size));
+    ret->len = pushes.size();
+    ret->pushes = reinterpret_cast<config_push_data*>(ret + 1);
+    char** next_obs = reinterpret_cast<char**>(ret->pushes + ret->len);
+    ret->namespaces = reinterpret_cast<int16_t*>(next_obs + n_obsolete);
+    auto* next_data = reinterpret_cast<unsigned char*>(ret->namespaces + ret->len);
+
+    for (size_t i = 0; i < pushes.size(); i++) {
+        auto& p = pushes[i];
+        auto& out = ret->pushes[i];
+        ret->namespaces[i] = static_cast<int16_t>(p.ns);
+        out.seqno = p.seqno;
+        out.config = next_data;
+        out.config_len = p.data.size();
+        std::memcpy(next_data, p.data.data(), p.data.size());
+        next_data += p.data.size();
+        out.obsolete = next_obs;
+        out.obsolete_len = p.obsolete.size();
+        next_obs += p.obsolete.size();
+        for (size_t j = 0; j < p.obsolete.size(); j++) {
+            std::memcpy(next_data, p.obsolete[j].c_str(), p.obsolete[j].size() + 1);
+            out.obsolete[j] = reinterpret_cast<char*>(next_data);
+            next_data += p.obsolete[j].size() + 1;
+        }
+    }
+
+    return ret;
+}
+
+LIBSESSION_C_API bool user_config_set_confirm_pushed(
+        user_config_set* set, int16_t ns, seqno_t seqno, const char* msg_hash) {
+    try {
+        set->last_error = nullptr;
+        unbox(set).set->confirm_pushed(static_cast<Namespace>(ns), seqno, msg_hash);
+        return true;
+    } catch (const std::exception& e) {
+        copy_c_str(set->_error_buf, e.what());
+        set->last_error = set->_error_buf;
+    }
+    return false;
+}
+
+LIBSESSION_C_API bool user_config_set_needs_dump(const user_config_set* set) {
+    return unbox(set).set->needs_dump();
+}
+
+LIBSESSION_C_API void user_config_set_dump(
+        user_config_set* set, unsigned char** out, size_t* outlen) {
+    assert(out && outlen);
+    auto data = unbox(set).set->dump();
+    *outlen = data.size();
+    *out = static_cast<unsigned char*>(std::malloc(data.size()));
+    std::memcpy(*out, data.data(), data.size());
+}
+
+}  // extern "C"
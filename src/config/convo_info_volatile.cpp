@@ -6,6 +6,7 @@
 #include <oxenc/variant.h>
 #include <sodium/crypto_generichash_blake2b.h>
 
+#include <algorithm>
 #include <charconv>
 #include <iterator>
 #include <stdexcept>
@@ -82,6 +83,12 @@ ConvoInfoVolatile::ConvoInfoVolatile(
     load_key(ed25519_secretkey);
 }
 
+ConvoInfoVolatile::ConvoInfoVolatile(const ConvoInfoVolatile& other, snapshot_t t) :
+        ConfigBase{other, t} {
+    // Snapshots are read concurrently, so we have to build the index up front rather than lazily
+    sync_index();
+}
+
 std::optional<convo::one_to_one> ConvoInfoVolatile::get_1to1(std::string_view pubkey_hex) const {
     std::string pubkey = session_id_to_bytes(pubkey_hex);
 
@@ -115,7 +122,14 @@ ConfigBase::DictFieldProxy ConvoInfoVolatile::community_field(
 
 std::optional<convo::community> ConvoInfoVolatile::get_community(
         std::string_view base_url, std::string_view room) const {
-    convo::community og{base_url, community::canonical_room(room)};
+    return get_community(community_key{base_url, room});
+}
+
+std::optional<convo::community> ConvoInfoVolatile::get_community(const community_key& key) const {
+    convo::community og{key};
+    // The room's case isn't stored here, so (as with the base_url/room lookup) we always return
+    // the normalized room:
+    og.localized_room_.reset();
 
     ustring_view pubkey;
     if (auto* info_dict = community_field(og, &pubkey).dict()) {
@@ -135,7 +149,14 @@ std::optional<convo::community> ConvoInfoVolatile::get_community(
 
 convo::community ConvoInfoVolatile::get_or_construct_community(
         std::string_view base_url, std::string_view room, ustring_view pubkey) const {
-    convo::community result{base_url, community::canonical_room(room), pubkey};
+    return get_or_construct_community(community_key{base_url, room}, pubkey);
+}
+
+convo::community ConvoInfoVolatile::get_or_construct_community(
+        const community_key& key, ustring_view pubkey) const {
+    convo::community result{key};
+    result.localized_room_.reset();  // Not stored, as above
+    result.set_pubkey(pubkey);
 
     if (auto* info_dict = community_field(result).dict())
         result.load(*info_dict);
@@ -180,8 +201,11 @@ convo::legacy_group ConvoInfoVolatile::get_or_construct_legacy_group(
 }
 
 void ConvoInfoVolatile::set(const convo::one_to_one& c) {
-    auto info = data["1"][session_id_to_bytes(c.session_id)];
+    sync_index();
+    index_key key{'1', session_id_to_bytes(c.session_id), ""};
+    auto info = data["1"][std::get<1>(key)];
     set_base(c, info);
+    reindex(std::move(key), info);
 }
 
 void ConvoInfoVolatile::set_base(const convo::base& c, DictFieldProxy& info) {
@@ -200,32 +224,213 @@ void ConvoInfoVolatile::set_base(const convo::base& c, DictFieldProxy& info) {
     set_flag(info["u"], c.unread);
 }
 
+void ConvoInfoVolatile::sync_index() const {
+    if (_index_version == data_version())
+        return;
+
+    _index_by_last_read.clear();
+    _unread_by_last_read.clear();
+    _index.clear();
+    _unread_1to1 = _unread_communities = _unread_legacy_groups = 0;
+
+    for (char type : {'1', 'C'}) {
+        if (auto* convos = data[std::string(1, type)].dict())
+            for (const auto& [id, info] : *convos)
+                if (id.size() == 33 && id[0] == 0x05)
+                    if (auto* info_dict = std::get_if<dict>(&info))
+                        index_insert({type, id, ""}, *info_dict);
+    }
+
+    if (auto* servers = data["o"].dict()) {
+        for (const auto& [base_url, server_info] : *servers) {
+            auto* server_dict = std::get_if<dict>(&server_info);
+            if (!server_dict || !maybe_string(*server_dict, "#"))
+                continue;
+            auto rit = server_dict->find("R");
+            if (rit == server_dict->end())
+                continue;
+            if (auto* rooms = std::get_if<dict>(&rit->second))
+                for (const auto& [room, info] : *rooms)
+                    if (auto* info_dict = std::get_if<dict>(&info))
+                        index_insert({'o', base_url, room}, *info_dict);
+        }
+    }
+
+    _index_version = data_version();
+}
+
+size_t& ConvoInfoVolatile::unread_count(char type) const {
+    return type == '1' ? _unread_1to1 : type == 'C' ? _unread_legacy_groups : _unread_communities;
+}
+
+void ConvoInfoVolatile::index_insert(index_key key, const dict& info) const {
+    index_entry entry{maybe_int(info, "r").value_or(0), (bool)maybe_int(info, "u").value_or(0)};
+    auto [it, inserted] = _index.try_emplace(std::move(key), entry);
+    if (!inserted) {
+        _index_by_last_read.erase(&*it);
+        if (_unread_by_last_read.erase(&*it))
+            unread_count(std::get<0>(it->first))--;
+        it->second = entry;
+    }
+    _index_by_last_read.insert(&*it);
+    if (entry.unread) {
+        _unread_by_last_read.insert(&*it);
+        unread_count(std::get<0>(it->first))++;
+    }
+}
+
+void ConvoInfoVolatile::index_erase(const index_key& key) const {
+    if (auto it = _index.find(key); it != _index.end()) {
+        _index_by_last_read.erase(&*it);
+        if (_unread_by_last_read.erase(&*it))
+            unread_count(std::get<0>(key))--;
+        _index.erase(it);
+    }
+}
+
+void ConvoInfoVolatile::reindex(index_key key, const DictFieldProxy& info) {
+    if (auto* info_dict = info.dict())
+        index_insert(std::move(key), *info_dict);
+    else
+        index_erase(key);
+    _index_version = data_version();
+}
+
 void ConvoInfoVolatile::prune_stale(std::chrono::milliseconds prune) {
-    const int64_t cutoff =
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                    (std::chrono::system_clock::now() - PRUNE_HIGH).time_since_epoch())
-                    .count();
-
-    std::vector<std::string> stale;
-    for (auto it = begin_1to1(); it != end(); ++it)
-        if (!it->unread && it->last_read < cutoff)
-            stale.push_back(it->session_id);
-    for (const auto& sid : stale)
-        erase_1to1(sid);
-
-    stale.clear();
-    for (auto it = begin_legacy_groups(); it != end(); ++it)
-        if (!it->unread && it->last_read < cutoff)
-            stale.push_back(it->id);
-    for (const auto& id : stale)
-        erase_legacy_group(id);
-
-    std::vector<std::pair<std::string, std::string>> stale_comms;
-    for (auto it = begin_communities(); it != end(); ++it)
-        if (!it->unread && it->last_read < cutoff)
-            stale_comms.emplace_back(it->base_url(), it->room());
-    for (const auto& [base, room] : stale_comms)
-        erase_community(base, room);
+    const int64_t cutoff = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   (std::chrono::system_clock::now() - prune).time_since_epoch())
+                                   .count();
+
+    sync_index();
+
+    // The index is ordered by last_read, so we only have to look at the front of it, and can stop
+    // as soon as we hit the first conversation that is recent enough to keep.
+    std::vector<index_key> stale;
+    for (auto it = _index_by_last_read.begin();
+         it != _index_by_last_read.end() && (*it)->second.last_read < cutoff;
+         ++it)
+        if (!(*it)->second.unread)
+            stale.push_back((*it)->first);
+
+    for (const auto& key : stale)
+        erase_indexed(key);
+}
+
+std::optional<convo::any> ConvoInfoVolatile::load_indexed(const index_value& val) const {
+    const auto& [type, id, room] = val.first;
+    std::optional<convo::any> result;
+    try {
+        if (type == '1') {
+            result.emplace(convo::one_to_one{oxenc::to_hex(id)});
+        } else if (type == 'C') {
+            result.emplace(convo::legacy_group{oxenc::to_hex(id)});
+        } else {
+            auto& og = std::get<convo::community>(result.emplace(convo::community{}));
+            og.set_base_url(id);
+            og.set_room(room);
+            auto pk = data["o"][id]["#"].string_view_or("");
+            og.set_pubkey(
+                    ustring_view{reinterpret_cast<const unsigned char*>(pk.data()), pk.size()});
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    var::visit(
+            [&val](auto& c) {
+                c.last_read = val.second.last_read;
+                c.unread = val.second.unread;
+            },
+            *result);
+    return result;
+}
+
+std::vector<convo::any> ConvoInfoVolatile::most_recent(size_t limit, bool unread_only) const {
+    sync_index();
+
+    const auto& ordered = unread_only ? _unread_by_last_read : _index_by_last_read;
+    std::vector<convo::any> result;
+    result.reserve(std::min(limit, ordered.size()));
+    for (auto it = ordered.rbegin(); it != ordered.rend() && result.size() < limit; ++it)
+        if (auto c = load_indexed(**it))
+            result.push_back(*std::move(c));
+    return result;
+}
+
+size_t ConvoInfoVolatile::mark_read(
+        int64_t last_read, bool oneto1, bool communities, bool legacy_groups) {
+    auto selected = [&](char type) {
+        return type == '1' ? oneto1 : type == 'C' ? legacy_groups : communities;
+    };
+
+    // As in set_base, a timestamp older than the prune cutoff isn't stored (it would just get
+    // pruned again at the next push), but we still clear the unread flags.
+    const bool store_read =
+            std::chrono::system_clock::time_point{std::chrono::milliseconds{last_read}} >
+            std::chrono::system_clock::now() - PRUNE_LOW;
+
+    // Use the index to see whether anything would actually change before we go and dirty the
+    // config: either there are selected, unread conversations, or there are selected conversations
+    // older than the new timestamp (which, if present, are at the front of the ordered index).
+    sync_index();
+    bool any = (oneto1 && _unread_1to1) || (communities && _unread_communities) ||
+               (legacy_groups && _unread_legacy_groups);
+    if (store_read)
+        for (auto it = _index_by_last_read.begin();
+             !any && it != _index_by_last_read.end() && (*it)->second.last_read < last_read;
+             ++it)
+            any = selected(std::get<0>((*it)->first));
+    if (!any)
+        return 0;
+
+    size_t updated = 0;
+    auto update = [&](dict& info) {
+        bool changed = info.erase("u");
+        auto r = info.find("r");
+        auto* r_sc = r != info.end() ? std::get_if<scalar>(&r->second) : nullptr;
+        auto* r_int = r_sc ? std::get_if<int64_t>(r_sc) : nullptr;
+        if (store_read && (!r_int || *r_int < last_read)) {
+            info["r"] = scalar{last_read};
+            changed = true;
+        }
+        if (changed)
+            updated++;
+    };
+
+    // This updates the config data directly (rather than going through DictFieldProxy for each
+    // conversation) and so has to follow the same validity rules as the iterators.
+    auto& d = dirty().data();
+    for (char type : {'1', 'C'}) {
+        if (!selected(type))
+            continue;
+        if (auto convos = d.find(std::string(1, type)); convos != d.end())
+            if (auto* convos_dict = std::get_if<dict>(&convos->second))
+                for (auto& [id, info] : *convos_dict)
+                    if (id.size() == 33 && id[0] == 0x05)
+                        if (auto* info_dict = std::get_if<dict>(&info))
+                            update(*info_dict);
+    }
+    if (communities) {
+        if (auto servers = d.find("o"); servers != d.end()) {
+            if (auto* servers_dict = std::get_if<dict>(&servers->second)) {
+                for (auto& [base_url, server_info] : *servers_dict) {
+                    auto* server_dict = std::get_if<dict>(&server_info);
+                    if (!server_dict || !maybe_string(*server_dict, "#"))
+                        continue;
+                    auto rit = server_dict->find("R");
+                    if (rit == server_dict->end())
+                        continue;
+                    if (auto* rooms = std::get_if<dict>(&rit->second))
+                        for (auto& [room, info] : *rooms)
+                            if (auto* info_dict = std::get_if<dict>(&info))
+                                update(*info_dict);
+                }
+            }
+        }
+    }
+
+    // The data version changed when we called dirty(), so the index will be rebuilt when next
+    // needed.
+    return updated;
 }
 
 std::tuple<seqno_t, ustring, std::vector<std::string>> ConvoInfoVolatile::push() {
@@ -237,14 +442,19 @@ std::tuple<seqno_t, ustring, std::vector<std::string>> ConvoInfoVolatile::push()
 }
 
 void ConvoInfoVolatile::set(const convo::community& c) {
+    sync_index();
     auto info = community_field(c);
     data["o"][c.base_url()]["#"] = c.pubkey();
     set_base(c, info);
+    reindex({'o', c.base_url(), c.room_norm()}, info);
 }
 
 void ConvoInfoVolatile::set(const convo::legacy_group& c) {
-    auto info = data["C"][session_id_to_bytes(c.id)];
+    sync_index();
+    index_key key{'C', session_id_to_bytes(c.id), ""};
+    auto info = data["C"][std::get<1>(key)];
     set_base(c, info);
+    reindex(std::move(key), info);
 }
 
 template <typename Field>
@@ -254,24 +464,39 @@ static bool erase_impl(Field convo) {
     return ret;
 }
 
-bool ConvoInfoVolatile::erase(const convo::one_to_one& c) {
-    return erase_impl(data["1"][session_id_to_bytes(c.session_id)]);
-}
-bool ConvoInfoVolatile::erase(const convo::community& c) {
-    bool gone = erase_impl(community_field(c));
-    if (gone) {
-        // If this was the last room on the server, also remove the server
-        auto server_info = data["o"][c.base_url()];
+bool ConvoInfoVolatile::erase_indexed(const index_key& key) {
+    sync_index();
+
+    const auto& [type, id, room] = key;
+    bool gone;
+    if (type == 'o') {
+        auto server_info = data["o"][id];
         auto rooms = server_info["R"];
-        if (auto* rd = rooms.dict(); !rd || rd->empty()) {
-            rooms.erase();
-            server_info.erase();
+        gone = erase_impl(rooms[room]);
+        if (gone) {
+            // If this was the last room on the server, also remove the server
+            if (auto* rd = rooms.dict(); !rd || rd->empty()) {
+                rooms.erase();
+                server_info.erase();
+            }
         }
+    } else {
+        gone = erase_impl(data[std::string(1, type)][id]);
     }
+
+    index_erase(key);
+    _index_version = data_version();
     return gone;
 }
+
+bool ConvoInfoVolatile::erase(const convo::one_to_one& c) {
+    return erase_indexed({'1', session_id_to_bytes(c.session_id), ""});
+}
+bool ConvoInfoVolatile::erase(const convo::community& c) {
+    return erase_indexed({'o', c.base_url(), c.room_norm()});
+}
 bool ConvoInfoVolatile::erase(const convo::legacy_group& c) {
-    return erase_impl(data["C"][session_id_to_bytes(c.id)]);
+    return erase_indexed({'C', session_id_to_bytes(c.id), ""});
 }
 
 bool ConvoInfoVolatile::erase(const convo::any& c) {
@@ -281,7 +506,10 @@ bool ConvoInfoVolatile::erase_1to1(std::string_view session_id) {
     return erase(convo::one_to_one{session_id});
 }
 bool ConvoInfoVolatile::erase_community(std::string_view base_url, std::string_view room) {
-    return erase(convo::community{base_url, room});
+    return erase_community(community_key{base_url, room});
+}
+bool ConvoInfoVolatile::erase_community(const community_key& key) {
+    return erase_indexed({'o', key.base_url(), key.room()});
 }
 bool ConvoInfoVolatile::erase_legacy_group(std::string_view id) {
     return erase(convo::legacy_group{id});
@@ -319,6 +547,26 @@ size_t ConvoInfoVolatile::size() const {
     return size_1to1() + size_communities() + size_legacy_groups();
 }
 
+size_t ConvoInfoVolatile::size_unread_1to1() const {
+    sync_index();
+    return _unread_1to1;
+}
+
+size_t ConvoInfoVolatile::size_unread_communities() const {
+    sync_index();
+    return _unread_communities;
+}
+
+size_t ConvoInfoVolatile::size_unread_legacy_groups() const {
+    sync_index();
+    return _unread_legacy_groups;
+}
+
+size_t ConvoInfoVolatile::size_unread() const {
+    sync_index();
+    return _unread_1to1 + _unread_communities + _unread_legacy_groups;
+}
+
 ConvoInfoVolatile::iterator::iterator(
         const DictFieldRoot& data, bool oneto1, bool communities, bool legacy_groups) {
     if (oneto1)
@@ -414,6 +662,112 @@ ConvoInfoVolatile::iterator& ConvoInfoVolatile::iterator::operator++() {
     return *this;
 }
 
+ConvoInfoVolatile::view_range ConvoInfoVolatile::view(
+        bool one_to_one, bool communities, bool legacy_groups) const {
+    view_range range;
+    if (one_to_one)
+        range._one_to_one = data["1"].dict();
+    if (communities)
+        range._communities = data["o"].dict();
+    if (legacy_groups)
+        range._legacy_groups = data["C"].dict();
+    return range;
+}
+
+int64_t ConvoInfoVolatile::convo_view::last_read() const {
+    return maybe_int(*info, "r").value_or(0);
+}
+
+bool ConvoInfoVolatile::convo_view::unread() const {
+    return maybe_int(*info, "u").value_or(0);
+}
+
+std::string ConvoInfoVolatile::convo_view::id_hex() const {
+    if (is_community())
+        return "";
+    return oxenc::to_hex(id);
+}
+
+convo::any ConvoInfoVolatile::convo_view::load() const {
+    if (is_one_to_one()) {
+        convo::one_to_one c{oxenc::to_hex(id)};
+        c.load(*info);
+        return c;
+    }
+    if (is_legacy_group()) {
+        convo::legacy_group c{oxenc::to_hex(id)};
+        c.load(*info);
+        return c;
+    }
+    convo::community c{id, room, pubkey};
+    c.load(*info);
+    return c;
+}
+
+ConvoInfoVolatile::view_iterator::view_iterator(
+        const dict* one_to_one, const dict* communities, const dict* legacy_groups) {
+    if (one_to_one) {
+        _it_11 = one_to_one->begin();
+        _end_11 = one_to_one->end();
+    }
+    if (communities)
+        _it_comm = comm_view_helper{*communities};
+    if (legacy_groups) {
+        _it_lgroup = legacy_groups->begin();
+        _end_lgroup = legacy_groups->end();
+    }
+    _load_val();
+}
+
+// Skips invalid records (in the same way as the regular iterator) and points _val at the current
+// record; like the regular iterator we exhaust the one-to-one conversations, then communities,
+// then legacy groups.
+void ConvoInfoVolatile::view_iterator::_load_val() {
+    for (; _it_11 != _end_11; ++_it_11) {
+        auto& [k, v] = *_it_11;
+        if (auto* info = std::get_if<dict>(&v); info && k.size() == 33 && k[0] == 0x05) {
+            _val = {'1', k, {}, {}, info};
+            return;
+        }
+    }
+
+    if (!_it_comm.done()) {
+        _val = {'o',
+                _it_comm.base_url(),
+                _it_comm.room(),
+                _it_comm.pubkey(),
+                &_it_comm.room_info()};
+        return;
+    }
+
+    for (; _it_lgroup != _end_lgroup; ++_it_lgroup) {
+        auto& [k, v] = *_it_lgroup;
+        if (auto* info = std::get_if<dict>(&v); info && k.size() == 33 && k[0] == 0x05) {
+            _val = {'C', k, {}, {}, info};
+            return;
+        }
+    }
+}
+
+bool ConvoInfoVolatile::view_iterator::operator==(const view_iterator& other) const {
+    if (done() || other.done())
+        return done() && other.done();
+    return _it_11 == other._it_11 && _it_comm == other._it_comm && _it_lgroup == other._it_lgroup;
+}
+
+ConvoInfoVolatile::view_iterator& ConvoInfoVolatile::view_iterator::operator++() {
+    if (_it_11 != _end_11)
+        ++_it_11;
+    else if (!_it_comm.done())
+        _it_comm.advance();
+    else {
+        assert(_it_lgroup != _end_lgroup);
+        ++_it_lgroup;
+    }
+    _load_val();
+    return *this;
+}
+
 }  // namespace session::config
 
 using namespace session::config;
@@ -421,6 +775,10 @@ using namespace session::config;
 extern "C" {
 struct convo_info_volatile_iterator {
     void* _internals;
+    // Set (instead of _internals) for iterators over a precomputed list of conversations, such as
+    // the ordered list returned by convo_info_volatile_iterator_new_most_recent.
+    std::vector<convo::any>* _list;
+    size_t _list_pos;
 };
 }
 
@@ -540,6 +898,16 @@ LIBSESSION_C_API void convo_info_volatile_set_legacy_group(
     unbox<ConvoInfoVolatile>(conf)->set(convo::legacy_group{*convo});
 }
 
+LIBSESSION_C_API size_t convo_info_volatile_mark_read(
+        config_object* conf,
+        int64_t last_read,
+        bool one_to_one,
+        bool communities,
+        bool legacy_groups) {
+    return unbox<ConvoInfoVolatile>(conf)->mark_read(
+            last_read, one_to_one, communities, legacy_groups);
+}
+
 LIBSESSION_C_API bool convo_info_volatile_erase_1to1(config_object* conf, const char* session_id) {
     try {
         return unbox<ConvoInfoVolatile>(conf)->erase_1to1(session_id);
@@ -577,6 +945,19 @@ LIBSESSION_C_API size_t convo_info_volatile_size_legacy_groups(const config_obje
     return unbox<ConvoInfoVolatile>(conf)->size_legacy_groups();
 }
 
+LIBSESSION_C_API size_t convo_info_volatile_size_unread(const config_object* conf) {
+    return unbox<ConvoInfoVolatile>(conf)->size_unread();
+}
+LIBSESSION_C_API size_t convo_info_volatile_size_unread_1to1(const config_object* conf) {
+    return unbox<ConvoInfoVolatile>(conf)->size_unread_1to1();
+}
+LIBSESSION_C_API size_t convo_info_volatile_size_unread_communities(const config_object* conf) {
+    return unbox<ConvoInfoVolatile>(conf)->size_unread_communities();
+}
+LIBSESSION_C_API size_t convo_info_volatile_size_unread_legacy_groups(const config_object* conf) {
+    return unbox<ConvoInfoVolatile>(conf)->size_unread_legacy_groups();
+}
+
 LIBSESSION_C_API convo_info_volatile_iterator* convo_info_volatile_iterator_new(
         const config_object* conf) {
     auto* it = new convo_info_volatile_iterator{};
@@ -605,24 +986,39 @@ LIBSESSION_C_API convo_info_volatile_iterator* convo_info_volatile_iterator_new_
     return it;
 }
 
+LIBSESSION_C_API convo_info_volatile_iterator* convo_info_volatile_iterator_new_most_recent(
+        const config_object* conf, size_t limit, bool unread_only) {
+    auto* it = new convo_info_volatile_iterator{};
+    it->_list = new std::vector<convo::any>{
+            unbox<ConvoInfoVolatile>(conf)->most_recent(limit, unread_only)};
+    return it;
+}
+
 LIBSESSION_C_API void convo_info_volatile_iterator_free(convo_info_volatile_iterator* it) {
     delete static_cast<ConvoInfoVolatile::iterator*>(it->_internals);
+    delete it->_list;
     delete it;
 }
 
 LIBSESSION_C_API bool convo_info_volatile_iterator_done(convo_info_volatile_iterator* it) {
+    if (it->_list)
+        return it->_list_pos >= it->_list->size();
     auto& real = *static_cast<ConvoInfoVolatile::iterator*>(it->_internals);
     return real.done();
 }
 
 LIBSESSION_C_API void convo_info_volatile_iterator_advance(convo_info_volatile_iterator* it) {
-    ++*static_cast<ConvoInfoVolatile::iterator*>(it->_internals);
+    if (it->_list)
+        it->_list_pos++;
+    else
+        ++*static_cast<ConvoInfoVolatile::iterator*>(it->_internals);
 }
 
 namespace {
 template <typename Cpp, typename C>
 bool convo_info_volatile_it_is_impl(convo_info_volatile_iterator* it, C* c) {
-    auto& convo = **static_cast<ConvoInfoVolatile::iterator*>(it->_internals);
+    auto& convo = it->_list ? (*it->_list)[it->_list_pos]
+                            : **static_cast<ConvoInfoVolatile::iterator*>(it->_internals);
     if (auto* d = std::get_if<Cpp>(&convo)) {
         d->into(*c);
         return true;
@@ -2,10 +2,18 @@
 
 #include <oxenc/endian.h>
 #include <sodium/crypto_aead_xchacha20poly1305.h>
+#include <sodium/crypto_core_hchacha20.h>
 #include <sodium/crypto_generichash_blake2b.h>
+#include <sodium/crypto_onetimeauth_poly1305.h>
+#include <sodium/crypto_stream_chacha20.h>
+#include <sodium/utils.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <new>
+#include <optional>
+#include <thread>
 
 #include "session/export.h"
 
@@ -30,29 +38,94 @@ static constexpr size_t DOMAIN_MAX_SIZE = 24;
 static constexpr auto NONCE_KEY_PREFIX = "libsessionutil-config-encrypted-"sv;
 static_assert(NONCE_KEY_PREFIX.size() + DOMAIN_MAX_SIZE < crypto_generichash_blake2b_KEYBYTES_MAX);
 
-static std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_KEYBYTES> make_encrypt_key(
-        ustring_view key_base, uint64_t message_size, std::string_view domain) {
+static void check_key_base(ustring_view key_base) {
     if (key_base.size() != 32)
         throw std::invalid_argument{"encrypt called with key_base != 32 bytes"};
+}
+static void check_domain(std::string_view domain) {
     if (domain.size() < 1 || domain.size() > DOMAIN_MAX_SIZE)
         throw std::invalid_argument{"encrypt called with domain size not in [1, 24]"};
+}
+
+static void derive_encrypt_key(
+        unsigned char* key, ustring_view key_base, uint64_t message_size, std::string_view domain) {
+    check_key_base(key_base);
+    check_domain(domain);
 
     // We hash the key because we're using a deterministic nonce: the `key_base` value is expected
     // to be a long-term value for which nonce reuse (via hash collision) would be bad: by
     // incorporating the domain and message size we at least vary the key to further restrict the
     // nonce reuse concern to messages of identical sizes and identical domain.
-    std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_KEYBYTES> key{0};
     crypto_generichash_blake2b_state state;
-    crypto_generichash_blake2b_init(&state, nullptr, 0, key.size());
+    crypto_generichash_blake2b_init(
+            &state, nullptr, 0, crypto_aead_xchacha20poly1305_ietf_KEYBYTES);
     crypto_generichash_blake2b_update(&state, key_base.data(), key_base.size());
     oxenc::host_to_big_inplace(message_size);
     crypto_generichash_blake2b_update(
             &state, reinterpret_cast<const unsigned char*>(&message_size), sizeof(message_size));
     crypto_generichash_blake2b_update(&state, to_unsigned(domain.data()), domain.size());
-    crypto_generichash_blake2b_final(&state, key.data(), key.size());
+    crypto_generichash_blake2b_final(&state, key, crypto_aead_xchacha20poly1305_ietf_KEYBYTES);
+}
+
+static std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_KEYBYTES> make_encrypt_key(
+        ustring_view key_base, uint64_t message_size, std::string_view domain) {
+    std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_KEYBYTES> key{0};
+    derive_encrypt_key(key.data(), key_base, message_size, domain);
     return key;
 }
 
+static_assert(crypto_aead_xchacha20poly1305_ietf_KEYBYTES == 32);
+
+derived_key_cache::derived_key_cache(size_t capacity) : _capacity{capacity} {
+    if (_capacity == 0)
+        throw std::invalid_argument{"derived_key_cache capacity must be at least 1"};
+}
+
+derived_key_cache::~derived_key_cache() {
+    sodium_free(_keys);  // Also wipes the memory
+}
+
+const unsigned char* derived_key_cache::get(
+        size_t key_id, ustring_view key_base, uint64_t message_size, std::string_view domain) {
+    _uses++;
+    for (size_t i = 0; i < _entries.size(); i++) {
+        auto& e = _entries[i];
+        if (e.key_id == key_id && e.message_size == message_size && e.domain == domain) {
+            e.last_used = _uses;
+            return _keys + 32 * i;
+        }
+    }
+
+    if (!_keys) {
+        _keys = static_cast<unsigned char*>(sodium_allocarray(_capacity, 32));
+        if (!_keys)
+            throw std::bad_alloc{};
+    }
+
+    size_t i = _entries.size();
+    if (i == _capacity) {
+        i = 0;
+        for (size_t j = 1; j < _entries.size(); j++)
+            if (_entries[j].last_used < _entries[i].last_used)
+                i = j;
+    }
+
+    unsigned char* key = _keys + 32 * i;
+    derive_encrypt_key(key, key_base, message_size, domain);
+    entry e{key_id, message_size, std::string{domain}, _uses};
+    if (i == _entries.size())
+        _entries.push_back(std::move(e));
+    else
+        _entries[i] = std::move(e);
+    return key;
+}
+
+void derived_key_cache::clear() {
+    if (_keys)
+        sodium_memzero(_keys, 32 * _entries.size());
+    _entries.clear();
+}
+
 ustring encrypt(ustring_view message, ustring_view key_base, std::string_view domain) {
     ustring msg;
     msg.reserve(
@@ -63,7 +136,27 @@ ustring encrypt(ustring_view message, ustring_view key_base, std::string_view do
     return msg;
 }
 void encrypt_inplace(ustring& message, ustring_view key_base, std::string_view domain) {
-    auto key = make_encrypt_key(key_base, message.size(), domain);
+    size_t plaintext_len = message.size();
+    message.resize(
+            plaintext_len + crypto_aead_xchacha20poly1305_ietf_ABYTES +
+            crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
+    encrypt_inplace(message.data(), plaintext_len, key_base, domain);
+}
+void encrypt_inplace(
+        unsigned char* data,
+        size_t size,
+        ustring_view key_base,
+        std::string_view domain,
+        derived_key_cache* cache,
+        size_t key_id) {
+    std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_KEYBYTES> local_key;
+    const unsigned char* key;
+    if (cache) {
+        key = cache->get(key_id, key_base, size, domain);
+    } else {
+        local_key = make_encrypt_key(key_base, size, domain);
+        key = local_key.data();
+    }
 
     std::string nonce_key{NONCE_KEY_PREFIX};
     nonce_key += domain;
@@ -72,54 +165,51 @@ void encrypt_inplace(ustring& message, ustring_view key_base, std::string_view d
     crypto_generichash_blake2b(
             nonce.data(),
             nonce.size(),
-            message.data(),
-            message.size(),
+            data,
+            size,
             to_unsigned(nonce_key.data()),
             nonce_key.size());
 
-    size_t plaintext_len = message.size();
-    message.resize(
-            plaintext_len + crypto_aead_xchacha20poly1305_ietf_ABYTES +
-            crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
-
     unsigned long long outlen = 0;
     crypto_aead_xchacha20poly1305_ietf_encrypt(
-            message.data(),
-            &outlen,
-            message.data(),
-            plaintext_len,
-            nullptr,
-            0,
-            nullptr,
-            nonce.data(),
-            key.data());
+            data, &outlen, data, size, nullptr, 0, nullptr, nonce.data(), key);
 
-    assert(outlen == message.size() - crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
-    std::memcpy(message.data() + outlen, nonce.data(), nonce.size());
+    assert(outlen == size + crypto_aead_xchacha20poly1305_ietf_ABYTES);
+    std::memcpy(data + outlen, nonce.data(), nonce.size());
 }
 
 static_assert(
         ENCRYPT_DATA_OVERHEAD ==
         crypto_aead_xchacha20poly1305_IETF_ABYTES + crypto_aead_xchacha20poly1305_IETF_NPUBBYTES);
 
-ustring decrypt(ustring_view ciphertext, ustring_view key_base, std::string_view domain) {
-    ustring x{ciphertext};
-    decrypt_inplace(x, key_base, domain);
-    return x;
-}
-void decrypt_inplace(ustring& ciphertext, ustring_view key_base, std::string_view domain) {
+// Decrypts `ciphertext` into `out`, which must have room for the plaintext (i.e. the ciphertext
+// size minus the encryption overhead); `out` may be the same as `ciphertext.data()` to decrypt in
+// place.  Returns false if decryption fails.
+static bool decrypt_to(
+        unsigned char* out,
+        ustring_view ciphertext,
+        ustring_view key_base,
+        std::string_view domain,
+        derived_key_cache* cache = nullptr,
+        size_t key_id = 0) {
     size_t message_len = ciphertext.size() - crypto_aead_xchacha20poly1305_ietf_ABYTES -
                          crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
-    if (message_len > ciphertext.size())  // overflow
-        throw decrypt_error{"Decryption failed: ciphertext is too short"};
+    assert(message_len <= ciphertext.size());
 
-    ustring_view nonce = ustring_view{ciphertext}.substr(
+    ustring_view nonce = ciphertext.substr(
             ciphertext.size() - crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
-    auto key = make_encrypt_key(key_base, message_len, domain);
+    std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_KEYBYTES> local_key;
+    const unsigned char* key;
+    if (cache) {
+        key = cache->get(key_id, key_base, message_len, domain);
+    } else {
+        local_key = make_encrypt_key(key_base, message_len, domain);
+        key = local_key.data();
+    }
 
     unsigned long long mlen_wrote = 0;
     if (0 != crypto_aead_xchacha20poly1305_ietf_decrypt(
-                     ciphertext.data(),
+                     out,
                      &mlen_wrote,
                      nullptr,
                      ciphertext.data(),
@@ -127,11 +217,349 @@ void decrypt_inplace(ustring& ciphertext, ustring_view key_base, std::string_vie
                      nullptr,
                      0,
                      nonce.data(),
-                     key.data()))
-        throw decrypt_error{"Message decryption failed"};
+                     key))
+        return false;
 
     assert(mlen_wrote == message_len);
-    ciphertext.resize(mlen_wrote);
+    return true;
+}
+
+ustring decrypt(ustring_view ciphertext, ustring_view key_base, std::string_view domain) {
+    if (ciphertext.size() < ENCRYPT_DATA_OVERHEAD)
+        throw decrypt_error{"Decryption failed: ciphertext is too short"};
+    ustring x(ciphertext.size() - ENCRYPT_DATA_OVERHEAD, 0);
+    if (!decrypt_to(x.data(), ciphertext, key_base, domain))
+        throw decrypt_error{"Message decryption failed"};
+    return x;
+}
+void decrypt_inplace(ustring& ciphertext, ustring_view key_base, std::string_view domain) {
+    if (ciphertext.size() < ENCRYPT_DATA_OVERHEAD)
+        throw decrypt_error{"Decryption failed: ciphertext is too short"};
+    if (!decrypt_to(ciphertext.data(), ciphertext, key_base, domain))
+        throw decrypt_error{"Message decryption failed"};
+    ciphertext.resize(ciphertext.size() - ENCRYPT_DATA_OVERHEAD);
+}
+
+std::vector<decrypt_result> decrypt_many(
+        const std::vector<ustring_view>& ciphertexts,
+        const std::vector<ustring_view>& key_bases,
+        std::string_view domain,
+        ustring& arena,
+        derived_key_cache* cache) {
+    size_t total = 0;
+    for (const auto& c : ciphertexts)
+        if (c.size() >= ENCRYPT_DATA_OVERHEAD)
+            total += c.size() - ENCRYPT_DATA_OVERHEAD;
+    if (arena.size() < total)
+        arena.resize(total);
+
+    std::vector<decrypt_result> results(ciphertexts.size());
+    unsigned char* out = arena.data();
+    for (size_t i = 0; i < ciphertexts.size(); i++) {
+        const auto& c = ciphertexts[i];
+        if (c.size() < ENCRYPT_DATA_OVERHEAD)
+            continue;
+        size_t len = c.size() - ENCRYPT_DATA_OVERHEAD;
+        auto& r = results[i];
+        for (size_t k = 0; k < key_bases.size(); k++) {
+            if (decrypt_to(out, c, key_bases[k], domain, cache, k)) {
+                r.key = static_cast<int>(k);
+                break;
+            }
+        }
+        if (r) {
+            // Strip the prefix padding by just skipping over it:
+            size_t pad = 0;
+            while (pad < len && out[pad] == 0)
+                pad++;
+            r.plaintext = ustring_view{out + pad, len - pad};
+        }
+        out += len;
+    }
+    return results;
+}
+
+// Validates the key bases and domain of a batch operation on `n` messages, so that nothing can
+// throw once the (possibly multi-threaded) processing starts.
+static void check_batch(
+        size_t n, const std::vector<ustring_view>& key_bases, std::string_view domain) {
+    if (!(key_bases.size() == 1 || key_bases.size() == n))
+        throw std::invalid_argument{"batch requires either one key or one key per message"};
+    for (const auto& k : key_bases)
+        check_key_base(k);
+    check_domain(domain);
+}
+
+// Calls `f(i)` for each i in [0, n), splitting the range into contiguous slices run on up to
+// `threads` threads (the calling thread handles the first slice).
+template <typename F>
+static void run_batch(size_t n, size_t threads, const F& f) {
+    // Starting and joining a thread costs about as much as encrypting a few dozen typical config
+    // messages, so don't give a thread less than this many messages.
+    constexpr size_t MIN_PER_THREAD = 64;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, n / MIN_PER_THREAD));
+
+    auto run_slice = [&](size_t t) {
+        for (size_t i = n * t / threads; i < n * (t + 1) / threads; i++)
+            f(i);
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t t = 1; t < threads; t++)
+        workers.emplace_back(run_slice, t);
+    run_slice(0);
+    for (auto& w : workers)
+        w.join();
+}
+
+void encrypt_batch(
+        std::vector<ustring>& messages,
+        const std::vector<ustring_view>& key_bases,
+        std::string_view domain,
+        size_t threads) {
+    check_batch(messages.size(), key_bases, domain);
+    run_batch(messages.size(), threads, [&](size_t i) {
+        encrypt_inplace(messages[i], key_bases[key_bases.size() == 1 ? 0 : i], domain);
+    });
+}
+
+std::vector<bool> decrypt_batch(
+        std::vector<ustring>& ciphertexts,
+        const std::vector<ustring_view>& key_bases,
+        std::string_view domain,
+        size_t threads) {
+    check_batch(ciphertexts.size(), key_bases, domain);
+    // Not a vector<bool> because the threads can't safely write to adjacent bits of one:
+    std::vector<unsigned char> ok(ciphertexts.size(), 0);
+    run_batch(ciphertexts.size(), threads, [&](size_t i) {
+        auto& c = ciphertexts[i];
+        if (c.size() >= ENCRYPT_DATA_OVERHEAD &&
+            decrypt_to(c.data(), c, key_bases[key_bases.size() == 1 ? 0 : i], domain)) {
+            c.resize(c.size() - ENCRYPT_DATA_OVERHEAD);
+            ok[i] = 1;
+        } else {
+            // A failed decryption may have partially overwritten it, so don't leave it around:
+            c.clear();
+        }
+    });
+    return {ok.begin(), ok.end()};
+}
+
+namespace {
+
+    // The XChaCha20-Poly1305 (IETF) construction used by libsodium's
+    // crypto_aead_xchacha20poly1305_ietf_{en,de}crypt (with no additional data), broken into
+    // incremental steps so that a message can be processed a chunk at a time.
+    struct xchacha20poly1305_stream {
+        std::array<unsigned char, 32> subkey;
+        std::array<unsigned char, 12> nonce;  // The IETF ChaCha20 nonce
+        uint32_t counter = 1;                 // Block 0 is used for the Poly1305 key
+        std::array<unsigned char, 64> keystream;
+        size_t keystream_pos = 64;  // Position of unused keystream; 64 means there is none
+        crypto_onetimeauth_poly1305_state mac;
+        uint64_t length = 0;
+
+        xchacha20poly1305_stream(const unsigned char* key, const unsigned char* xnonce) {
+            crypto_core_hchacha20(subkey.data(), xnonce, key, nullptr);
+            std::memset(nonce.data(), 0, 4);
+            std::memcpy(nonce.data() + 4, xnonce + 16, 8);
+            std::array<unsigned char, 64> block0{0};
+            crypto_stream_chacha20_ietf(block0.data(), block0.size(), nonce.data(), subkey.data());
+            crypto_onetimeauth_poly1305_init(&mac, block0.data());
+            sodium_memzero(block0.data(), block0.size());
+        }
+        ~xchacha20poly1305_stream() {
+            sodium_memzero(subkey.data(), subkey.size());
+            sodium_memzero(keystream.data(), keystream.size());
+            sodium_memzero(&mac, sizeof(mac));
+        }
+
+        // XORs the next `n` bytes of keystream with `in`, writing to `out` (which may equal `in`).
+        void apply(const unsigned char* in, unsigned char* out, size_t n) {
+            // Use up any keystream left over from the end of the previous chunk:
+            for (; n && keystream_pos < keystream.size(); n--)
+                *out++ = *in++ ^ keystream[keystream_pos++];
+
+            if (size_t full = n / 64 * 64) {
+                crypto_stream_chacha20_ietf_xor_ic(
+                        out, in, full, nonce.data(), counter, subkey.data());
+                counter += full / 64;
+                in += full;
+                out += full;
+                n -= full;
+            }
+
+            if (n) {
+                keystream.fill(0);
+                crypto_stream_chacha20_ietf_xor_ic(
+                        keystream.data(),
+                        keystream.data(),
+                        keystream.size(),
+                        nonce.data(),
+                        counter++,
+                        subkey.data());
+                for (keystream_pos = 0; n; n--)
+                    *out++ = *in++ ^ keystream[keystream_pos++];
+            }
+        }
+
+        // Adds ciphertext to the authentication tag.
+        void authenticate(const unsigned char* ciphertext, size_t n) {
+            crypto_onetimeauth_poly1305_update(&mac, ciphertext, n);
+            length += n;
+        }
+
+        // Computes the authentication tag of everything given to `authenticate()`.
+        std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_ABYTES> tag() {
+            static constexpr unsigned char pad0[16] = {0};
+            crypto_onetimeauth_poly1305_update(&mac, pad0, (0x10 - length) & 0xf);
+            unsigned char lengths[16];
+            oxenc::write_host_as_little(uint64_t{0}, lengths);  // Additional data length
+            oxenc::write_host_as_little(length, lengths + 8);
+            crypto_onetimeauth_poly1305_update(&mac, lengths, sizeof(lengths));
+            std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_ABYTES> result;
+            crypto_onetimeauth_poly1305_final(&mac, result.data());
+            return result;
+        }
+    };
+
+}  // namespace
+
+struct stream_encryptor::state {
+    std::array<unsigned char, 32> key_base;
+    std::string domain;
+    std::string nonce_key;
+    crypto_generichash_blake2b_state hash;
+    uint64_t hashed = 0;
+    std::optional<xchacha20poly1305_stream> stream;
+    std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_NPUBBYTES> nonce;
+    // Hash of the plaintext given to `encrypt()`, to make sure it matches the first pass:
+    crypto_generichash_blake2b_state rehash;
+    bool finished = false;
+
+    ~state() { sodium_memzero(key_base.data(), key_base.size()); }
+};
+
+stream_encryptor::stream_encryptor(ustring_view key_base, std::string_view domain) :
+        _state{std::make_unique<state>()} {
+    check_key_base(key_base);
+    check_domain(domain);
+    std::memcpy(_state->key_base.data(), key_base.data(), key_base.size());
+    _state->domain = domain;
+    _state->nonce_key = NONCE_KEY_PREFIX;
+    _state->nonce_key += domain;
+    for (auto* h : {&_state->hash, &_state->rehash})
+        crypto_generichash_blake2b_init(
+                h,
+                to_unsigned(_state->nonce_key.data()),
+                _state->nonce_key.size(),
+                crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
+}
+stream_encryptor::~stream_encryptor() = default;
+stream_encryptor::stream_encryptor(stream_encryptor&&) noexcept = default;
+stream_encryptor& stream_encryptor::operator=(stream_encryptor&&) noexcept = default;
+
+void stream_encryptor::hash(ustring_view chunk) {
+    if (_state->stream)
+        throw std::logic_error{"stream_encryptor: hash() called after encrypt()"};
+    crypto_generichash_blake2b_update(&_state->hash, chunk.data(), chunk.size());
+    _state->hashed += chunk.size();
+}
+
+void stream_encryptor::encrypt(ustring_view chunk, unsigned char* out) {
+    auto& st = *_state;
+    if (st.finished)
+        throw std::logic_error{"stream_encryptor: encrypt() called after finish()"};
+    if (!st.stream) {
+        crypto_generichash_blake2b_final(&st.hash, st.nonce.data(), st.nonce.size());
+        auto key = make_encrypt_key({st.key_base.data(), st.key_base.size()}, st.hashed, st.domain);
+        st.stream.emplace(key.data(), st.nonce.data());
+        sodium_memzero(key.data(), key.size());
+    }
+    crypto_generichash_blake2b_update(&st.rehash, chunk.data(), chunk.size());
+    st.stream->apply(chunk.data(), out, chunk.size());
+    st.stream->authenticate(out, chunk.size());
+}
+
+ustring stream_encryptor::encrypt(ustring_view chunk) {
+    ustring out(chunk.size(), 0);
+    encrypt(chunk, out.data());
+    return out;
+}
+
+ustring stream_encryptor::finish() {
+    auto& st = *_state;
+    if (st.finished)
+        throw std::logic_error{"stream_encryptor: finish() called twice"};
+    if (!st.stream)
+        encrypt(ustring_view{});  // Empty message
+    st.finished = true;
+
+    std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_NPUBBYTES> check;
+    crypto_generichash_blake2b_final(&st.rehash, check.data(), check.size());
+    if (st.stream->length != st.hashed || sodium_memcmp(check.data(), st.nonce.data(), 24) != 0)
+        throw std::logic_error{
+                "stream_encryptor: encrypted data does not match the data given to hash()"};
+
+    auto tag = st.stream->tag();
+    ustring trailer;
+    trailer.reserve(ENCRYPT_DATA_OVERHEAD);
+    trailer.append(tag.data(), tag.size());
+    trailer.append(st.nonce.data(), st.nonce.size());
+    return trailer;
+}
+
+struct stream_decryptor::state {
+    std::optional<xchacha20poly1305_stream> stream;
+    std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_ABYTES> expected_tag;
+    uint64_t remaining;
+};
+
+stream_decryptor::stream_decryptor(
+        ustring_view key_base,
+        std::string_view domain,
+        size_t ciphertext_size,
+        ustring_view trailer) :
+        _state{std::make_unique<state>()} {
+    if (trailer.size() != ENCRYPT_DATA_OVERHEAD)
+        throw std::invalid_argument{"stream_decryptor: invalid trailer size"};
+    if (ciphertext_size < ENCRYPT_DATA_OVERHEAD)
+        throw decrypt_error{"Decryption failed: ciphertext is too short"};
+    _state->remaining = ciphertext_size - ENCRYPT_DATA_OVERHEAD;
+    auto key = make_encrypt_key(key_base, _state->remaining, domain);
+    std::memcpy(_state->expected_tag.data(), trailer.data(), _state->expected_tag.size());
+    _state->stream.emplace(key.data(), trailer.data() + _state->expected_tag.size());
+    sodium_memzero(key.data(), key.size());
+}
+stream_decryptor::~stream_decryptor() = default;
+stream_decryptor::stream_decryptor(stream_decryptor&&) noexcept = default;
+stream_decryptor& stream_decryptor::operator=(stream_decryptor&&) noexcept = default;
+
+void stream_decryptor::decrypt(ustring_view chunk, unsigned char* out) {
+    auto& st = *_state;
+    if (chunk.size() > st.remaining)
+        throw decrypt_error{"Decryption failed: ciphertext is longer than expected"};
+    st.remaining -= chunk.size();
+    // Authenticate first, because `out` may overwrite `chunk`:
+    st.stream->authenticate(chunk.data(), chunk.size());
+    st.stream->apply(chunk.data(), out, chunk.size());
+}
+
+ustring stream_decryptor::decrypt(ustring_view chunk) {
+    ustring out(chunk.size(), 0);
+    decrypt(chunk, out.data());
+    return out;
+}
+
+void stream_decryptor::finish() {
+    auto& st = *_state;
+    if (st.remaining > 0)
+        throw decrypt_error{"Decryption failed: ciphertext is incomplete"};
+    auto tag = st.stream->tag();
+    if (sodium_memcmp(tag.data(), st.expected_tag.data(), tag.size()) != 0)
+        throw decrypt_error{"Message decryption failed"};
 }
 
 void pad_message(ustring& data, size_t overhead) {
@@ -49,6 +49,25 @@ void make_lc(std::string& s) {
             c += ('a' - 'A');
 }
 
+ConfigBase::async_executor c_executor(
+        void (*executor)(void (*run)(void* task), void* task, void* ctx), void* ctx) {
+    if (!executor)
+        return nullptr;
+    return [executor, ctx](std::function<void()> task) {
+        // The task is heap allocated and handed to the C executor, which gives it back to us by
+        // calling `run`, at which point we invoke and free it.
+        auto* t = new std::function<void()>{std::move(task)};
+        executor(
+                [](void* task) {
+                    std::unique_ptr<std::function<void()>> t{
+                            static_cast<std::function<void()>*>(task)};
+                    (*t)();
+                },
+                t,
+                ctx);
+    };
+}
+
 template <typename Scalar>
 const Scalar* maybe_scalar(const session::config::dict& d, const char* key) {
     if (auto it = d.find(key); it != d.end())
@@ -25,7 +25,7 @@ template <typename ConfigT>
         dump.emplace(dumpstr, dumplen);
 
     try {
-        c->config = std::make_unique<ConfigT>(ed25519_secretkey, dump);
+        c->config = std::make_unique<async_config<ConfigT>>(ed25519_secretkey, dump);
     } catch (const std::exception& e) {
         if (error) {
             std::string msg = e.what();
@@ -67,6 +67,11 @@ ustring decode_pubkey(std::string_view pk);
 // Modifies a string to be (ascii) lowercase.
 void make_lc(std::string& s);
 
+// Wraps a C executor function (as given to `config_set_executor`) and its context pointer in a
+// C++ executor.  Returns an empty executor if `executor` is NULL.
+ConfigBase::async_executor c_executor(
+        void (*executor)(void (*run)(void* task), void* task, void* ctx), void* ctx);
+
 // Digs into a config `dict` to get out a config::set; nullptr if not there (or not set)
 const config::set* maybe_set(const session::config::dict& d, const char* key);
 
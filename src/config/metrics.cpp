@@ -0,0 +1,143 @@
+#include "session/config/metrics.hpp"
+
+#include <algorithm>
+
+#include "session/config/base.hpp"
+#include "session/config/metrics.h"
+#include "session/export.h"
+
+namespace session::config {
+
+static_assert(METRIC_PHASES == CONFIG_METRIC_PHASES);
+static_assert(METRIC_BUCKETS == CONFIG_METRIC_BUCKETS);
+static_assert(static_cast<int>(metric_phase::dump) == CONFIG_PHASE_DUMP);
+
+// Returns the histogram bucket for a duration: 0 for < 1us, otherwise the number of bits in the
+// whole microsecond count (so that bucket i holds [2^(i-1), 2^i) us), capped at the last bucket.
+static size_t bucket_index(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    size_t i = 0;
+    while (us && i < METRIC_BUCKETS - 1) {
+        us >>= 1;
+        i++;
+    }
+    return i;
+}
+
+double latency_histogram::percentile_us(double p) const {
+    if (!count)
+        return 0;
+    auto target = static_cast<uint64_t>(p * count + 0.5);
+    if (target < 1)
+        target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < METRIC_BUCKETS - 1; i++) {
+        seen += buckets[i];
+        if (seen >= target)
+            return std::min<double>(uint64_t{1} << i, max_ns / 1000.0);
+    }
+    return max_ns / 1000.0;
+}
+
+void metrics_registry::record(metric_phase phase, std::chrono::nanoseconds elapsed) {
+    auto ns = static_cast<uint64_t>(elapsed.count());
+    auto& h = _phases[static_cast<size_t>(phase)];
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    // There is only ever one updating thread, so this doesn't need to be a compare-exchange loop.
+    if (ns > h.max_ns.load(std::memory_order_relaxed))
+        h.max_ns.store(ns, std::memory_order_relaxed);
+    h.buckets[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+metrics_snapshot metrics_registry::snapshot() const {
+    metrics_snapshot s;
+    s.merge_messages = merge_messages.load(std::memory_order_relaxed);
+    s.merge_bytes = merge_bytes.load(std::memory_order_relaxed);
+    s.merge_cache_hits = merge_cache_hits.load(std::memory_order_relaxed);
+    s.decrypt_attempts = decrypt_attempts.load(std::memory_order_relaxed);
+    s.decrypt_failures = decrypt_failures.load(std::memory_order_relaxed);
+    s.parse_failures = parse_failures.load(std::memory_order_relaxed);
+    s.decompress_in_bytes = decompress_in_bytes.load(std::memory_order_relaxed);
+    s.decompress_out_bytes = decompress_out_bytes.load(std::memory_order_relaxed);
+    s.compress_in_bytes = compress_in_bytes.load(std::memory_order_relaxed);
+    s.compress_out_bytes = compress_out_bytes.load(std::memory_order_relaxed);
+    s.push_bytes = push_bytes.load(std::memory_order_relaxed);
+    s.dump_bytes = dump_bytes.load(std::memory_order_relaxed);
+    s.merge_conflicts = merge_conflicts.load(std::memory_order_relaxed);
+    s.lag_bytes_saved = lag_bytes_saved.load(std::memory_order_relaxed);
+    for (size_t p = 0; p < METRIC_PHASES; p++) {
+        auto& from = _phases[p];
+        auto& to = s.phases[p];
+        to.count = from.count.load(std::memory_order_relaxed);
+        to.total_ns = from.total_ns.load(std::memory_order_relaxed);
+        to.max_ns = from.max_ns.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < METRIC_BUCKETS; i++)
+            to.buckets[i] = from.buckets[i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+void metrics_registry::reset() {
+    for (auto* c :
+         {&merge_messages,
+          &merge_bytes,
+          &merge_cache_hits,
+          &decrypt_attempts,
+          &decrypt_failures,
+          &parse_failures,
+          &decompress_in_bytes,
+          &decompress_out_bytes,
+          &compress_in_bytes,
+          &compress_out_bytes,
+          &push_bytes,
+          &dump_bytes,
+          &merge_conflicts,
+          &lag_bytes_saved})
+        c->store(0, std::memory_order_relaxed);
+    for (auto& h : _phases) {
+        h.count.store(0, std::memory_order_relaxed);
+        h.total_ns.store(0, std::memory_order_relaxed);
+        h.max_ns.store(0, std::memory_order_relaxed);
+        for (auto& b : h.buckets)
+            b.store(0, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace session::config
+
+using namespace session::config;
+
+extern "C" {
+
+LIBSESSION_C_API void config_get_metrics(const config_object* conf, config_metrics* metrics) {
+    auto m = unbox(conf)->metrics();
+    metrics->merge_messages = m.merge_messages;
+    metrics->merge_bytes = m.merge_bytes;
+    metrics->merge_cache_hits = m.merge_cache_hits;
+    metrics->decrypt_attempts = m.decrypt_attempts;
+    metrics->decrypt_failures = m.decrypt_failures;
+    metrics->parse_failures = m.parse_failures;
+    metrics->decompress_in_bytes = m.decompress_in_bytes;
+    metrics->decompress_out_bytes = m.decompress_out_bytes;
+    metrics->compress_in_bytes = m.compress_in_bytes;
+    metrics->compress_out_bytes = m.compress_out_bytes;
+    metrics->push_bytes = m.push_bytes;
+    metrics->dump_bytes = m.dump_bytes;
+    metrics->merge_conflicts = m.merge_conflicts;
+    metrics->lag_bytes_saved = m.lag_bytes_saved;
+    for (size_t p = 0; p < METRIC_PHASES; p++) {
+        auto& from = m.phases[p];
+        auto& to = metrics->phases[p];
+        to.count = from.count;
+        to.total_ns = from.total_ns;
+        to.max_ns = from.max_ns;
+        std::copy(from.buckets.begin(), from.buckets.end(), to.buckets);
+    }
+}
+
+LIBSESSION_C_API void config_reset_metrics(config_object* conf) {
+    unbox(conf)->reset_metrics();
+}
+
+}  // extern "C"
@@ -217,6 +217,14 @@ ConfigBase::DictFieldProxy UserGroups::community_field(
 std::optional<community_info> UserGroups::get_community(
         std::string_view base_url, std::string_view room) const {
     community_info og{base_url, room};
+    return get_community_impl(std::move(og));
+}
+
+std::optional<community_info> UserGroups::get_community(const community_key& key) const {
+    return get_community_impl(community_info{key});
+}
+
+std::optional<community_info> UserGroups::get_community_impl(community_info og) const {
 
     ustring_view pubkey;
     if (auto* info_dict = community_field(og, &pubkey).dict()) {
@@ -253,6 +261,17 @@ community_info UserGroups::get_or_construct_community(
     return result;
 }
 
+community_info UserGroups::get_or_construct_community(
+        const community_key& key, ustring_view pubkey) const {
+    community_info result{key};
+    result.set_pubkey(pubkey);
+
+    if (auto* info_dict = community_field(result).dict())
+        result.load(*info_dict);
+
+    return result;
+}
+
 community_info UserGroups::get_or_construct_community(std::string_view full_url) const {
     auto [base, room, pubkey] = community::parse_full_url(full_url);
     return get_or_construct_community(base, room, pubkey);
@@ -347,10 +366,165 @@ bool UserGroups::erase(const any_group_info& c) {
 bool UserGroups::erase_community(std::string_view base_url, std::string_view room) {
     return erase(community_info{base_url, room});
 }
+bool UserGroups::erase_community(const community_key& key) {
+    return erase(community_info{key});
+}
 bool UserGroups::erase_legacy_group(std::string_view id) {
     return erase(legacy_group_info{std::string{id}});
 }
 
+namespace {
+    // Which of the member ("m") and admin ("a") sets of a legacy group record contain a given
+    // session id.
+    struct legacy_member_sets {
+        bool member = false;
+        bool admin = false;
+
+        // nullopt if not a member, otherwise true for an admin and false for a regular member.  An
+        // id in both sets is a regular member, as in `legacy_group_info::load`.
+        std::optional<bool> status() const {
+            if (member)
+                return false;
+            if (admin)
+                return true;
+            return std::nullopt;
+        }
+    };
+
+    legacy_member_sets find_legacy_member(
+            const ConfigBase::DictFieldProxy& info, const scalar& sid) {
+        legacy_member_sets in;
+        if (auto* members = info["m"].set())
+            in.member = members->count(sid);
+        if (auto* admins = info["a"].set())
+            in.admin = admins->count(sid);
+        return in;
+    }
+
+    // Stores `sid` as an admin or regular member, leaving it in exactly one of the two sets.
+    void store_legacy_member(
+            ConfigBase::DictFieldProxy& info,
+            const std::string& sid,
+            const legacy_member_sets& in,
+            bool admin) {
+        if (admin ? in.member : in.admin)
+            info[admin ? "m" : "a"].set_erase(sid);
+        if (!(admin ? in.admin : in.member))
+            info[admin ? "a" : "m"].set_insert(sid);
+    }
+}  // namespace
+
+bool UserGroups::add_member(std::string_view group_id, std::string_view session_id, bool admin) {
+    auto info = data["C"][session_id_to_bytes(group_id)];
+    std::string sid = session_id_to_bytes(session_id);
+    if (!info.dict())
+        return false;
+
+    auto in = find_legacy_member(info, sid);
+    bool changed = in.status() != admin;
+    if (changed || (in.member && in.admin))
+        store_legacy_member(info, sid, in, admin);
+    return changed;
+}
+
+bool UserGroups::remove_member(std::string_view group_id, std::string_view session_id) {
+    auto info = data["C"][session_id_to_bytes(group_id)];
+    std::string sid = session_id_to_bytes(session_id);
+    if (!info.dict())
+        return false;
+
+    auto in = find_legacy_member(info, sid);
+    if (in.member)
+        info["m"].set_erase(sid);
+    if (in.admin)
+        info["a"].set_erase(sid);
+    return in.member || in.admin;
+}
+
+bool UserGroups::set_admin(std::string_view group_id, std::string_view session_id, bool admin) {
+    auto info = data["C"][session_id_to_bytes(group_id)];
+    std::string sid = session_id_to_bytes(session_id);
+    if (!info.dict())
+        return false;
+
+    auto in = find_legacy_member(info, sid);
+    auto status = in.status();
+    if (!status)
+        return false;
+    bool changed = *status != admin;
+    if (changed || (in.member && in.admin))
+        store_legacy_member(info, sid, in, admin);
+    return changed;
+}
+
+UserGroups::legacy_members_view UserGroups::legacy_members(std::string_view group_id) const {
+    legacy_members_view view;
+    auto info = data["C"][session_id_to_bytes(group_id)];
+    if (info.dict()) {
+        view._members = info["m"].set();
+        view._admins = info["a"].set();
+    }
+    return view;
+}
+
+std::string UserGroups::legacy_member::session_id_hex() const {
+    return oxenc::to_hex(session_id);
+}
+
+// Returns a pointer to the session id string held in a member set value, or nullptr if the value
+// is not a valid session id (and thus should be skipped, as `legacy_group_info::load` does).
+static const std::string* member_sid(const scalar& s) {
+    auto* sid = std::get_if<std::string>(&s);
+    if (sid && sid->size() == 33 && (*sid)[0] == 0x05)
+        return sid;
+    return nullptr;
+}
+
+UserGroups::legacy_members_iterator::legacy_members_iterator(
+        const config::set* members, const config::set* admins) {
+    if (members) {
+        _m = members->begin();
+        _m_end = members->end();
+    }
+    if (admins) {
+        _a = admins->begin();
+        _a_end = admins->end();
+    }
+    _load_val();
+}
+
+// The member and admin sets are both sorted, so we walk them together, merge-style, to produce
+// members in sorted order.  An id present in both sets is reported once, as a non-admin, to match
+// `legacy_group_info::load`.
+void UserGroups::legacy_members_iterator::_load_val() {
+    while (_m != _m_end && !member_sid(*_m))
+        ++_m;
+    while (_a != _a_end && !member_sid(*_a))
+        ++_a;
+    if (_m != _m_end && (_a == _a_end || *_m <= *_a))
+        _val = {*member_sid(*_m), false};
+    else if (_a != _a_end)
+        _val = {*member_sid(*_a), true};
+}
+
+UserGroups::legacy_members_iterator& UserGroups::legacy_members_iterator::operator++() {
+    if (_m != _m_end && (_a == _a_end || *_m <= *_a)) {
+        if (_a != _a_end && *_a == *_m)
+            ++_a;
+        ++_m;
+    } else {
+        ++_a;
+    }
+    _load_val();
+    return *this;
+}
+
+bool UserGroups::legacy_members_iterator::operator==(const legacy_members_iterator& other) const {
+    if (done() || other.done())
+        return done() && other.done();
+    return _m == other._m && _a == other._a;
+}
+
 size_t UserGroups::size_communities() const {
     size_t count = 0;
     auto og = data["o"];
@@ -442,6 +616,112 @@ UserGroups::iterator& UserGroups::iterator::operator++() {
     return *this;
 }
 
+UserGroups::view_range UserGroups::view(bool communities, bool legacy_groups) const {
+    view_range range;
+    if (communities)
+        range._communities = data["o"].dict();
+    if (legacy_groups)
+        range._legacy_groups = data["C"].dict();
+    return range;
+}
+
+int UserGroups::group_view::priority() const {
+    return maybe_int(*info, "+").value_or(0);
+}
+
+int64_t UserGroups::group_view::joined_at() const {
+    return std::max<int64_t>(0, maybe_int(*info, "j").value_or(0));
+}
+
+notify_mode UserGroups::group_view::notifications() const {
+    int notify = maybe_int(*info, "@").value_or(0);
+    if (notify >= 0 && notify <= 3)
+        return static_cast<notify_mode>(notify);
+    return notify_mode::defaulted;
+}
+
+int64_t UserGroups::group_view::mute_until() const {
+    return maybe_int(*info, "!").value_or(0);
+}
+
+std::string_view UserGroups::group_view::name() const {
+    if (auto n = maybe_sv(*info, "n"))
+        return *n;
+    return room;
+}
+
+std::string UserGroups::group_view::id_hex() const {
+    if (is_community())
+        return "";
+    return oxenc::to_hex(id);
+}
+
+any_group_info UserGroups::group_view::load() const {
+    if (is_legacy_group()) {
+        legacy_group_info g{oxenc::to_hex(id)};
+        g.load(*info);
+        return g;
+    }
+    community_info g{id, room, pubkey};
+    g.load(*info);
+    return g;
+}
+
+UserGroups::view_iterator::view_iterator(const dict* communities, const dict* legacy_groups) {
+    if (communities)
+        _it_comm = comm_view_helper{*communities};
+    if (legacy_groups) {
+        _it_legacy = legacy_groups->begin();
+        _end_legacy = legacy_groups->end();
+    }
+    _load_val();
+}
+
+// Points _val at the current record, skipping invalid records in the same way as the regular
+// iterator: we exhaust communities first, then legacy groups.
+void UserGroups::view_iterator::_load_val() {
+    // The stored name replaces the room when loading, so also skip rooms with an invalid one:
+    while (!_it_comm.done()) {
+        auto n = maybe_sv(_it_comm.room_info(), "n");
+        if (!n || community::valid_room(*n))
+            break;
+        _it_comm.advance();
+    }
+    if (!_it_comm.done()) {
+        _val = {'o',
+                _it_comm.base_url(),
+                _it_comm.room(),
+                _it_comm.pubkey(),
+                &_it_comm.room_info()};
+        return;
+    }
+
+    for (; _it_legacy != _end_legacy; ++_it_legacy) {
+        auto& [k, v] = *_it_legacy;
+        if (auto* info = std::get_if<dict>(&v); info && k.size() == 33 && k[0] == 0x05) {
+            _val = {'C', k, {}, {}, info};
+            return;
+        }
+    }
+}
+
+bool UserGroups::view_iterator::operator==(const view_iterator& other) const {
+    if (done() || other.done())
+        return done() && other.done();
+    return _it_comm == other._it_comm && _it_legacy == other._it_legacy;
+}
+
+UserGroups::view_iterator& UserGroups::view_iterator::operator++() {
+    if (!_it_comm.done())
+        _it_comm.advance();
+    else {
+        assert(_it_legacy != _end_legacy);
+        ++_it_legacy;
+    }
+    _load_val();
+    return *this;
+}
+
 }  // namespace session::config
 
 using namespace session::config;
@@ -563,6 +843,78 @@ LIBSESSION_C_API bool user_groups_erase_legacy_group(config_object* conf, const
     }
 }
 
+LIBSESSION_C_API bool user_groups_legacy_add_member(
+        config_object* conf, const char* group_id, const char* session_id, bool admin) {
+    try {
+        conf->last_error = nullptr;
+        return unbox<UserGroups>(conf)->add_member(group_id, session_id, admin);
+    } catch (const std::exception& e) {
+        copy_c_str(conf->_error_buf, e.what());
+        conf->last_error = conf->_error_buf;
+    }
+    return false;
+}
+
+LIBSESSION_C_API bool user_groups_legacy_remove_member(
+        config_object* conf, const char* group_id, const char* session_id) {
+    try {
+        conf->last_error = nullptr;
+        return unbox<UserGroups>(conf)->remove_member(group_id, session_id);
+    } catch (const std::exception& e) {
+        copy_c_str(conf->_error_buf, e.what());
+        conf->last_error = conf->_error_buf;
+    }
+    return false;
+}
+
+LIBSESSION_C_API bool user_groups_legacy_set_admin(
+        config_object* conf, const char* group_id, const char* session_id, bool admin) {
+    try {
+        conf->last_error = nullptr;
+        return unbox<UserGroups>(conf)->set_admin(group_id, session_id, admin);
+    } catch (const std::exception& e) {
+        copy_c_str(conf->_error_buf, e.what());
+        conf->last_error = conf->_error_buf;
+    }
+    return false;
+}
+
+struct ugroups_legacy_members_view {
+    UserGroups::legacy_members_iterator it;
+    bool need_advance = false;
+};
+
+LIBSESSION_C_API ugroups_legacy_members_view* ugroups_legacy_members_view_begin(
+        config_object* conf, const char* group_id) {
+    try {
+        conf->last_error = nullptr;
+        return new ugroups_legacy_members_view{
+                unbox<UserGroups>(conf)->legacy_members(group_id).begin()};
+    } catch (const std::exception& e) {
+        copy_c_str(conf->_error_buf, e.what());
+        conf->last_error = conf->_error_buf;
+    }
+    return nullptr;
+}
+
+LIBSESSION_C_API bool ugroups_legacy_members_view_next(
+        ugroups_legacy_members_view* it, const unsigned char** session_id, bool* admin) {
+    if (it->need_advance)
+        ++it->it;
+    else
+        it->need_advance = true;
+
+    if (it->it.done())
+        return false;
+    *session_id = reinterpret_cast<const unsigned char*>(it->it->session_id.data());
+    *admin = it->it->admin;
+    return true;
+}
+
+LIBSESSION_C_API void ugroups_legacy_members_view_free(ugroups_legacy_members_view* it) {
+    delete it;
+}
+
 struct ugroups_legacy_members_iterator {
     using map_t = std::map<std::string, bool>;
     map_t& members;
@@ -6,12 +6,18 @@
 #include <sodium/crypto_scalarmult_ed25519.h>
 #include <sodium/crypto_sign_ed25519.h>
 #include <sodium/randombytes.h>
+#include <sodium/utils.h>
 
 #include <cassert>
 #include <cstring>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 
 #include "session/export.h"
+#include "session/xed25519.h"
 
 namespace session::xed25519 {
 
@@ -86,17 +92,124 @@ namespace {
         crypto_core_ed25519_scalar_reduce(S, hram.data());
     }
 
+    // Converts a curve25519 pubkey into its (positive) XEd25519 Ed25519 pubkey.
+    bytes<32> montx_to_edy(const unsigned char* curve25519_pubkey) {
+        fe25519 u, y;
+        crypto_internal_fe25519_frombytes(u, curve25519_pubkey);
+        fe25519_montx_to_edy(y, u);
+
+        bytes<32> ed_pubkey;
+        crypto_internal_fe25519_tobytes(ed_pubkey.data(), y);
+        return ed_pubkey;
+    }
+
+    // Bounded LRU cache of curve25519 -> Ed25519 pubkey conversions.  In practice the same few
+    // pubkeys get verified over and over, so this lets us skip the conversion (and its field
+    // inversion) for them.  Safe to use from multiple threads.
+    class pubkey_cache {
+      public:
+        std::optional<bytes<32>> get(const bytes<32>& curve25519_pubkey) {
+            std::lock_guard lock{mutex};
+            auto it = index.find(curve25519_pubkey);
+            if (it == index.end())
+                return std::nullopt;
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->second;
+        }
+
+        void put(const bytes<32>& curve25519_pubkey, const bytes<32>& ed25519_pubkey) {
+            std::lock_guard lock{mutex};
+            if (auto it = index.find(curve25519_pubkey); it != index.end()) {
+                lru.splice(lru.begin(), lru, it->second);
+                return;
+            }
+            lru.emplace_front(curve25519_pubkey, ed25519_pubkey);
+            index.emplace(curve25519_pubkey, lru.begin());
+            if (lru.size() > PUBKEY_CACHE_SIZE) {
+                index.erase(lru.back().first);
+                lru.pop_back();
+            }
+        }
+
+      private:
+        std::mutex mutex;
+        // [[curve25519, ed25519], ...], most recently used first
+        std::list<std::pair<bytes<32>, bytes<32>>> lru;
+        std::map<bytes<32>, decltype(lru)::iterator> index;
+    };
+
+    pubkey_cache& converted_pubkeys() {
+        static pubkey_cache cache;
+        return cache;
+    }
+
+    // Wrapper so that field elements (which are C arrays) can be held in a vector.
+    struct fe {
+        fe25519 v;
+    };
+
+    // Converts the curve25519 pubkeys `u` into XEd25519 Ed25519 pubkeys, exactly as `pubkey()`
+    // does, but using Montgomery's trick to replace the per-key field inversion of `u + 1` with
+    // a single inversion plus three multiplications per key.
+    std::vector<bytes<32>> montx_to_edy_batch(const std::vector<const unsigned char*>& u) {
+        const size_t n = u.size();
+        std::vector<bytes<32>> result(n);
+        if (n == 0)
+            return result;
+
+        fe25519 one;
+        crypto_internal_fe25519_1(one);
+
+        // um1[i] = u - 1, up1[i] = u + 1, prod[i] = up1[0] * ... * up1[i].  `u + 1` is zero only
+        // for the (invalid) pubkey u = -1, for which the inversion would yield zero; we substitute
+        // 1 so that it doesn't poison the rest of the batch, then zero its inverse below.
+        std::vector<fe> um1(n), up1(n), prod(n);
+        std::vector<bool> zero(n);
+        bytes<32> tmp;
+        for (size_t i = 0; i < n; i++) {
+            fe25519 x;
+            crypto_internal_fe25519_frombytes(x, u[i]);
+            crypto_internal_fe25519_sub(um1[i].v, x, one);
+            crypto_internal_fe25519_add(up1[i].v, x, one);
+            crypto_internal_fe25519_tobytes(tmp.data(), up1[i].v);
+            if (sodium_is_zero(tmp.data(), tmp.size())) {
+                zero[i] = true;
+                crypto_internal_fe25519_1(up1[i].v);
+            }
+            if (i == 0)
+                std::memcpy(prod[0].v, up1[0].v, sizeof(fe25519));
+            else
+                crypto_internal_fe25519_mul(prod[i].v, prod[i - 1].v, up1[i].v);
+        }
+
+        fe25519 inv;  // Inverse of prod[i] as we walk back down
+        crypto_internal_fe25519_invert(inv, prod[n - 1].v);
+        for (size_t i = n; i-- > 0;) {
+            fe25519 inv_i, y;
+            if (i > 0) {
+                crypto_internal_fe25519_mul(inv_i, inv, prod[i - 1].v);
+                crypto_internal_fe25519_mul(inv, inv, up1[i].v);
+            } else {
+                std::memcpy(inv_i, inv, sizeof(fe25519));
+            }
+            if (zero[i])
+                crypto_internal_fe25519_0(inv_i);
+            crypto_internal_fe25519_mul(y, um1[i].v, inv_i);
+            crypto_internal_fe25519_tobytes(result[i].data(), y);
+        }
+        return result;
+    }
+
     ustring_view as_unsigned_sv(std::string_view x) {
         return {reinterpret_cast<const unsigned char*>(x.data()), x.size()};
     }
 
 }  // namespace
 
-bytes<64> sign(ustring_view curve25519_privkey, ustring_view msg) {
-
-    assert(curve25519_privkey.size() == 32);
+signer::signer(ustring_view curve25519_privkey) {
+    if (curve25519_privkey.size() != 32)
+        throw std::invalid_argument{"xed25519::signer requires a 32-byte curve25519 privkey"};
 
-    bytes<32> A;
     // Convert the x25519 privkey to an ed25519 pubkey:
     crypto_scalarmult_ed25519_base(A.data(), curve25519_privkey.data());
 
@@ -105,14 +218,24 @@ bytes<64> sign(ustring_view curve25519_privkey, ustring_view msg) {
 
     A[31] &= 0x7f;
 
-    bytes<32> a, neg_a;
+    bytes<32> neg_a;
     std::memcpy(a.data(), curve25519_privkey.data(), a.size());
     crypto_core_ed25519_scalar_negate(neg_a.data(), a.data());
     constant_time_conditional_assign(a, neg_a, negative);
+    sodium_memzero(neg_a.data(), neg_a.size());
 
     // We now have our a, A privkey/public.  (Note that a is just the private key scalar, *not* the
     // ed25519 secret key).
+}
+
+signer::signer(std::string_view curve25519_privkey) :
+        signer{as_unsigned_sv(curve25519_privkey)} {}
 
+signer::~signer() {
+    sodium_memzero(a.data(), a.size());
+}
+
+bytes<64> signer::sign(ustring_view msg) const {
     bytes<32> r = xed25519_compute_r(a, msg);
     bytes<64> signature;  // R || S
     auto* R = signature.data();
@@ -125,9 +248,20 @@ bytes<64> sign(ustring_view curve25519_privkey, ustring_view msg) {
     crypto_core_ed25519_scalar_mul(S, S, a.data());  // S *= a
     crypto_core_ed25519_scalar_add(S, S, r.data());  // S += r
 
+    sodium_memzero(r.data(), r.size());
     return signature;
 }
 
+std::string signer::sign(std::string_view msg) const {
+    auto sig = sign(as_unsigned_sv(msg));
+    return std::string{reinterpret_cast<const char*>(sig.data()), sig.size()};
+}
+
+bytes<64> sign(ustring_view curve25519_privkey, ustring_view msg) {
+    assert(curve25519_privkey.size() == 32);
+    return signer{curve25519_privkey}.sign(msg);
+}
+
 std::string sign(std::string_view curve25519_privkey, std::string_view msg) {
     auto sig = sign(as_unsigned_sv(curve25519_privkey), as_unsigned_sv(msg));
     return std::string{reinterpret_cast<const char*>(sig.data()), sig.size()};
@@ -146,14 +280,102 @@ bool verify(std::string_view signature, std::string_view curve25519_pubkey, std:
             as_unsigned_sv(signature), as_unsigned_sv(curve25519_pubkey), as_unsigned_sv(msg));
 }
 
-std::array<unsigned char, 32> pubkey(ustring_view curve25519_pubkey) {
-    fe25519 u, y;
-    crypto_internal_fe25519_frombytes(u, curve25519_pubkey.data());
-    fe25519_montx_to_edy(y, u);
+std::vector<bool> verify_batch(const std::vector<verify_item>& items) {
+    std::vector<bool> result(items.size(), false);
+
+    // Each distinct pubkey only needs converting once, and not at all if it is in the conversion
+    // cache; key_index maps items to the converted keys.
+    auto& cache = converted_pubkeys();
+    std::map<bytes<32>, size_t> key_ids;
+    std::vector<bytes<32>> ed_pubkeys;
+    std::vector<const unsigned char*> uncached;
+    std::vector<size_t> uncached_ids;
+    std::vector<size_t> key_index(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        const auto& item = items[i];
+        if (item.signature.size() != crypto_sign_ed25519_BYTES ||
+            item.curve25519_pubkey.size() != 32)
+            continue;
+        bytes<32> k;
+        std::memcpy(k.data(), item.curve25519_pubkey.data(), k.size());
+        auto [it, ins] = key_ids.emplace(k, ed_pubkeys.size());
+        if (ins) {
+            auto& ed = ed_pubkeys.emplace_back();
+            if (auto cached = cache.get(k)) {
+                ed = *cached;
+            } else {
+                uncached.push_back(item.curve25519_pubkey.data());
+                uncached_ids.push_back(it->second);
+            }
+        }
+        key_index[i] = it->second;
+    }
+
+    auto converted = montx_to_edy_batch(uncached);
+    for (size_t j = 0; j < converted.size(); j++) {
+        ed_pubkeys[uncached_ids[j]] = converted[j];
+        bytes<32> k;
+        std::memcpy(k.data(), uncached[j], k.size());
+        cache.put(k, converted[j]);
+    }
+
+    for (size_t i = 0; i < items.size(); i++) {
+        const auto& item = items[i];
+        if (item.signature.size() != crypto_sign_ed25519_BYTES ||
+            item.curve25519_pubkey.size() != 32)
+            continue;
+        result[i] = 0 == crypto_sign_ed25519_verify_detached(
+                                 item.signature.data(),
+                                 item.msg.data(),
+                                 item.msg.size(),
+                                 ed_pubkeys[key_index[i]].data());
+    }
+    return result;
+}
 
-    std::array<unsigned char, 32> ed_pubkey;
-    crypto_internal_fe25519_tobytes(ed_pubkey.data(), y);
+std::vector<bool> verify_batch(
+        ustring_view curve25519_pubkey,
+        const std::vector<std::pair<ustring_view, ustring_view>>& data_sigs) {
+    return verifier{curve25519_pubkey}.verify_batch(data_sigs);
+}
+
+verifier::verifier(ustring_view curve25519_pubkey) {
+    if (curve25519_pubkey.size() != 32)
+        throw std::invalid_argument{"xed25519::verifier requires a 32-byte curve25519 pubkey"};
+    A = pubkey(curve25519_pubkey);
+}
+
+verifier::verifier(std::string_view curve25519_pubkey) :
+        verifier{as_unsigned_sv(curve25519_pubkey)} {}
+
+bool verifier::verify(ustring_view signature, ustring_view msg) const {
+    return signature.size() == crypto_sign_ed25519_BYTES &&
+           0 == crypto_sign_ed25519_verify_detached(
+                        signature.data(), msg.data(), msg.size(), A.data());
+}
+
+bool verifier::verify(std::string_view signature, std::string_view msg) const {
+    return verify(as_unsigned_sv(signature), as_unsigned_sv(msg));
+}
+
+std::vector<bool> verifier::verify_batch(
+        const std::vector<std::pair<ustring_view, ustring_view>>& data_sigs) const {
+    std::vector<bool> result(data_sigs.size());
+    for (size_t i = 0; i < data_sigs.size(); i++)
+        result[i] = verify(data_sigs[i].second, data_sigs[i].first);
+    return result;
+}
 
+std::array<unsigned char, 32> pubkey(ustring_view curve25519_pubkey) {
+    assert(curve25519_pubkey.size() == 32);
+    bytes<32> k;
+    std::memcpy(k.data(), curve25519_pubkey.data(), k.size());
+
+    auto& cache = converted_pubkeys();
+    if (auto cached = cache.get(k))
+        return *cached;
+    auto ed_pubkey = montx_to_edy(k.data());
+    cache.put(k, ed_pubkey);
     return ed_pubkey;
 }
 
@@ -191,6 +413,96 @@ LIBSESSION_EXPORT int session_xed25519_verify(
     return session::xed25519::verify({signature, 64}, {pubkey, 32}, {msg, msg_len}) ? 0 : 1;
 }
 
+LIBSESSION_EXPORT int session_xed25519_verify_batch(
+        unsigned char* results,
+        const unsigned char* const* signatures,
+        const unsigned char* const* pubkeys,
+        const unsigned char* const* msgs,
+        const size_t* msg_lens,
+        size_t n) {
+    try {
+        std::vector<session::xed25519::verify_item> items;
+        items.reserve(n);
+        for (size_t i = 0; i < n; i++)
+            items.push_back({{signatures[i], 64}, {pubkeys[i], 32}, {msgs[i], msg_lens[i]}});
+        auto verified = session::xed25519::verify_batch(items);
+        bool all = true;
+        for (size_t i = 0; i < n; i++) {
+            if (results)
+                results[i] = verified[i];
+            all = all && verified[i];
+        }
+        return all ? 0 : 1;
+    } catch (...) {
+    }
+    return 1;
+}
+
+LIBSESSION_EXPORT session_xed25519_verifier* session_xed25519_verifier_new(
+        const unsigned char* curve25519_pubkey) {
+    try {
+        return reinterpret_cast<session_xed25519_verifier*>(
+                new session::xed25519::verifier{ustring_view{curve25519_pubkey, 32}});
+    } catch (...) {
+    }
+    return nullptr;
+}
+
+LIBSESSION_EXPORT void session_xed25519_verifier_free(session_xed25519_verifier* verifier) {
+    delete reinterpret_cast<session::xed25519::verifier*>(verifier);
+}
+
+LIBSESSION_EXPORT int session_xed25519_verifier_verify(
+        const session_xed25519_verifier* verifier,
+        const unsigned char* signature,
+        const unsigned char* msg,
+        const unsigned int msg_len) {
+    assert(verifier != NULL);
+    return reinterpret_cast<const session::xed25519::verifier*>(verifier)->verify(
+                   ustring_view{signature, 64}, ustring_view{msg, msg_len})
+                 ? 0
+                 : 1;
+}
+
+LIBSESSION_EXPORT session_xed25519_signer* session_xed25519_signer_new(
+        const unsigned char* curve25519_privkey) {
+    try {
+        return reinterpret_cast<session_xed25519_signer*>(
+                new session::xed25519::signer{ustring_view{curve25519_privkey, 32}});
+    } catch (...) {
+    }
+    return nullptr;
+}
+
+LIBSESSION_EXPORT void session_xed25519_signer_free(session_xed25519_signer* signer) {
+    delete reinterpret_cast<session::xed25519::signer*>(signer);
+}
+
+LIBSESSION_EXPORT int session_xed25519_signer_sign(
+        const session_xed25519_signer* signer,
+        unsigned char* signature,
+        const unsigned char* msg,
+        const unsigned int msg_len) {
+    assert(signer != NULL);
+    assert(signature != NULL);
+    try {
+        auto sig = reinterpret_cast<const session::xed25519::signer*>(signer)->sign(
+                ustring_view{msg, msg_len});
+        std::memcpy(signature, sig.data(), sig.size());
+        return 0;
+    } catch (...) {
+    }
+    return 1;
+}
+
+LIBSESSION_EXPORT void session_xed25519_signer_pubkey(
+        const session_xed25519_signer* signer, unsigned char* ed25519_pubkey) {
+    assert(signer != NULL);
+    assert(ed25519_pubkey != NULL);
+    auto& pk = reinterpret_cast<const session::xed25519::signer*>(signer)->ed25519_pubkey();
+    std::memcpy(ed25519_pubkey, pk.data(), pk.size());
+}
+
 LIBSESSION_EXPORT int session_xed25519_pubkey(
         unsigned char* ed25519_pubkey, const unsigned char* curve25519_pubkey) {
     assert(ed25519_pubkey != NULL);
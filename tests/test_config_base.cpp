@@ -0,0 +1,788 @@
+#include <oxenc/hex.h>
+#include <session/config/contacts.h>
+#include <session/config/metrics.h>
+#include <session/config/user_profile.h>
+#include <sodium/crypto_sign_ed25519.h>
+
+#include <array>
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <session/config/contacts.hpp>
+#include <session/config/encrypt.hpp>
+#include <session/config/user_profile.hpp>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+
+// Tests of the config-type independent behaviour implemented in ConfigBase, run through whichever
+// concrete config type is convenient.
+
+using namespace std::literals;
+using namespace oxenc::literals;
+
+namespace {
+
+// All the config objects here belong to the same account, so that they share an encryption key.
+const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+
+// Constructs a config object of the given type for the test account, optionally from a dump.
+template <typename Config>
+Config make_config(std::optional<ustring_view> dump = std::nullopt) {
+    return Config{ustring_view{seed}, dump};
+}
+
+// Returns the test account's Ed25519 secret key, for initializing C API config objects.
+std::array<unsigned char, 64> seed_ed_sk() {
+    std::array<unsigned char, 32> ed_pk;
+    std::array<unsigned char, 64> ed_sk;
+    crypto_sign_ed25519_seed_keypair(ed_pk.data(), ed_sk.data(), seed.data());
+    return ed_sk;
+}
+
+using msgs = std::vector<std::pair<std::string, ustring_view>>;
+
+struct async_c_results {
+    std::vector<std::pair<void (*)(void*), void*>> tasks;
+    int merged = 0;
+    std::vector<seqno_t> pushed;
+    std::vector<std::string> errors;
+};
+
+}  // namespace
+
+TEST_CASE("config async operations", "[config][base][async]") {
+
+    using async_profile = session::config::async_config<session::config::UserProfile>;
+    auto profile = make_config<async_profile>();
+    auto profile2 = make_config<async_profile>();
+
+    // Asynchronous operations need an async_config, which cancels them on destruction:
+    auto plain = make_config<session::config::UserProfile>();
+    CHECK_THROWS_AS(plain.push_async(), std::logic_error);
+
+    // Default, library-managed executor:
+    profile.publish();
+    profile.set_name("Kallie");
+    auto pushed = profile.push_async();
+    auto [seqno, data, obs] = pushed.get();
+    CHECK(seqno == 1);
+    CHECK(obs.empty());
+    CHECK(profile.snapshot()->get_name() == "Kallie"sv);
+
+    auto merged = profile2.merge_async({{"hash1", data}});
+    CHECK(merged.get() == 1);
+    CHECK(profile2.get_name() == "Kallie"sv);
+
+    // A caller-supplied executor that just collects the tasks for us to run:
+    std::vector<std::function<void()>> tasks;
+    profile.set_executor([&](std::function<void()> task) { tasks.push_back(std::move(task)); });
+
+    profile.set_name("Kallie 2");
+    auto push1 = profile.push_async();
+    auto push2 = profile.push_async();
+    // The second push supersedes the first, which hasn't started yet:
+    REQUIRE(push1.wait_for(0s) == std::future_status::ready);
+    CHECK_THROWS_AS(push1.get(), session::config::async_cancelled);
+    // Only one queue runner is submitted to the executor, which then runs everything queued:
+    REQUIRE(tasks.size() == 1);
+    CHECK(push2.wait_for(0s) == std::future_status::timeout);
+
+    // Operations run in order, one at a time:
+    std::vector<int> order;
+    profile.merge_async({{"hash1", data}}, [&](int n, std::exception_ptr e) {
+        CHECK(push2.wait_for(0s) == std::future_status::ready);
+        order.push_back(n);
+    });
+    CHECK(tasks.size() == 1);
+    tasks[0]();
+    CHECK(order == std::vector{{1}});
+    auto [seqno2, data2, obs2] = push2.get();
+    CHECK(seqno2 == 2);
+
+    // Callback version, back on the default executor:
+    profile.set_executor(nullptr);
+    profile.set_name("Kallie 3");
+    std::optional<seqno_t> seqno3;
+    profile.push_async([&](auto result, std::exception_ptr e) {
+        CHECK_FALSE(e);
+        seqno3 = std::get<0>(result);
+    });
+    profile.wait_async();
+    CHECK(seqno3 == 3);
+
+    // As with merge(), unparseable messages are just skipped:
+    CHECK(profile2.merge_async({{"hash2", "garbage"_bytes}}).get() == 0);
+
+    // Operations that haven't started when the object is destroyed are cancelled:
+    std::future<int> pending;
+    {
+        auto profile3 = make_config<async_profile>();
+        profile3.set_executor(
+                [&](std::function<void()> task) { tasks.push_back(std::move(task)); });
+        pending = profile3.merge_async({{"hash1", data2}});
+    }
+    REQUIRE(tasks.size() == 2);
+    CHECK_THROWS_AS(pending.get(), session::config::async_cancelled);
+    tasks[1]();  // Running the task late, after destruction, is harmless
+
+    // Destroying the object while an operation is running waits for the operation to finish
+    // (before any of the object is destroyed):
+    std::promise<void> started, release;
+    std::atomic<int> merged4{-1};
+    std::atomic<bool> destroyed{false};
+    std::thread runner, destroyer;
+    auto profile4 = std::make_unique<async_profile>(ustring_view{seed}, std::nullopt);
+    profile4->set_executor([&](std::function<void()> task) { runner = std::thread{task}; });
+    profile4->merge_async({{"hash1", data2}}, [&](int n, std::exception_ptr) {
+        started.set_value();
+        release.get_future().wait();
+        merged4 = n;
+    });
+    started.get_future().wait();
+    destroyer = std::thread{[&] {
+        profile4.reset();
+        destroyed = true;
+    }};
+    std::this_thread::sleep_for(50ms);
+    CHECK_FALSE(destroyed);
+    release.set_value();
+    destroyer.join();
+    runner.join();
+    CHECK(destroyed);
+    CHECK(merged4 == 1);
+
+    // A completion callback may destroy the object itself; anything still queued is cancelled:
+    auto profile5 = std::make_unique<async_profile>(ustring_view{seed}, std::nullopt);
+    tasks.clear();
+    profile5->set_executor([&](std::function<void()> task) { tasks.push_back(std::move(task)); });
+    profile5->merge_async({{"hash1", data2}}, [&](int n, std::exception_ptr) {
+        CHECK(n == 1);
+        profile5.reset();
+    });
+    auto pending5 = profile5->merge_async({{"hash1", data2}});
+    REQUIRE(tasks.size() == 1);
+    tasks[0]();
+    CHECK_FALSE(profile5);
+    REQUIRE(pending5.wait_for(0s) == std::future_status::ready);
+    CHECK_THROWS_AS(pending5.get(), session::config::async_cancelled);
+}
+
+TEST_CASE("config async operations C API", "[config][base][async][c]") {
+
+    auto ed_sk = seed_ed_sk();
+
+    config_object *conf, *conf2;
+    REQUIRE(user_profile_init(&conf, ed_sk.data(), NULL, 0, NULL) == 0);
+    REQUIRE(user_profile_init(&conf2, ed_sk.data(), NULL, 0, NULL) == 0);
+
+    async_c_results r;
+    config_set_executor(
+            conf,
+            [](void (*run)(void*), void* task, void* ctx) {
+                static_cast<async_c_results*>(ctx)->tasks.emplace_back(run, task);
+            },
+            &r);
+    auto on_push = [](config_object*, config_push_data* push, const char* error, void* ctx) {
+        auto& r = *static_cast<async_c_results*>(ctx);
+        if (error) {
+            CHECK_FALSE(push);
+            r.errors.push_back(error);
+            return;
+        }
+        r.pushed.push_back(push->seqno);
+        free(push);
+    };
+
+    REQUIRE(user_profile_set_name(conf, "Kallie") == 0);
+    config_push_async(conf, on_push, &r);
+    config_push_async(conf, on_push, &r);
+    REQUIRE(r.errors.size() == 1);
+    CHECK(r.errors[0] == "push cancelled: superseded by a newer push");
+    REQUIRE(r.tasks.size() == 1);
+    CHECK(r.pushed.empty());
+    r.tasks[0].first(r.tasks[0].second);
+    CHECK(r.pushed == std::vector<seqno_t>{{1}});
+
+    // conf2 uses the default executor:
+    auto* to_push = config_push(conf);
+    const char* hashes[] = {"hash1"};
+    const unsigned char* configs[] = {to_push->config};
+    size_t lengths[] = {to_push->config_len};
+    config_merge_async(
+            conf2,
+            hashes,
+            configs,
+            lengths,
+            1,
+            [](config_object* conf, int merged, const char* error, void* ctx) {
+                CHECK_FALSE(error);
+                static_cast<async_c_results*>(ctx)->merged = merged;
+            },
+            &r);
+    free(to_push);
+    config_wait_async(conf2);
+    CHECK(r.merged == 1);
+    CHECK(user_profile_get_name(conf2) == "Kallie"sv);
+
+    config_free(conf);
+    config_free(conf2);
+}
+
+TEST_CASE("config metrics", "[config][base][metrics]") {
+
+    using session::config::metric_phase;
+    auto contacts = make_config<session::config::Contacts>();
+    auto contacts2 = make_config<session::config::Contacts>();
+
+    auto m = contacts.metrics();
+    for (auto& h : m.phases)
+        CHECK(h.count == 0);
+    CHECK(m.compression_ratio() == 1.0);
+    CHECK(m[metric_phase::push].percentile_us(0.5) == 0);
+
+    for (int i = 0; i < 100; i++) {
+        auto id = "05" + oxenc::to_hex(std::to_string(1'000'000 + i)) + std::string(50, '0');
+        contacts.set_name(id, "Contact " + std::to_string(i));
+    }
+    auto [seqno, to_push, obs] = contacts.push();
+    m = contacts.metrics();
+    CHECK(m[metric_phase::push].count == 1);
+    CHECK(m[metric_phase::diff].count == 1);
+    CHECK(m[metric_phase::serialize].count == 1);
+    CHECK(m[metric_phase::compress].count == 1);
+    CHECK(m[metric_phase::encrypt].count == 1);
+    CHECK(m[metric_phase::merge].count == 0);
+    CHECK(m.push_bytes == to_push.size());
+    // All the repetition makes this nicely compressible:
+    CHECK(m.compress_out_bytes < m.compress_in_bytes);
+    CHECK(m.compression_ratio() < 0.5);
+    auto& push_hist = m[metric_phase::push];
+    CHECK(push_hist.total_ns >= push_hist.max_ns);
+    CHECK(push_hist.max_ns > 0);
+    uint64_t in_buckets = 0;
+    for (auto b : push_hist.buckets)
+        in_buckets += b;
+    CHECK(in_buckets == 1);
+    CHECK(push_hist.percentile_us(1.0) >= push_hist.max_ns / 1000.0);
+
+    CHECK(contacts2.merge(msgs{{"hash1", to_push}, {"hash2", "garbage"_bytes}}) == 1);
+    m = contacts2.metrics();
+    CHECK(m[metric_phase::merge].count == 1);
+    CHECK(m.merge_messages == 2);
+    CHECK(m.merge_bytes == to_push.size() + 7);
+    CHECK(m.decrypt_attempts == 2);
+    CHECK(m.decrypt_failures == 1);
+    CHECK(m[metric_phase::decrypt].count == 1);  // Timed once for the whole batch
+    CHECK(m[metric_phase::decompress].count == 1);
+    CHECK(m.decompress_out_bytes > m.decompress_in_bytes);
+    CHECK(m[metric_phase::parse].count == 1);
+    CHECK(m.parse_failures == 0);
+    CHECK(m[metric_phase::push].count == 0);
+
+    auto dump = contacts2.dump();
+    m = contacts2.metrics();
+    CHECK(m[metric_phase::dump].count == 1);
+    CHECK(m.dump_bytes == dump.size());
+
+    contacts2.reset_metrics();
+    m = contacts2.metrics();
+    CHECK(m.merge_messages == 0);
+    CHECK(m[metric_phase::merge].count == 0);
+    CHECK(m[metric_phase::merge].buckets[0] + m[metric_phase::merge].buckets[10] == 0);
+
+    // C API:
+    auto ed_sk = seed_ed_sk();
+    config_object* conf;
+    REQUIRE(contacts_init(&conf, ed_sk.data(), NULL, 0, NULL) == 0);
+    const char* hashes[] = {"hash1"};
+    const unsigned char* configs[] = {to_push.data()};
+    size_t lengths[] = {to_push.size()};
+    CHECK(config_merge(conf, hashes, configs, lengths, 1) == 1);
+    config_metrics cm;
+    config_get_metrics(conf, &cm);
+    CHECK(cm.merge_messages == 1);
+    CHECK(cm.merge_bytes == to_push.size());
+    CHECK(cm.phases[CONFIG_PHASE_MERGE].count == 1);
+    CHECK(cm.phases[CONFIG_PHASE_PUSH].count == 0);
+    config_reset_metrics(conf);
+    config_get_metrics(conf, &cm);
+    CHECK(cm.merge_messages == 0);
+    CHECK(cm.phases[CONFIG_PHASE_MERGE].count == 0);
+    config_free(conf);
+}
+
+TEST_CASE("config log level", "[config][base][logging]") {
+
+    auto profile = make_config<session::config::UserProfile>();
+    auto profile2 = make_config<session::config::UserProfile>();
+    profile.set_name("Kallie");
+    auto [seqno, data, obs] = profile.push();
+
+    std::vector<std::pair<session::config::LogLevel, std::string>> logs;
+    profile2.logger = [&](session::config::LogLevel lvl, std::string msg) {
+        logs.emplace_back(lvl, std::move(msg));
+    };
+    auto messages = msgs{{"hash1", data}, {"hash2", "garbage"_bytes}};
+
+    CHECK(profile2.merge(messages) == 1);
+    REQUIRE(logs.size() == 3);
+    CHECK(logs[0] == std::pair{session::config::LogLevel::debug,
+                               "Failed to decrypt message 1 using key 0"s});
+    CHECK(logs[1] == std::pair{session::config::LogLevel::warning,
+                               "Failed to decrypt message 1"s});
+    CHECK(logs[2].first == session::config::LogLevel::debug);
+
+    logs.clear();
+    profile2.log_level = session::config::LogLevel::warning;
+    CHECK(profile2.merge(messages) == 0);  // hash1 was already processed
+    REQUIRE(logs.size() == 1);
+    CHECK(logs[0].first == session::config::LogLevel::warning);
+
+    // C API:
+    auto ed_sk = seed_ed_sk();
+    config_object* conf;
+    REQUIRE(user_profile_init(&conf, ed_sk.data(), NULL, 0, NULL) == 0);
+    int count = 0;
+    config_set_logger(
+            conf,
+            [](config_log_level, const char*, void* ctx) { ++*static_cast<int*>(ctx); },
+            &count);
+    const char* hashes[] = {"hash2"};
+    const unsigned char* configs[] = {messages[1].second.data()};
+    size_t lengths[] = {messages[1].second.size()};
+    config_merge(conf, hashes, configs, lengths, 1);
+    CHECK(count == 3);
+    config_set_log_level(conf, LOG_LEVEL_ERROR);
+    config_merge(conf, hashes, configs, lengths, 1);
+    CHECK(count == 3);
+    config_free(conf);
+}
+
+TEST_CASE("config processed message cache", "[config][base][merge-cache]") {
+
+    using session::config::metric_phase;
+    auto contacts = make_config<session::config::Contacts>();
+    auto contacts2 = make_config<session::config::Contacts>();
+
+    const auto sid = "050000000000000000000000000000000000000000000000000000000000000000"s;
+    contacts.set_name(sid, "Joe");
+    auto [seqno, to_push, obs] = contacts.push();
+
+    CHECK_FALSE(contacts2.processed_seqno("hash1"));
+    CHECK(contacts2.merge(msgs{{"hash1", to_push}, {"bad", "garbage"_bytes}}) == 1);
+    CHECK(contacts2.processed_seqno("hash1") == 1);
+    CHECK_FALSE(contacts2.processed_seqno("bad"));
+    auto m = contacts2.metrics();
+    CHECK(m.merge_cache_hits == 0);
+    CHECK(m.decrypt_attempts == 2);
+
+    // Polling again returns the same message, which now gets skipped without being decrypted:
+    contacts2.reset_metrics();
+    CHECK(contacts2.merge(msgs{{"hash1", to_push}, {"bad", "garbage"_bytes}}) == 0);
+    m = contacts2.metrics();
+    CHECK(m.merge_cache_hits == 1);
+    CHECK(m.decrypt_attempts == 1);
+    CHECK(m[metric_phase::decrypt].count == 1);
+    CHECK(contacts2.get(sid)->name == "Joe");
+    CHECK_FALSE(contacts2.needs_push());
+    // ... and since it is still the current message it must not be obsoleted:
+    CHECK(std::get<2>(contacts2.push()).empty());
+
+    // A newer message gets merged as usual, and the skipped message is obsoleted as it would be if
+    // it had been merged:
+    contacts.set_name(sid, "Joseph");
+    auto [seqno2, to_push2, obs2] = contacts.push();
+    CHECK(contacts2.merge(msgs{{"hash1", to_push}, {"hash2", to_push2}}) == 1);
+    CHECK(contacts2.get(sid)->name == "Joseph");
+    CHECK(contacts2.processed_seqno("hash2") == 2);
+    contacts2.set_name(sid, "Joey");
+    auto [seqno3, to_push3, obs3] = contacts2.push();
+    std::sort(obs3.begin(), obs3.end());
+    CHECK(obs3 == std::vector<std::string>{"hash1", "hash2"});
+
+    // The cache is persisted in the dump:
+    CHECK(contacts2.needs_dump());
+    auto dump = contacts2.dump();
+    auto contacts3 = make_config<session::config::Contacts>(dump);
+    CHECK_FALSE(contacts3.needs_dump());
+    CHECK(contacts3.processed_seqno("hash1") == 1);
+    CHECK(contacts3.processed_seqno("hash2") == 2);
+    CHECK(contacts3.merge(msgs{{"hash1", to_push}, {"hash2", to_push2}}) == 0);
+    CHECK(contacts3.metrics().merge_cache_hits == 2);
+    CHECK(contacts3.metrics().decrypt_attempts == 0);
+
+    // The cache is bounded, evicting the oldest entries:
+    msgs many;
+    std::vector<std::string> hashes;
+    for (int i = 0; i < 300; i++)
+        hashes.push_back("many" + std::to_string(i));
+    for (auto& h : hashes)
+        many.emplace_back(h, to_push2);
+    contacts3.merge(many);
+    CHECK_FALSE(contacts3.processed_seqno("hash1"));
+    CHECK_FALSE(contacts3.processed_seqno("many43"));
+    CHECK(contacts3.processed_seqno("many44") == 2);
+    CHECK(contacts3.processed_seqno("many299") == 2);
+
+    // Changing the signing keys or removing an encryption key clears the cache so that messages
+    // get checked again; adding an extra decryption key does not:
+    contacts3.clear_sig_keys();
+    CHECK_FALSE(contacts3.processed_seqno("many299"));
+    contacts3.reset_metrics();
+    CHECK(contacts3.merge(msgs{{"hash2", to_push2}}) == 1);
+    CHECK(contacts3.metrics().decrypt_attempts == 1);
+    CHECK(contacts3.processed_seqno("hash2") == 2);
+
+    const auto extra_key =
+            "0000000000000000000000000000000000000000000000000000000000000001"_hexbytes;
+    contacts3.add_key(extra_key, false);
+    CHECK(contacts3.processed_seqno("hash2") == 2);
+    contacts3.add_key(extra_key);
+    CHECK(contacts3.processed_seqno("hash2") == 2);
+    CHECK(contacts3.remove_key(extra_key));
+    CHECK_FALSE(contacts3.processed_seqno("hash2"));
+}
+
+TEST_CASE("config encryption key changes", "[config][base][keys]") {
+
+    const auto key2 = "abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789"_hexbytes;
+    auto contacts = make_config<session::config::Contacts>();
+    auto key1 = ustring{contacts.key()};
+
+    const auto sid = "050000000000000000000000000000000000000000000000000000000000000000"s;
+    contacts.set_name(sid, "Joe");
+    auto [seqno, data, obs] = contacts.push();
+    CHECK(session::config::decrypt(data, key1, "Contacts").size() > 0);
+
+    // A new primary key must be used for the next push, even for the same size message (i.e. the
+    // same derived key cache slot):
+    contacts.add_key(key2);
+    contacts.set_name(sid, "Jim");
+    auto [seqno2, data2, obs2] = contacts.push();
+    CHECK(data2.size() == data.size());
+    CHECK_THROWS_AS(
+            session::config::decrypt(data2, key1, "Contacts"), session::config::decrypt_error);
+    CHECK(session::config::decrypt(data2, key2, "Contacts").size() > 0);
+
+    // Merging still tries both keys:
+    auto contacts2 = make_config<session::config::Contacts>();
+    contacts2.add_key(key2, false);
+    CHECK(contacts2.merge(msgs{{"hash1", data}, {"hash2", data2}}) == 2);
+    CHECK(contacts2.get(sid)->name == "Jim");
+
+    CHECK(contacts.remove_key(key2));
+    contacts.set_name(sid, "Joe");
+    auto [seqno3, data3, obs3] = contacts.push();
+    CHECK(session::config::decrypt(data3, key1, "Contacts").size() > 0);
+
+    CHECK(contacts.clear_keys() == 1);
+    CHECK(contacts.key_count() == 0);
+    CHECK_THROWS_AS(contacts.push(), std::logic_error);
+}
+
+TEST_CASE("config signed messages", "[config][base][signed]") {
+
+    std::array<unsigned char, 32> sig_pk, other_pk;
+    std::array<unsigned char, 64> sig_sk, other_sk;
+    crypto_sign_ed25519_keypair(sig_pk.data(), sig_sk.data());
+    crypto_sign_ed25519_keypair(other_pk.data(), other_sk.data());
+
+    auto admin = make_config<session::config::UserProfile>();
+    auto admin2 = make_config<session::config::UserProfile>();
+    auto reader = make_config<session::config::UserProfile>();
+    auto unsigned_profile = make_config<session::config::UserProfile>();
+    auto imposter = make_config<session::config::UserProfile>();
+    admin.set_sig_keys({sig_sk.data(), sig_sk.size()});
+    admin2.set_sig_keys({sig_sk.data(), sig_sk.size()});
+    reader.set_sig_pubkey({sig_pk.data(), sig_pk.size()});
+    imposter.set_sig_keys({other_sk.data(), other_sk.size()});
+
+    CHECK(admin.get_sig_pubkey() == sig_pk);
+    CHECK(reader.get_sig_pubkey() == sig_pk);
+    CHECK_FALSE(unsigned_profile.get_sig_pubkey());
+    CHECK_FALSE(admin.is_readonly());
+    CHECK(reader.is_readonly());
+    CHECK_FALSE(unsigned_profile.is_readonly());
+    CHECK_THROWS_AS(admin.set_sig_keys({sig_sk.data(), 32}), std::invalid_argument);
+
+    admin.set_name("Kallie");
+    auto [seqno, data, obs] = admin.push();
+    CHECK(seqno == 1);
+
+    CHECK(reader.merge(msgs{{"hash1", data}}) == 1);
+    CHECK(reader.get_name() == "Kallie"sv);
+    CHECK_FALSE(reader.needs_push());
+    CHECK_THROWS_AS(reader.push(), std::logic_error);
+
+    // Unsigned messages, and messages signed by the wrong key, are rejected:
+    unsigned_profile.set_name("Nope");
+    auto [useqno, udata, uobs] = unsigned_profile.push();
+    imposter.set_name("Imposter");
+    auto [iseqno, idata, iobs] = imposter.push();
+    CHECK(reader.merge(msgs{{"hash2", udata}, {"hash3", idata}}) == 0);
+    CHECK(admin.merge(msgs{{"hash2", udata}, {"hash3", idata}}) == 0);
+    CHECK(reader.get_name() == "Kallie"sv);
+    CHECK(admin.get_name() == "Kallie"sv);
+
+    // Signed messages are accepted by a config without signing keys (which doesn't verify):
+    CHECK(unsigned_profile.merge(msgs{{"hash1", data}}) == 1);
+
+    // Conflicting changes from two admins get merged by the reader, but the reader can't push the
+    // merged result:
+    CHECK(admin2.merge(msgs{{"hash1", data}}) == 1);
+    admin.set_name("Kallie 2");
+    admin2.set_nts_priority(3);
+    auto [seqno2, data2, obs2] = admin.push();
+    auto [seqno2b, data2b, obs2b] = admin2.push();
+    CHECK(seqno2 == 2);
+    CHECK(seqno2b == 2);
+    CHECK(reader.merge(msgs{{"hash4", data2}, {"hash5", data2b}}) == 2);
+    CHECK(reader.get_name() == "Kallie 2"sv);
+    CHECK(reader.get_nts_priority() == 3);
+    CHECK(reader.is_dirty());
+    CHECK_FALSE(reader.needs_push());
+
+    // The admins resolve the conflict.  (The reader's own merge result is unsigned, and so never
+    // identical to the admin's, so the reader merges again rather than simply adopting it).
+    CHECK(admin.merge(msgs{{"hash5", data2b}}) == 1);
+    auto [seqno3, data3, obs3] = admin.push();
+    CHECK(seqno3 == 3);
+    admin.confirm_pushed(seqno3, "hash6");
+    admin.set_name("Kallie 3");
+    auto [seqno4, data4, obs4] = admin.push();
+    CHECK(reader.merge(msgs{{"hash6", data3}, {"hash7", data4}}) == 2);
+    CHECK(reader.get_name() == "Kallie 3"sv);
+    CHECK(reader.get_nts_priority() == 3);
+    CHECK_FALSE(reader.needs_push());
+
+    // Clearing the keys turns signing and verification off:
+    unsigned_profile.set_sig_keys({other_sk.data(), other_sk.size()});
+    unsigned_profile.clear_sig_keys();
+    CHECK_FALSE(unsigned_profile.get_sig_pubkey());
+    CHECK(unsigned_profile.merge(msgs{{"hash3", idata}}) == 1);
+}
+
+TEST_CASE("config XEd25519-signed messages", "[config][base][signed][xed25519]") {
+
+    std::array<unsigned char, 32> ed_pk, x_pk, x_sk;
+    std::array<unsigned char, 64> ed_sk;
+    crypto_sign_ed25519_keypair(ed_pk.data(), ed_sk.data());
+    REQUIRE(0 == crypto_sign_ed25519_pk_to_curve25519(x_pk.data(), ed_pk.data()));
+    REQUIRE(0 == crypto_sign_ed25519_sk_to_curve25519(x_sk.data(), ed_sk.data()));
+
+    auto admin = make_config<session::config::UserProfile>();
+    auto member = make_config<session::config::UserProfile>();
+    admin.set_xed25519_sig_keys({x_sk.data(), x_sk.size()});
+    member.set_xed25519_sig_pubkey({x_pk.data(), x_pk.size()});
+    REQUIRE(admin.get_sig_pubkey());
+    CHECK(admin.get_sig_pubkey() == member.get_sig_pubkey());
+    CHECK(member.is_readonly());
+
+    admin.set_name("Kallie");
+    auto [seqno, data, obs] = admin.push();
+
+    // XEd25519 signatures are randomized, but pushing the unchanged config again reuses the
+    // existing signature, so the message content is identical:
+    auto [seqno_again, data_again, obs_again] = admin.push();
+    CHECK(seqno_again == seqno);
+    auto domain = admin.encryption_domain();
+    CHECK(printable(session::config::decrypt(data, admin.key(), domain)) ==
+          printable(session::config::decrypt(data_again, admin.key(), domain)));
+
+    CHECK(member.merge(msgs{{"hash1", data}}) == 1);
+    CHECK(member.get_name() == "Kallie"sv);
+    CHECK_FALSE(member.is_dirty());
+
+    // The member's config keeps the admin's signature, so that seeing the same message again (here,
+    // under a different hash), or a later message that includes it, is not mistaken for a
+    // conflict, including after being reloaded from a dump:
+    CHECK(member.merge(msgs{{"hash2", data}}) == 1);
+    CHECK_FALSE(member.is_dirty());
+    auto member2 = make_config<session::config::UserProfile>(member.dump());
+    member2.set_xed25519_sig_pubkey({x_pk.data(), x_pk.size()});
+    admin.confirm_pushed(seqno, "hash1");
+    admin.set_nts_priority(7);
+    auto [seqno2, data2, obs2] = admin.push();
+    CHECK(member2.merge(msgs{{"hash3", data2}}) == 1);
+    CHECK(member2.get_nts_priority() == 7);
+    CHECK_FALSE(member2.is_dirty());
+}
+
+TEST_CASE("config signed messages C API", "[config][base][signed][c]") {
+    auto ed_sk = seed_ed_sk();
+    std::array<unsigned char, 32> sig_pk, out_pk;
+    std::array<unsigned char, 64> sig_sk;
+    crypto_sign_ed25519_keypair(sig_pk.data(), sig_sk.data());
+
+    config_object* conf;
+    REQUIRE(user_profile_init(&conf, ed_sk.data(), NULL, 0, NULL) == 0);
+    CHECK_FALSE(config_get_sig_pubkey(conf, out_pk.data()));
+    config_set_sig_keys(conf, sig_sk.data());
+    REQUIRE(config_get_sig_pubkey(conf, out_pk.data()));
+    CHECK(out_pk == sig_pk);
+    CHECK_FALSE(config_is_readonly(conf));
+
+    config_set_sig_pubkey(conf, sig_pk.data());
+    CHECK(config_is_readonly(conf));
+    REQUIRE(user_profile_set_name(conf, "Kallie") == 0);
+    CHECK_FALSE(config_needs_push(conf));
+
+    config_clear_sig_keys(conf);
+    CHECK_FALSE(config_get_sig_pubkey(conf, out_pk.data()));
+    CHECK_FALSE(config_is_readonly(conf));
+    CHECK(config_needs_push(conf));
+    config_free(conf);
+}
+
+TEST_CASE("config adaptive lags", "[config][base][lags]") {
+
+    auto contacts = make_config<session::config::Contacts>();
+    auto fixed = make_config<session::config::Contacts>();
+    auto other = make_config<session::config::Contacts>();
+
+    auto sid = [](int i) {
+        return "05" + oxenc::to_hex(std::to_string(1'000'000 + i)) + std::string(50, '0');
+    };
+    auto push_both = [&](int i) {
+        auto [seqno, to_push, obs] = contacts.push();
+        contacts.confirm_pushed(seqno, "hash" + std::to_string(i));
+        auto [fseqno, fto_push, fobs] = fixed.push();
+        fixed.confirm_pushed(fseqno, "fhash" + std::to_string(i));
+        CHECK(seqno == fseqno);
+        return to_push;
+    };
+
+    // Start with a contact whose creation is already out of the lag window:
+    for (int i = 0; i < 5; i++) {
+        for (auto* c : {&contacts, &fixed})
+            c->set_name(sid(0), "Contact " + std::to_string(i));
+        push_both(-1 - i);
+    }
+
+    CHECK_FALSE(contacts.adaptive_lags());
+    CHECK(contacts.carried_lags() == 5);
+    contacts.set_adaptive_lags(true);
+    CHECK(contacts.adaptive_lags());
+    CHECK(contacts.carried_lags() == 5);
+
+    // Make the same changes to both `contacts` and `fixed`: the former lowers the lags it carries
+    // by one every 3 pushes, down to the minimum of 2, while the latter always carries 5.  Each
+    // change renames the same contact, so the diffs left out are always redone by a newer one.
+    ustring last_push;
+    for (int i = 0; i < 12; i++) {
+        CHECK(contacts.carried_lags() == std::max(2, 5 - i / 3));
+        for (auto* c : {&contacts, &fixed})
+            c->set_name(sid(0), "Name " + std::to_string(i));
+        last_push = push_both(i);
+    }
+    CHECK(contacts.carried_lags() == 2);
+    CHECK(fixed.carried_lags() == 5);
+
+    // The saved bytes are exactly the difference in the (uncompressed) pushed messages, as the
+    // messages are otherwise identical in size:
+    auto m = contacts.metrics();
+    auto fm = fixed.metrics();
+    CHECK(m.lag_bytes_saved > 0);
+    CHECK(fm.lag_bytes_saved == 0);
+    CHECK(fm.compress_in_bytes - m.compress_in_bytes == m.lag_bytes_saved);
+    CHECK(m.merge_conflicts == 0);
+
+    // Re-pushing a message we already pushed reproduces it exactly:
+    contacts.set_name(sid(0), "Joe");
+    auto [seqno, to_push, obs] = contacts.push();
+    CHECK(contacts.push() == std::make_tuple(seqno, to_push, std::vector<std::string>{}));
+    contacts.confirm_pushed(seqno, "hash100");
+
+    // Another client sees our two most recent messages (the older one not yet deleted) and doesn't
+    // need to merge them, as even the reduced lags still include the preceding message:
+    CHECK(other.merge(msgs{{"hash11", last_push}, {"hash100", to_push}}) == 2);
+    CHECK_FALSE(other.needs_push());
+    CHECK(other.get(sid(0))->name == "Joe");
+    CHECK(other.metrics().merge_conflicts == 0);
+
+    // Seeing that other client's update restores the full lags:
+    other.set_name(sid(101), "Jane");
+    auto [oseqno, oto_push, oobs] = other.push();
+    other.confirm_pushed(oseqno, "ohash1");
+    CHECK(contacts.merge(msgs{{"ohash1", oto_push}}) == 1);
+    CHECK(contacts.carried_lags() == 5);
+    CHECK_FALSE(contacts.needs_push());
+
+    // As does a conflict, and the conflict resolution message carries the full lags:
+    for (int i = 0; i < 3; i++) {
+        contacts.set_name(sid(200 + i), "Bob");
+        auto [s, p, o] = contacts.push();
+        contacts.confirm_pushed(s, "hash" + std::to_string(200 + i));
+        if (i == 0)
+            CHECK(other.merge(msgs{{"hash200", p}}) == 1);
+    }
+    CHECK(contacts.carried_lags() == 4);
+    other.set_name(sid(300), "Conflict");
+    std::tie(oseqno, oto_push, oobs) = other.push();
+    auto saved_before = contacts.metrics().lag_bytes_saved;
+    CHECK(contacts.merge(msgs{{"ohash2", oto_push}}) == 1);
+    CHECK(contacts.metrics().merge_conflicts == 1);
+    CHECK(contacts.carried_lags() == 5);
+    CHECK(contacts.needs_push());
+    std::tie(seqno, to_push, obs) = contacts.push();
+    CHECK(contacts.metrics().lag_bytes_saved == saved_before);
+    CHECK(other.merge(msgs{{"merged", to_push}}) == 1);
+    CHECK(other.get(sid(300))->name == "Conflict");
+    CHECK(other.get(sid(202))->name == "Bob");
+
+    // A change that no newer diff redoes can't be left out, as it could lose a conflict with an
+    // unseen update from another client: pushing it carries the full lags again.
+    // (The new contacts and the merge above are still in the window, so it takes a few pushes
+    // before the lags are lowered again).
+    for (int i = 0; i < 20 && contacts.carried_lags() > 3; i++) {
+        contacts.set_name(sid(0), "Joe " + std::to_string(i));
+        auto [s, p, o] = contacts.push();
+        contacts.confirm_pushed(s, "hash" + std::to_string(400 + i));
+    }
+    REQUIRE(contacts.carried_lags() == 3);
+    contacts.set_name(sid(400), "Sue");
+    for (int i = 0; i < 3; i++) {
+        auto [s, p, o] = contacts.push();
+        contacts.confirm_pushed(s, "hash" + std::to_string(420 + i));
+        contacts.set_name(sid(0), "Joe " + std::to_string(100 + i));
+    }
+    // That push would leave out the diff adding Sue, which nothing newer redoes:
+    saved_before = contacts.metrics().lag_bytes_saved;
+    std::tie(seqno, to_push, obs) = contacts.push();
+    CHECK(contacts.metrics().lag_bytes_saved == saved_before);
+    CHECK(contacts.carried_lags() == 5);
+
+    // Disabling always returns to the full lags:
+    contacts.set_adaptive_lags(false);
+    CHECK(contacts.carried_lags() == 5);
+
+    // C API:
+    auto ed_sk = seed_ed_sk();
+    config_object* conf;
+    REQUIRE(contacts_init(&conf, ed_sk.data(), NULL, 0, NULL) == 0);
+    CHECK(config_carried_lags(conf) == 5);
+    config_set_adaptive_lags(conf, true);
+    contacts_contact c;
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(contacts_get_or_construct(conf, &c, sid(i).c_str()));
+        strcpy(c.name, "Test");
+        contacts_set(conf, &c);
+        auto* to_push = config_push(conf);
+        config_confirm_pushed(conf, to_push->seqno, "hash");
+        free(to_push);
+    }
+    CHECK(config_carried_lags(conf) == 4);
+    config_metrics cm;
+    config_get_metrics(conf, &cm);
+    CHECK(cm.merge_conflicts == 0);
+    CHECK(cm.lag_bytes_saved == 0);  // Nothing has been left out yet
+    config_free(conf);
+}
@@ -3,9 +3,11 @@
 #include <session/config/contacts.h>
 #include <sodium/crypto_sign_ed25519.h>
 
+#include <atomic>
 #include <catch2/catch_test_macros.hpp>
 #include <session/config/contacts.hpp>
 #include <string_view>
+#include <thread>
 
 #include "utils.hpp"
 
@@ -419,3 +421,83 @@ TEST_CASE("huge contacts compression", "[config][compression][contacts]") {
     // With tons of duplicate info the push should have been nicely compressible:
     CHECK(dump.size() > 1'320'000);
 }
+
+TEST_CASE("Contacts snapshots", "[config][contacts][snapshot]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    session::config::Contacts contacts{ustring_view{seed}, std::nullopt};
+    session::config::Contacts contacts2{ustring_view{seed}, std::nullopt};
+
+    // Nothing is published until the first explicit publish():
+    CHECK_FALSE(contacts.snapshot());
+    contacts.publish();
+    auto snap0 = contacts.snapshot();
+    REQUIRE(snap0);
+    CHECK(snap0->size() == 0);
+    CHECK(contacts.snapshot() == snap0);
+
+    const auto sid = "050000000000000000000000000000000000000000000000000000000000000000"s;
+    contacts.set_name(sid, "Joe");
+    // Local changes aren't visible until published:
+    CHECK(contacts.snapshot() == snap0);
+    contacts.publish();
+    auto snap1 = contacts.snapshot();
+    REQUIRE(snap1 != snap0);
+    CHECK(snap0->size() == 0);
+    REQUIRE(snap1->get(sid));
+    CHECK(snap1->get(sid)->name == "Joe");
+    contacts.publish();  // No-op, as nothing changed
+    CHECK(contacts.snapshot() == snap1);
+
+    // Once publishing has started, push and merge publish automatically:
+    contacts.set_name(sid, "Joey");
+    auto [seqno, to_push, obs] = contacts.push();
+    CHECK(contacts.snapshot()->get(sid)->name == "Joey");
+    std::vector<std::pair<std::string, ustring_view>> msgs{{"hash1", to_push}};
+    session::config::Contacts contacts3{ustring_view{seed}, std::nullopt};
+    CHECK(contacts3.merge(msgs) == 1);
+    CHECK_FALSE(contacts3.snapshot());  // Never published, so merge doesn't either
+    contacts2.publish();
+    CHECK(contacts2.merge(msgs) == 1);
+    auto snap2 = contacts2.snapshot();
+    REQUIRE(snap2->get(sid));
+    CHECK(snap2->get(sid)->name == "Joey");
+
+    // Snapshots stay valid and unchanged across further writes and the writer's destruction:
+    contacts2.set_name(sid, "Joseph");
+    contacts2.publish();
+    CHECK(snap2->get(sid)->name == "Joey");
+    CHECK(contacts2.snapshot()->get(sid)->name == "Joseph");
+
+    // Readers on other threads can fetch and use snapshots while the writer keeps modifying and
+    // publishing.  (Catch2 assertions aren't thread-safe, so the readers just count failures).
+    std::atomic<bool> done = false;
+    std::atomic<int> reads = 0, failures = 0;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; t++)
+        readers.emplace_back([&] {
+            do {
+                auto snap = contacts2.snapshot();
+                size_t n = 0;
+                for (const auto& c : *snap) {
+                    if (c.session_id.size() != 66 || c.name.empty())
+                        failures++;
+                    n++;
+                }
+                if (n != snap->size())
+                    failures++;
+                reads++;
+            } while (!done);
+        });
+    for (int i = 0; i < 200; i++) {
+        auto id = "05" + oxenc::to_hex(std::to_string(1'000'000 + i)) + std::string(50, '0');
+        contacts2.set_name(id, "Contact " + std::to_string(i));
+        contacts2.publish();
+    }
+    done = true;
+    for (auto& r : readers)
+        r.join();
+    CHECK(reads >= 3);
+    CHECK(failures == 0);
+    CHECK(contacts2.snapshot()->size() == 201);
+}
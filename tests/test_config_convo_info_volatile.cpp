@@ -2,6 +2,7 @@
 #include <session/config/convo_info_volatile.h>
 #include <sodium/crypto_sign_ed25519.h>
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <chrono>
 #include <session/config/convo_info_volatile.hpp>
@@ -198,6 +199,24 @@ TEST_CASE("Conversations", "[config][conversations]") {
     CHECK(seen == std::vector<std::string>{{
                           "05cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc",
                   }});
+
+    // Lookups and removal via a pre-canonicalized community key:
+    const session::config::community_key sudoku{"HTTP://example.org:5678/", "SUDOKUROOM"};
+    auto x3 = convos.get_community(sudoku);
+    REQUIRE(x3);
+    CHECK(x3->base_url() == "http://example.org:5678");
+    CHECK(x3->room() == "sudokuroom");
+    CHECK(x3->pubkey_hex() == to_hex(open_group_pubkey));
+    CHECK(x3->unread);
+    auto x4 = convos.get_or_construct_community(
+            session::config::community_key{"http://example.org:5678", "Other"}, open_group_pubkey);
+    CHECK(x4.room() == "other");
+    CHECK_FALSE(x4.unread);
+    CHECK_FALSE(convos.erase_community(
+            session::config::community_key{"http://example.org:5678", "other"}));
+    CHECK(convos.erase_community(sudoku));
+    CHECK_FALSE(convos.get_community(sudoku));
+    CHECK(convos.size_communities() == 0);
 }
 
 TEST_CASE("Conversations (C API)", "[config][conversations][c]") {
@@ -532,6 +551,36 @@ TEST_CASE("Conversation pruning", "[config][conversations][pruning]") {
     CHECK(convos.size() == 44);
     auto [seqno, push_data, obs] = convos.push();
     CHECK(convos.size() == 41);
+
+    // Conversations we learn about through a merge should be prunable as well:
+    session::config::ConvoInfoVolatile convos2{ustring_view{seed}, std::nullopt};
+    std::vector<std::pair<std::string, ustring_view>> merge_configs;
+    merge_configs.emplace_back("hash1", push_data);
+    CHECK(convos2.merge(merge_configs) == 1);
+    CHECK(convos2.size() == 41);
+
+    // Pruning again with the default age shouldn't change anything:
+    convos.prune_stale();
+    CHECK(convos.size() == 41);
+    CHECK(convos.needs_push());  // Still waiting on the push confirmation
+
+    // A shorter prune age removes everything older than it, except for ones flagged unread: that's
+    // 21-30 (minus 25 and 30, which are unread) and the three internally set 80-82 values.
+    convos.prune_stale(20 * 24h);
+    convos2.prune_stale(20 * 24h);
+    CHECK(convos.size() == 30);
+    CHECK(convos2.size() == 30);
+    // The unread ones (0, 5, ..., 65) all survive pruning:
+    CHECK(convos.size_unread() == 14);
+    CHECK(convos2.size_unread() == 14);
+    CHECK(convos2.size_unread_1to1() == 5);
+    CHECK(convos2.size_unread_communities() == 5);
+    CHECK(convos2.size_unread_legacy_groups() == 4);
+    CHECK(convos2.needs_push());
+    CHECK_FALSE(convos.get_1to1(some_session_id(21)));
+    CHECK(convos.get_1to1(some_session_id(18)));
+    CHECK(convos2.get_community("https://example.org", "room20"));
+    CHECK_FALSE(convos2.get_community("https://example.org", "room23"));
 }
 
 TEST_CASE("Conversation dump/load state bug", "[config][conversations][dump-load]") {
@@ -634,3 +683,415 @@ TEST_CASE("Conversation dump/load state bug", "[config][conversations][dump-load
     free(dump);
     CHECK_FALSE(config_needs_dump(conf2));
 }
+
+TEST_CASE("Conversation most recent", "[config][conversations][recent]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    std::array<unsigned char, 32> ed_pk;
+    std::array<unsigned char, 64> ed_sk;
+    crypto_sign_ed25519_seed_keypair(
+            ed_pk.data(), ed_sk.data(), reinterpret_cast<const unsigned char*>(seed.data()));
+
+    session::config::ConvoInfoVolatile convos{ustring_view{seed}, std::nullopt};
+
+    auto some_session_id = [](int x) -> std::string {
+        auto hex = std::to_string(x);
+        return "05" + std::string(64 - hex.size(), '0') + hex;
+    };
+    const auto now = std::chrono::system_clock::now();
+    auto minutes_ago = [&now](int m) -> int64_t {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                       (now - m * 1min).time_since_epoch())
+                .count();
+    };
+
+    CHECK(convos.most_recent(10).empty());
+
+    for (int i = 0; i < 30; i++) {
+        if (i % 3 == 0) {
+            auto c = convos.get_or_construct_1to1(some_session_id(i));
+            c.last_read = minutes_ago(i);
+            c.unread = i % 4 == 0;
+            convos.set(c);
+        } else if (i % 3 == 1) {
+            auto c = convos.get_or_construct_legacy_group(some_session_id(i));
+            c.last_read = minutes_ago(i);
+            c.unread = i % 4 == 0;
+            convos.set(c);
+        } else {
+            auto c = convos.get_or_construct_community(
+                    "https://example.org",
+                    "room" + std::to_string(i),
+                    "0000000000000000000000000000000000000000000000000000000000000000"_hexbytes);
+            c.last_read = minutes_ago(i);
+            c.unread = i % 4 == 0;
+            convos.set(c);
+        }
+    }
+
+    using session::config::convo::community;
+    using session::config::convo::legacy_group;
+    using session::config::convo::one_to_one;
+
+    auto last_reads = [](const std::vector<session::config::convo::any>& convos) {
+        std::vector<int64_t> result;
+        for (auto& c : convos)
+            result.push_back(var::visit([](auto& c) { return c.last_read; }, c));
+        return result;
+    };
+
+    auto recent = convos.most_recent(4);
+    REQUIRE(recent.size() == 4);
+    CHECK(last_reads(recent) ==
+          std::vector<int64_t>{minutes_ago(0), minutes_ago(1), minutes_ago(2), minutes_ago(3)});
+    REQUIRE(std::holds_alternative<one_to_one>(recent[0]));
+    CHECK(std::get<one_to_one>(recent[0]).session_id == some_session_id(0));
+    REQUIRE(std::holds_alternative<legacy_group>(recent[1]));
+    CHECK(std::get<legacy_group>(recent[1]).id == some_session_id(1));
+    REQUIRE(std::holds_alternative<community>(recent[2]));
+    CHECK(std::get<community>(recent[2]).room() == "room2");
+    CHECK(std::get<community>(recent[2]).pubkey_hex() ==
+          "0000000000000000000000000000000000000000000000000000000000000000");
+
+    CHECK(convos.most_recent(100).size() == 30);
+
+    auto unread = convos.most_recent(3, true);
+    CHECK(last_reads(unread) ==
+          std::vector<int64_t>{minutes_ago(0), minutes_ago(4), minutes_ago(8)});
+    CHECK(convos.most_recent(100, true).size() == 8);
+    CHECK(convos.size_unread() == 8);
+    CHECK(convos.size_unread_1to1() == 3);
+    CHECK(convos.size_unread_communities() == 2);
+    CHECK(convos.size_unread_legacy_groups() == 3);
+
+    // Updating, erasing, and merging should all be reflected in the ordering:
+    auto c = convos.get_or_construct_1to1(some_session_id(27));
+    c.last_read = minutes_ago(0) + 1;
+    convos.set(c);
+    CHECK(convos.erase_legacy_group(some_session_id(1)));
+    CHECK(convos.erase_legacy_group(some_session_id(4)));
+    auto og = convos.get_or_construct_community(
+            "https://example.org",
+            "room8",
+            "0000000000000000000000000000000000000000000000000000000000000000"_hexbytes);
+    og.unread = false;
+    convos.set(og);
+    CHECK(convos.size_unread() == 6);
+    CHECK(convos.size_unread_communities() == 1);
+    CHECK(convos.size_unread_legacy_groups() == 2);
+
+    recent = convos.most_recent(3);
+    CHECK(last_reads(recent) ==
+          std::vector<int64_t>{minutes_ago(0) + 1, minutes_ago(0), minutes_ago(2)});
+    REQUIRE(std::holds_alternative<one_to_one>(recent[0]));
+    CHECK(std::get<one_to_one>(recent[0]).session_id == some_session_id(27));
+
+    auto [seqno, to_push, obs] = convos.push();
+    session::config::ConvoInfoVolatile convos2{ustring_view{seed}, std::nullopt};
+    std::vector<std::pair<std::string, ustring_view>> merge_configs;
+    merge_configs.emplace_back("hash1", to_push);
+    REQUIRE(convos2.merge(merge_configs) == 1);
+    CHECK(last_reads(convos2.most_recent(3)) == last_reads(recent));
+    CHECK(last_reads(convos2.most_recent(3, true)) == last_reads(convos.most_recent(3, true)));
+    CHECK(convos2.size_unread() == 6);
+    CHECK(convos2.size_unread_1to1() == 3);
+    CHECK(convos2.size_unread_communities() == 1);
+    CHECK(convos2.size_unread_legacy_groups() == 2);
+
+    // C API:
+    config_object* conf;
+    REQUIRE(0 == convo_info_volatile_init(&conf, ed_sk.data(), NULL, 0, NULL));
+    const char* merge_hash[1] = {"hash1"};
+    const unsigned char* merge_data[1] = {to_push.data()};
+    size_t merge_size[1] = {to_push.size()};
+    REQUIRE(config_merge(conf, merge_hash, merge_data, merge_size, 1) == 1);
+    CHECK(convo_info_volatile_size_unread(conf) == 6);
+    CHECK(convo_info_volatile_size_unread_1to1(conf) == 3);
+    CHECK(convo_info_volatile_size_unread_communities(conf) == 1);
+    CHECK(convo_info_volatile_size_unread_legacy_groups(conf) == 2);
+
+    convo_info_volatile_1to1 c1;
+    convo_info_volatile_community c2;
+    convo_info_volatile_legacy_group c3;
+    std::vector<int64_t> c_last_reads;
+    std::vector<std::string> seen;
+    auto* it = convo_info_volatile_iterator_new_most_recent(conf, 4, false);
+    for (; !convo_info_volatile_iterator_done(it); convo_info_volatile_iterator_advance(it)) {
+        if (convo_info_volatile_it_is_1to1(it, &c1)) {
+            c_last_reads.push_back(c1.last_read);
+            seen.push_back(c1.session_id);
+        } else if (convo_info_volatile_it_is_community(it, &c2)) {
+            c_last_reads.push_back(c2.last_read);
+            seen.push_back(c2.room);
+        } else if (convo_info_volatile_it_is_legacy_group(it, &c3)) {
+            c_last_reads.push_back(c3.last_read);
+            seen.push_back(c3.group_id);
+        }
+    }
+    convo_info_volatile_iterator_free(it);
+    CHECK(c_last_reads == last_reads(convos.most_recent(4)));
+    CHECK(seen == std::vector<std::string>{
+                          some_session_id(27), some_session_id(0), "room2", some_session_id(3)});
+
+    it = convo_info_volatile_iterator_new_most_recent(conf, 0, true);
+    CHECK(convo_info_volatile_iterator_done(it));
+    convo_info_volatile_iterator_free(it);
+
+    config_free(conf);
+}
+
+TEST_CASE("Conversation bulk mark read", "[config][conversations][mark-read]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    std::array<unsigned char, 32> ed_pk;
+    std::array<unsigned char, 64> ed_sk;
+    crypto_sign_ed25519_seed_keypair(
+            ed_pk.data(), ed_sk.data(), reinterpret_cast<const unsigned char*>(seed.data()));
+
+    session::config::ConvoInfoVolatile convos{ustring_view{seed}, std::nullopt};
+
+    auto some_session_id = [](int x) -> std::string {
+        auto hex = std::to_string(x);
+        return "05" + std::string(64 - hex.size(), '0') + hex;
+    };
+    const auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::system_clock::now().time_since_epoch())
+                                .count();
+
+    for (int i = 0; i < 10; i++) {
+        auto c = convos.get_or_construct_1to1(some_session_id(i));
+        c.last_read = now_ms - i * 1000;
+        c.unread = i % 2 == 0;
+        convos.set(c);
+
+        auto g = convos.get_or_construct_legacy_group(some_session_id(100 + i));
+        g.last_read = now_ms - i * 1000;
+        g.unread = i % 2 == 1;
+        convos.set(g);
+    }
+    auto og = convos.get_or_construct_community(
+            "https://example.org",
+            "Room",
+            "0000000000000000000000000000000000000000000000000000000000000000"_hexbytes);
+    og.last_read = now_ms;
+    og.unread = true;
+    convos.set(og);
+
+    auto [seqno, to_push, obs] = convos.push();
+    convos.confirm_pushed(seqno, "hash1");
+    CHECK_FALSE(convos.needs_push());
+    CHECK(convos.size_unread() == 11);
+
+    // The community is unread (but not older than the given timestamp):
+    CHECK(convos.mark_read(now_ms - 5000, false, true, false) == 1);
+    CHECK(convos.needs_push());
+    std::tie(seqno, to_push, obs) = convos.push();
+    convos.confirm_pushed(seqno, "hash2");
+    // Doing it again changes nothing, and so shouldn't dirty the config:
+    CHECK(convos.mark_read(now_ms - 5000, false, true, false) == 0);
+    CHECK_FALSE(convos.needs_push());
+    CHECK(convos.size_unread() == 10);
+    CHECK(convos.size_unread_communities() == 0);
+
+    // Mark the 1-to-1s read up to now_ms - 5000: that affects the unread ones (0, 2, 4, 6, 8) and
+    // the ones with an older timestamp (6, 7, 8, 9).
+    CHECK(convos.mark_read(now_ms - 5000, true, false, false) == 7);
+    CHECK(convos.needs_push());
+    CHECK(convos.size_unread_1to1() == 0);
+    CHECK(convos.size_unread_legacy_groups() == 5);
+    CHECK(convos.get_1to1(some_session_id(0))->last_read == now_ms);
+    CHECK(convos.get_1to1(some_session_id(7))->last_read == now_ms - 5000);
+    CHECK_FALSE(convos.get_1to1(some_session_id(8))->unread);
+    CHECK(convos.get_legacy_group(some_session_id(109))->last_read == now_ms - 9000);
+    CHECK(convos.get_legacy_group(some_session_id(109))->unread);
+    CHECK(convos.most_recent(1, true).size() == 1);
+
+    // C API:
+    config_object* conf;
+    REQUIRE(0 == convo_info_volatile_init(&conf, ed_sk.data(), NULL, 0, NULL));
+    std::tie(seqno, to_push, obs) = convos.push();
+    const char* merge_hash[1] = {"hash3"};
+    const unsigned char* merge_data[1] = {to_push.data()};
+    size_t merge_size[1] = {to_push.size()};
+    REQUIRE(config_merge(conf, merge_hash, merge_data, merge_size, 1) == 1);
+    CHECK(convo_info_volatile_size_unread(conf) == 5);
+    // Everything except for the three conversations already read at `now_ms`:
+    CHECK(convo_info_volatile_mark_read(conf, now_ms, true, true, true) == 18);
+    CHECK(convo_info_volatile_size_unread(conf) == 0);
+    CHECK(config_needs_push(conf));
+
+    convo_info_volatile_legacy_group g;
+    REQUIRE(convo_info_volatile_get_legacy_group(conf, &g, some_session_id(109).c_str()));
+    CHECK(g.last_read == now_ms);
+    CHECK_FALSE(g.unread);
+
+    config_free(conf);
+
+    // A timestamp older than the prune cutoff still clears the unread flags, but isn't stored
+    // (just as with set()), so it can't write values that the next push would prune:
+    auto g2 = convos.get_or_construct_legacy_group(some_session_id(110));
+    g2.unread = true;
+    convos.set(g2);
+    std::tie(seqno, to_push, obs) = convos.push();
+    convos.confirm_pushed(seqno, "hash3");
+    const int64_t old_ms =
+            now_ms - std::chrono::duration_cast<std::chrono::milliseconds>(
+                             session::config::ConvoInfoVolatile::PRUNE_LOW + 24h)
+                             .count();
+    CHECK(convos.mark_read(old_ms, false, false, true) == 6);
+    CHECK(convos.size_unread_legacy_groups() == 0);
+    CHECK(convos.get_legacy_group(some_session_id(109))->last_read == now_ms - 9000);
+    CHECK(convos.get_legacy_group(some_session_id(110))->last_read == 0);
+    CHECK(convos.needs_push());
+    std::tie(seqno, to_push, obs) = convos.push();
+    convos.confirm_pushed(seqno, "hash4");
+    CHECK(convos.mark_read(old_ms, false, false, true) == 0);
+    CHECK_FALSE(convos.needs_push());
+}
+
+// Populates `convos` with `n` conversations, evenly split between one-to-ones, legacy groups, and
+// communities (spread over 10 servers).
+static void add_view_test_convos(session::config::ConvoInfoVolatile& convos, int n) {
+    const auto server_pk =
+            "0000000000000000000000000000000000000000000000000000000000000000"_hexbytes;
+    const int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count();
+    for (int i = 0; i < n; i++) {
+        auto hex = std::to_string(i);
+        auto sid = "05" + std::string(64 - hex.size(), '0') + hex;
+        if (i % 3 == 0) {
+            auto c = convos.get_or_construct_1to1(sid);
+            c.last_read = now_ms - i;
+            c.unread = i % 4 == 0;
+            convos.set(c);
+        } else if (i % 3 == 1) {
+            auto c = convos.get_or_construct_legacy_group(sid);
+            c.last_read = now_ms - i;
+            c.unread = i % 4 == 0;
+            convos.set(c);
+        } else {
+            auto c = convos.get_or_construct_community(
+                    "https://example" + std::to_string(i % 10) + ".org", "Room" + hex, server_pk);
+            c.last_read = now_ms - i;
+            c.unread = i % 4 == 0;
+            convos.set(c);
+        }
+    }
+}
+
+TEST_CASE("Conversation views", "[config][conversations][views]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    session::config::ConvoInfoVolatile convos{ustring_view{seed}, std::nullopt};
+
+    CHECK(convos.view().begin() == convos.view().end());
+
+    add_view_test_convos(convos, 300);
+
+    // Invalid community entries (which clients should never store) are skipped by both the view
+    // and the regular iterators: a bad base url, and a bad room token.
+    const ustring server_pk(32, 0);
+    convos.data["o"]["example.com"]["#"] = server_pk;
+    convos.data["o"]["example.com"]["R"]["room"]["u"] = 1;
+    convos.data["o"]["https://example1.org"]["R"]["bad room"]["u"] = 1;
+
+    size_t count = 0, communities = 0;
+    auto it = convos.begin();
+    for (const auto& c : convos.view()) {
+        REQUIRE(it != convos.end());
+        if (auto* dm = std::get_if<session::config::convo::one_to_one>(&*it)) {
+            CHECK(c.is_one_to_one());
+            CHECK(c.id_hex() == dm->session_id);
+            CHECK(c.last_read() == dm->last_read);
+            CHECK(c.unread() == dm->unread);
+            auto loaded = c.load();
+            REQUIRE(std::holds_alternative<session::config::convo::one_to_one>(loaded));
+            CHECK(std::get<session::config::convo::one_to_one>(loaded).session_id ==
+                  dm->session_id);
+        } else if (auto* og = std::get_if<session::config::convo::community>(&*it)) {
+            communities++;
+            CHECK(c.is_community());
+            CHECK(c.id == og->base_url());
+            CHECK(c.room == og->room_norm());
+            CHECK(c.pubkey == og->pubkey());
+            CHECK(c.id_hex() == "");
+            CHECK(c.last_read() == og->last_read);
+            CHECK(c.unread() == og->unread);
+            auto loaded = c.load();
+            REQUIRE(std::holds_alternative<session::config::convo::community>(loaded));
+            CHECK(std::get<session::config::convo::community>(loaded).full_url() ==
+                  og->full_url());
+        } else {
+            auto& lg = std::get<session::config::convo::legacy_group>(*it);
+            CHECK(c.is_legacy_group());
+            CHECK(c.id_hex() == lg.id);
+            CHECK(c.last_read() == lg.last_read);
+            CHECK(c.unread() == lg.unread);
+        }
+        ++it;
+        count++;
+    }
+    CHECK(it == convos.end());
+    CHECK(count == 300);
+    CHECK(communities == 100);
+
+    count = 0;
+    for (const auto& c : convos.view(false, true, false)) {
+        CHECK(c.is_community());
+        count++;
+    }
+    CHECK(count == communities);
+
+    count = 0;
+    for (const auto& c : convos.view(true, false, true)) {
+        CHECK_FALSE(c.is_community());
+        count++;
+    }
+    CHECK(count == 200);
+}
+
+TEST_CASE("Conversation snapshots", "[config][conversations][snapshot]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    session::config::ConvoInfoVolatile convos{ustring_view{seed}, std::nullopt};
+
+    add_view_test_convos(convos, 30);
+    auto unread = convos.size_unread();
+    REQUIRE(unread > 0);
+    convos.publish();
+    auto snap = convos.snapshot();
+    CHECK(snap->size() == convos.size());
+    CHECK(snap->size_unread() == unread);
+
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
+    convos.mark_read(now_ms);
+    CHECK(convos.size_unread() == 0);
+    CHECK(snap->size_unread() == unread);
+    convos.publish();
+    CHECK(convos.snapshot()->size_unread() == 0);
+    CHECK(snap->size_unread() == unread);
+}
+
+TEST_CASE("Conversation iteration benchmark", "[.][benchmark][config][conversations]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    session::config::ConvoInfoVolatile convos{ustring_view{seed}, std::nullopt};
+    add_view_test_convos(convos, 10'000);
+
+    BENCHMARK("iterator, 10k conversations") {
+        int64_t sum = 0;
+        for (const auto& c : convos)
+            sum += std::visit([](const auto& x) { return x.last_read; }, c);
+        return sum;
+    };
+
+    BENCHMARK("view, 10k conversations") {
+        int64_t sum = 0;
+        for (const auto& c : convos.view())
+            sum += c.last_read();
+        return sum;
+    };
+}
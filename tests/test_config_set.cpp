@@ -0,0 +1,206 @@
+#include <oxenc/hex.h>
+#include <session/config/config_set.h>
+#include <session/config/contacts.h>
+#include <session/config/user_profile.h>
+#include <sodium/crypto_sign_ed25519.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <session/config/config_set.hpp>
+#include <string_view>
+#include <thread>
+
+#include "utils.hpp"
+
+using namespace std::literals;
+using namespace oxenc::literals;
+using session::config::Namespace;
+
+TEST_CASE("Config set", "[config][config_set]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+
+    session::config::ConfigSet set1{ustring_view{seed}};
+    CHECK_FALSE(set1.needs_push());
+    CHECK(set1.push().empty());
+    CHECK(&set1.config(Namespace::Contacts) == &set1.contacts());
+    CHECK_THROWS_AS(set1.config(static_cast<Namespace>(1)), std::invalid_argument);
+
+    const auto sid = "050000000000000000000000000000000000000000000000000000000000000000"s;
+    set1.user_profile().set_name("Kallie");
+    set1.contacts().set_name(sid, "Joe");
+    set1.user_groups().get_or_construct_legacy_group(sid);  // Doesn't modify anything
+    {
+        auto c = set1.convo_info_volatile().get_or_construct_1to1(sid);
+        c.unread = true;
+        set1.convo_info_volatile().set(c);
+    }
+    CHECK(set1.needs_push());
+    CHECK(set1.needs_dump());
+
+    auto pushes = set1.push();
+    REQUIRE(pushes.size() == 3);
+    CHECK(pushes[0].ns == Namespace::UserProfile);
+    CHECK(pushes[1].ns == Namespace::Contacts);
+    CHECK(pushes[2].ns == Namespace::ConvoInfoVolatile);
+    for (auto& p : pushes) {
+        CHECK(p.seqno == 1);
+        CHECK(p.obsolete.empty());
+    }
+
+    // A second device, receiving all the messages in a single poll:
+    session::config::ConfigSet set2{ustring_view{seed}};
+    std::vector<session::config::ConfigSet::message> msgs;
+    for (size_t i = 0; i < pushes.size(); i++)
+        msgs.push_back({pushes[i].ns, "hash" + std::to_string(i), pushes[i].data});
+    CHECK(set2.merge(msgs) == 3);
+    CHECK(set2.user_profile().get_name() == "Kallie"sv);
+    REQUIRE(set2.contacts().get(sid));
+    CHECK(set2.contacts().get(sid)->name == "Joe");
+    REQUIRE(set2.convo_info_volatile().get_1to1(sid));
+    CHECK(set2.convo_info_volatile().get_1to1(sid)->unread);
+    CHECK_FALSE(set2.needs_push());
+
+    // With an executor the configs are merged concurrently: the first on the calling thread, the
+    // others each in a task given to the executor.
+    session::config::ConfigSet set2b{ustring_view{seed}};
+    std::vector<std::thread> threads;
+    set2b.set_executor([&](std::function<void()> task) { threads.emplace_back(std::move(task)); });
+    CHECK(set2b.merge(msgs) == 3);
+    CHECK(threads.size() == 2);
+    for (auto& t : threads)
+        t.join();
+    CHECK(set2b.user_profile().get_name() == "Kallie"sv);
+    REQUIRE(set2b.contacts().get(sid));
+    CHECK(set2b.contacts().get(sid)->name == "Joe");
+    REQUIRE(set2b.convo_info_volatile().get_1to1(sid));
+    CHECK(set2b.convo_info_volatile().get_1to1(sid)->unread);
+
+    // Unknown namespaces are rejected, without merging anything:
+    msgs.push_back({static_cast<Namespace>(1), "hash99", pushes[0].data});
+    CHECK_THROWS_AS(set2.merge(msgs), std::invalid_argument);
+
+    for (size_t i = 0; i < pushes.size(); i++)
+        set1.confirm_pushed(pushes[i].ns, pushes[i].seqno, "hash" + std::to_string(i));
+    CHECK_FALSE(set1.needs_push());
+    CHECK_THROWS_AS(
+            set1.confirm_pushed(static_cast<Namespace>(1), 1, "hash99"), std::invalid_argument);
+
+    auto dump = set1.dump();
+    CHECK_FALSE(set1.needs_dump());
+
+    session::config::ConfigSet set3{ustring_view{seed}, dump};
+    CHECK_FALSE(set3.needs_push());
+    CHECK_FALSE(set3.needs_dump());
+    CHECK(set3.user_profile().get_name() == "Kallie"sv);
+    REQUIRE(set3.contacts().get(sid));
+    CHECK(set3.contacts().get(sid)->name == "Joe");
+    CHECK(set3.config(Namespace::Contacts).current_hashes() == std::vector{{"hash1"s}});
+    CHECK(set3.user_groups().empty());
+
+    // Once confirmed, an update on the second device replaces (and obsoletes) the first message:
+    set2.contacts().set_name(sid, "Joseph");
+    pushes = set2.push();
+    REQUIRE(pushes.size() == 1);
+    CHECK(pushes[0].ns == Namespace::Contacts);
+    CHECK(pushes[0].seqno == 2);
+    CHECK(pushes[0].obsolete == std::vector{{"hash1"s}});
+    CHECK(set3.merge({{Namespace::Contacts, "hash4", pushes[0].data}}) == 1);
+    CHECK(set3.contacts().get(sid)->name == "Joseph");
+    CHECK(set3.needs_dump());
+}
+
+TEST_CASE("Config set (C API)", "[config][config_set][c]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    std::array<unsigned char, 32> ed_pk;
+    std::array<unsigned char, 64> ed_sk;
+    crypto_sign_ed25519_seed_keypair(
+            ed_pk.data(), ed_sk.data(), reinterpret_cast<const unsigned char*>(seed.data()));
+
+    char err[256];
+    user_config_set* set1;
+    REQUIRE(user_config_set_init(&set1, ed_sk.data(), NULL, 0, err) == 0);
+
+    CHECK(user_config_set_get(set1, 1) == nullptr);
+    auto* profile = user_config_set_get(set1, 2);
+    auto* contacts = user_config_set_get(set1, 3);
+    REQUIRE(profile);
+    REQUIRE(contacts);
+    CHECK(config_storage_namespace(profile) == 2);
+    CHECK(config_storage_namespace(contacts) == 3);
+
+    // The contained configs belong to the set, so freeing one is a no-op:
+    config_free(contacts);
+    CHECK(user_config_set_get(set1, 3) == contacts);
+    CHECK(config_storage_namespace(contacts) == 3);
+
+    CHECK_FALSE(user_config_set_needs_push(set1));
+    REQUIRE(user_profile_set_name(profile, "Kallie") == 0);
+    contacts_contact c;
+    const char* sid = "050000000000000000000000000000000000000000000000000000000000000000";
+    REQUIRE(contacts_get_or_construct(contacts, &c, sid));
+    std::strcpy(c.name, "Joe");
+    contacts_set(contacts, &c);
+    CHECK(user_config_set_needs_push(set1));
+
+    auto* pushes = user_config_set_push(set1);
+    REQUIRE(pushes->len == 2);
+    CHECK(pushes->namespaces[0] == 2);
+    CHECK(pushes->namespaces[1] == 3);
+    CHECK(pushes->pushes[0].seqno == 1);
+    CHECK(pushes->pushes[1].seqno == 1);
+    CHECK(pushes->pushes[0].obsolete_len == 0);
+
+    user_config_set* set2;
+    REQUIRE(user_config_set_init(&set2, ed_sk.data(), NULL, 0, err) == 0);
+    // An executor that runs tasks immediately (and counts them):
+    int executed = 0;
+    user_config_set_set_executor(
+            set2,
+            [](void (*run)(void*), void* task, void* ctx) {
+                ++*static_cast<int*>(ctx);
+                run(task);
+            },
+            &executed);
+    const char* hashes[2] = {"hash1", "hash2"};
+    const unsigned char* configs[2] = {pushes->pushes[0].config, pushes->pushes[1].config};
+    size_t lengths[2] = {pushes->pushes[0].config_len, pushes->pushes[1].config_len};
+    CHECK(user_config_set_merge(set2, pushes->namespaces, hashes, configs, lengths, 2) == 2);
+    CHECK(set2->last_error == nullptr);
+    CHECK(executed == 1);
+    CHECK(user_profile_get_name(user_config_set_get(set2, 2)) == "Kallie"sv);
+
+    int16_t bad_ns[2] = {2, 7};
+    CHECK(user_config_set_merge(set2, bad_ns, hashes, configs, lengths, 2) == -1);
+    CHECK(set2->last_error ==
+          "Invalid namespace 7: namespace is not part of the config set"sv);
+
+    for (size_t i = 0; i < pushes->len; i++)
+        CHECK(user_config_set_confirm_pushed(
+                set1, pushes->namespaces[i], pushes->pushes[i].seqno, hashes[i]));
+    free(pushes);
+    CHECK_FALSE(user_config_set_needs_push(set1));
+    CHECK_FALSE(user_config_set_confirm_pushed(set1, 7, 1, "hash3"));
+    CHECK(set1->last_error != nullptr);
+
+    CHECK(user_config_set_needs_dump(set1));
+    unsigned char* dump;
+    size_t dumplen;
+    user_config_set_dump(set1, &dump, &dumplen);
+    CHECK_FALSE(user_config_set_needs_dump(set1));
+    user_config_set_free(set1);
+
+    user_config_set* set3;
+    REQUIRE(user_config_set_init(&set3, ed_sk.data(), dump, dumplen, err) == 0);
+    free(dump);
+    CHECK(user_profile_get_name(user_config_set_get(set3, 2)) == "Kallie"sv);
+    REQUIRE(contacts_get(user_config_set_get(set3, 3), &c, sid));
+    CHECK(c.name == "Joe"sv);
+    CHECK_FALSE(user_config_set_needs_push(set3));
+
+    CHECK(user_config_set_init(&set1, ed_sk.data(), dump, 3, err) != 0);
+
+    user_config_set_free(set2);
+    user_config_set_free(set3);
+}
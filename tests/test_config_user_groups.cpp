@@ -2,6 +2,7 @@
 #include <session/config/user_groups.h>
 #include <sodium/crypto_sign_ed25519.h>
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <chrono>
 #include <session/config/user_groups.hpp>
@@ -78,6 +79,43 @@ TEST_CASE("Open Group URLs", "[config][community_urls]") {
     CHECK(to_hex(pk8) == "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
 }
 
+TEST_CASE("Community keys", "[config][community_urls][community_key]") {
+
+    using namespace session::config;
+
+    community_key k1{"HTTPS://EXAMPLE.COM", "SomeRoom"};
+    community_key k2{"https://example.com:443/", "someroom"};
+    community_key k3{"https://example.com", "otherroom"};
+    community_key k4{"http://example.com", "someroom"};
+
+    CHECK(k1.base_url() == "https://example.com");
+    CHECK(k1.room() == "someroom");
+    CHECK(k1.localized_room() == "SomeRoom");
+    CHECK(k1 == k2);
+    CHECK(k1 != k3);
+    CHECK(k1 != k4);
+    CHECK(k3 < k1);
+    CHECK(k4 < k1);
+
+    // Base urls are interned, so keys on the same server share the same string:
+    CHECK(&k1.base_url() == &k2.base_url());
+    CHECK(&k1.base_url() == &k3.base_url());
+    CHECK(&k1.base_url() != &k4.base_url());
+    CHECK(community::intern_base_url("HTTPS://example.com:443") ==
+          community::intern_base_url("https://example.com"));
+
+    CHECK_THROWS_AS(community_key("example.com", "someroom"), std::invalid_argument);
+    CHECK_THROWS_AS(community_key("https://example.com", "some room"), std::invalid_argument);
+
+    // A community made from a key keeps the room's case:
+    community c{k1};
+    CHECK(c.base_url() == "https://example.com");
+    CHECK(c.room() == "SomeRoom");
+    CHECK(c.room_norm() == "someroom");
+    CHECK(community_key{c} == k1);
+    CHECK(community_key{c}.localized_room() == "SomeRoom");
+}
+
 TEST_CASE("User Groups", "[config][groups]") {
 
     const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
@@ -310,6 +348,28 @@ TEST_CASE("User Groups", "[config][groups]") {
     REQUIRE(x3.has_value());
     CHECK(x3->room() == "sudokuRoom");  // We picked up the capitalization change
 
+    const session::config::community_key sudoku{"HTTP://example.org:5678", "SUDOKUROOM"};
+    auto x4 = groups.get_community(sudoku);
+    REQUIRE(x4);
+    CHECK(x4->room() == "sudokuRoom");
+    CHECK(x4->pubkey_hex() == to_hex(open_group_pubkey));
+    CHECK_FALSE(groups.get_community(
+            session::config::community_key{"http://example.org:5678", "otherroom"}));
+    auto x5 = groups.get_or_construct_community(
+            session::config::community_key{"http://example.org:5678", "OtherRoom"},
+            open_group_pubkey);
+    CHECK(x5.room() == "OtherRoom");
+    CHECK(x5.room_norm() == "otherroom");
+    CHECK(x5.pubkey_hex() == to_hex(open_group_pubkey));
+    CHECK_FALSE(groups.erase_community(x5.base_url(), x5.room()));
+    groups.set(x5);
+    CHECK(groups.size_communities() == 2);
+    CHECK(groups.erase_community(
+            session::config::community_key{"HTTP://EXAMPLE.ORG:5678/", "OTHERroom"}));
+    CHECK_FALSE(groups.get_community(x5.base_url(), x5.room()));
+    CHECK_FALSE(groups.erase_community(
+            session::config::community_key{"http://example.org:5678", "otherroom"}));
+
     CHECK(groups.size() == 2);
     CHECK(groups.size_communities() == 1);
     CHECK(groups.size_legacy_groups() == 1);
@@ -646,3 +706,314 @@ struct StringMaker<std::pair<const std::string, bool>> {
     }
 };
 }  // namespace Catch
+
+TEST_CASE("User Groups legacy member updates", "[config][groups][members]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    std::array<unsigned char, 32> ed_pk;
+    std::array<unsigned char, 64> ed_sk;
+    crypto_sign_ed25519_seed_keypair(
+            ed_pk.data(), ed_sk.data(), reinterpret_cast<const unsigned char*>(seed.data()));
+
+    session::config::UserGroups groups{ustring_view{seed}, std::nullopt};
+
+    const std::string group_id =
+            "051234567890abcdef1234567890abcdef1234567890abcdef1234567890abcdef";
+    std::vector<std::string> users;
+    for (char c : "0123456789"sv)
+        users.push_back("05" + std::string(64, c));
+
+    // Can't add to a group that doesn't exist:
+    CHECK_FALSE(groups.add_member(group_id, users[0]));
+    CHECK_FALSE(groups.needs_push());
+
+    {
+        auto lg = groups.get_or_construct_legacy_group(group_id);
+        lg.name = "Englishmen";
+        lg.insert(users[0], true);
+        lg.insert(users[1], false);
+        groups.set(lg);
+    }
+    auto [seqno, to_push, obs] = groups.push();
+    groups.confirm_pushed(seqno, "fakehash1");
+    CHECK_FALSE(groups.needs_push());
+
+    // No-op changes shouldn't dirty the config:
+    CHECK_FALSE(groups.add_member(group_id, users[0], true));
+    CHECK_FALSE(groups.add_member(group_id, users[1], false));
+    CHECK_FALSE(groups.remove_member(group_id, users[2]));
+    CHECK_FALSE(groups.set_admin(group_id, users[2], true));
+    CHECK_FALSE(groups.set_admin(group_id, users[0], true));
+    CHECK_FALSE(groups.needs_push());
+
+    CHECK_THROWS_AS(groups.add_member(group_id, "05123"), std::invalid_argument);
+    CHECK_THROWS_AS(groups.remove_member("05123", users[0]), std::invalid_argument);
+
+    CHECK(groups.add_member(group_id, users[2]));
+    CHECK(groups.needs_push());
+    CHECK(groups.add_member(group_id, users[3], true));
+    CHECK(groups.add_member(group_id, users[1], true));  // Promotes to admin
+    CHECK(groups.set_admin(group_id, users[0], false));
+    CHECK(groups.remove_member(group_id, users[2]));
+    CHECK_FALSE(groups.remove_member(group_id, users[2]));
+
+    std::map<std::string, bool> expected{{users[0], false}, {users[1], true}, {users[3], true}};
+    auto lg = groups.get_legacy_group(group_id);
+    REQUIRE(lg);
+    CHECK(lg->members() == expected);
+    CHECK(lg->name == "Englishmen");
+
+    // An id stored in both the member and admin sets (which we never produce, but another client
+    // could) is a regular member, and any update leaves it in just one of the sets:
+    const auto gid = oxenc::from_hex(group_id);
+    const auto sid5 = oxenc::from_hex(users[5]);
+    auto store_in_both = [&] {
+        groups.data["C"][gid]["m"].set_insert(sid5);
+        groups.data["C"][gid]["a"].set_insert(sid5);
+    };
+    auto stored_in = [&](const char* key) {
+        auto* s = groups.data["C"][gid][key].set();
+        return s && s->count(sid5);
+    };
+    store_in_both();
+    CHECK(groups.get_legacy_group(group_id)->members().at(users[5]) == false);
+    CHECK(groups.remove_member(group_id, users[5]));
+    CHECK_FALSE(stored_in("m"));
+    CHECK_FALSE(stored_in("a"));
+    CHECK_FALSE(groups.get_legacy_group(group_id)->members().count(users[5]));
+
+    store_in_both();
+    CHECK_FALSE(groups.add_member(group_id, users[5]));  // Already a regular member
+    CHECK(stored_in("m"));
+    CHECK_FALSE(stored_in("a"));
+
+    store_in_both();
+    CHECK_FALSE(groups.set_admin(group_id, users[5], false));
+    CHECK(stored_in("m"));
+    CHECK_FALSE(stored_in("a"));
+
+    store_in_both();
+    CHECK(groups.set_admin(group_id, users[5], true));
+    CHECK_FALSE(stored_in("m"));
+    CHECK(stored_in("a"));
+    CHECK(groups.get_legacy_group(group_id)->members().at(users[5]) == true);
+
+    store_in_both();
+    CHECK(groups.add_member(group_id, users[5], true));
+    CHECK_FALSE(stored_in("m"));
+    CHECK(stored_in("a"));
+
+    CHECK(groups.remove_member(group_id, users[5]));
+    CHECK(groups.get_legacy_group(group_id)->members() == expected);
+
+    std::tie(seqno, to_push, obs) = groups.push();
+    groups.confirm_pushed(seqno, "fakehash2");
+
+    // C API:
+    config_object* conf;
+    REQUIRE(0 == user_groups_init(&conf, ed_sk.data(), NULL, 0, NULL));
+    const char* merge_hash[1] = {"fakehash2"};
+    const unsigned char* merge_data[1] = {to_push.data()};
+    size_t merge_size[1] = {to_push.size()};
+    REQUIRE(config_merge(conf, merge_hash, merge_data, merge_size, 1) == 1);
+    CHECK_FALSE(config_needs_push(conf));
+
+    CHECK_FALSE(user_groups_legacy_add_member(conf, group_id.c_str(), users[1].c_str(), true));
+    CHECK_FALSE(user_groups_legacy_remove_member(conf, group_id.c_str(), users[2].c_str()));
+    CHECK(conf->last_error == nullptr);
+    CHECK_FALSE(config_needs_push(conf));
+
+    CHECK(user_groups_legacy_add_member(conf, group_id.c_str(), users[4].c_str(), false));
+    CHECK(user_groups_legacy_set_admin(conf, group_id.c_str(), users[4].c_str(), true));
+    CHECK(user_groups_legacy_remove_member(conf, group_id.c_str(), users[0].c_str()));
+    CHECK(config_needs_push(conf));
+
+    CHECK_FALSE(user_groups_legacy_add_member(conf, group_id.c_str(), "05123", false));
+    CHECK(conf->last_error ==
+          "Invalid session ID: expected 66 hex digits starting with 05; got 05123"sv);
+
+    expected.erase(users[0]);
+    expected.emplace(users[4], true);
+    auto* grp = user_groups_get_legacy_group(conf, group_id.c_str());
+    REQUIRE(grp);
+    std::map<std::string, bool> c_members;
+    const char* session_id;
+    bool admin;
+    auto* it = ugroups_legacy_members_begin(grp);
+    while (ugroups_legacy_members_next(it, &session_id, &admin))
+        c_members.emplace(session_id, admin);
+    ugroups_legacy_members_free(it);
+    ugroups_legacy_group_free(grp);
+    CHECK(c_members == expected);
+
+    config_free(conf);
+}
+
+TEST_CASE("User Groups legacy members view", "[config][groups][members]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    std::array<unsigned char, 32> ed_pk;
+    std::array<unsigned char, 64> ed_sk;
+    crypto_sign_ed25519_seed_keypair(
+            ed_pk.data(), ed_sk.data(), reinterpret_cast<const unsigned char*>(seed.data()));
+
+    session::config::UserGroups groups{ustring_view{seed}, std::nullopt};
+
+    const std::string group_id =
+            "051234567890abcdef1234567890abcdef1234567890abcdef1234567890abcdef";
+
+    CHECK(groups.legacy_members(group_id).empty());
+    CHECK_THROWS_AS(groups.legacy_members("05123"), std::invalid_argument);
+
+    auto lg = groups.get_or_construct_legacy_group(group_id);
+    for (int i = 0; i < 100; i++) {
+        char buf[67];
+        std::snprintf(buf, sizeof(buf), "05%064x", i * 7919);
+        lg.insert(buf, i % 3 == 0);
+    }
+    groups.set(lg);
+
+    std::vector<std::pair<std::string, bool>> expected{
+            lg.members().begin(), lg.members().end()};
+    std::vector<std::pair<std::string, bool>> viewed;
+    for (const auto& m : groups.legacy_members(group_id)) {
+        CHECK(m.session_id.size() == 33);
+        viewed.emplace_back(m.session_id_hex(), m.admin);
+    }
+    CHECK(viewed == expected);
+
+    // C API:
+    auto [seqno, to_push, obs] = groups.push();
+    config_object* conf;
+    REQUIRE(0 == user_groups_init(&conf, ed_sk.data(), NULL, 0, NULL));
+    const char* merge_hash[1] = {"fakehash1"};
+    const unsigned char* merge_data[1] = {to_push.data()};
+    size_t merge_size[1] = {to_push.size()};
+    REQUIRE(config_merge(conf, merge_hash, merge_data, merge_size, 1) == 1);
+
+    CHECK(ugroups_legacy_members_view_begin(conf, "05123") == nullptr);
+    CHECK(conf->last_error != nullptr);
+
+    viewed.clear();
+    const unsigned char* session_id;
+    bool admin;
+    auto* it = ugroups_legacy_members_view_begin(conf, group_id.c_str());
+    REQUIRE(it);
+    CHECK(conf->last_error == nullptr);
+    while (ugroups_legacy_members_view_next(it, &session_id, &admin))
+        viewed.emplace_back(oxenc::to_hex(session_id, session_id + 33), admin);
+    ugroups_legacy_members_view_free(it);
+    CHECK(viewed == expected);
+
+    it = ugroups_legacy_members_view_begin(
+            conf, "051111111111111111111111111111111111111111111111111111111111111111");
+    REQUIRE(it);
+    CHECK_FALSE(ugroups_legacy_members_view_next(it, &session_id, &admin));
+    ugroups_legacy_members_view_free(it);
+
+    config_free(conf);
+}
+
+// Populates `groups` with `n` groups, half legacy groups and half communities (spread over 10
+// servers).
+static void add_view_test_groups(session::config::UserGroups& groups, int n) {
+    const auto server_pk =
+            "0000000000000000000000000000000000000000000000000000000000000000"_hexbytes;
+    for (int i = 0; i < n; i++) {
+        auto hex = std::to_string(i);
+        if (i % 2 == 0) {
+            auto g = groups.get_or_construct_legacy_group(
+                    "05" + std::string(64 - hex.size(), '0') + hex);
+            g.name = "Group " + hex;
+            g.priority = i % 5;
+            g.joined_at = 1'700'000'000 + i;
+            groups.set(g);
+        } else {
+            auto c = groups.get_or_construct_community(
+                    "https://example" + std::to_string(i % 10) + ".org", "Room" + hex, server_pk);
+            c.priority = i % 5;
+            c.mute_until = 1'700'000'000 + i;
+            groups.set(c);
+        }
+    }
+}
+
+TEST_CASE("User Groups views", "[config][groups][views]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    session::config::UserGroups groups{ustring_view{seed}, std::nullopt};
+
+    CHECK(groups.view().begin() == groups.view().end());
+
+    add_view_test_groups(groups, 200);
+
+    // Invalid community entries (which clients should never store) are skipped by both the view
+    // and the regular iterators: a bad base url, a bad room token, and a bad room name.
+    const ustring server_pk(32, 0);
+    groups.data["o"]["example.com"]["#"] = server_pk;
+    groups.data["o"]["example.com"]["R"]["room"]["+"] = 1;
+    groups.data["o"]["https://example1.org"]["R"]["bad room"]["+"] = 1;
+    groups.data["o"]["https://example1.org"]["R"]["badname"]["n"] = "Bad Name"s;
+
+    size_t count = 0;
+    auto it = groups.begin();
+    for (const auto& g : groups.view()) {
+        REQUIRE(it != groups.end());
+        if (auto* c = std::get_if<session::config::community_info>(&*it)) {
+            CHECK(g.is_community());
+            CHECK(g.id == c->base_url());
+            CHECK(g.room == c->room_norm());
+            CHECK(g.name() == c->room());
+            CHECK(g.pubkey == c->pubkey());
+            CHECK(g.id_hex() == "");
+            CHECK(g.priority() == c->priority);
+            CHECK(g.mute_until() == c->mute_until);
+            auto loaded = g.load();
+            REQUIRE(std::holds_alternative<session::config::community_info>(loaded));
+            CHECK(std::get<session::config::community_info>(loaded).full_url() == c->full_url());
+        } else {
+            auto& lg = std::get<session::config::legacy_group_info>(*it);
+            CHECK(g.is_legacy_group());
+            CHECK(g.id_hex() == lg.session_id);
+            CHECK(g.name() == lg.name);
+            CHECK(g.priority() == lg.priority);
+            CHECK(g.joined_at() == lg.joined_at);
+            CHECK(g.notifications() == lg.notifications);
+            auto loaded = g.load();
+            REQUIRE(std::holds_alternative<session::config::legacy_group_info>(loaded));
+            CHECK(std::get<session::config::legacy_group_info>(loaded).name == lg.name);
+        }
+        ++it;
+        count++;
+    }
+    CHECK(it == groups.end());
+    CHECK(count == 200);
+
+    count = 0;
+    for (const auto& g : groups.view(false, true)) {
+        CHECK(g.is_legacy_group());
+        count++;
+    }
+    CHECK(count == 100);
+}
+
+TEST_CASE("User Groups iteration benchmark", "[.][benchmark][config][groups]") {
+
+    const auto seed = "0123456789abcdef0123456789abcdef00000000000000000000000000000000"_hexbytes;
+    session::config::UserGroups groups{ustring_view{seed}, std::nullopt};
+    add_view_test_groups(groups, 10'000);
+
+    BENCHMARK("iterator, 10k groups") {
+        int64_t sum = 0;
+        for (const auto& g : groups)
+            sum += std::visit([](const auto& x) { return x.priority; }, g);
+        return sum;
+    };
+
+    BENCHMARK("view, 10k groups") {
+        int64_t sum = 0;
+        for (const auto& g : groups.view())
+            sum += g.priority();
+        return sum;
+    };
+}
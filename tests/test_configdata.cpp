@@ -397,6 +397,14 @@ TEST_CASE("config message signature", "[config][signing]") {
     CHECK(msg.hash() == m.hash());
     CHECK(printable(msg.serialize()) == printable(m_expected));
 
+    // Without a signer, an unmodified message still reserializes with its original signature:
+    ConfigMessage msg_verify_only{m_expected, verifier};
+    CHECK(printable(msg_verify_only.serialize()) == printable(m_expected));
+    CHECK(printable(msg_verify_only.serialize(false)) == printable(m_expected));
+    // ... but an incremented message drops it (and isn't signed, without a signer):
+    auto msg_inc = msg_verify_only.increment();
+    CHECK(msg_inc.serialize().find("1:~"_bytes) == ustring::npos);
+
     auto m_broken = m_expected;
     REQUIRE(m_broken[m_broken.size() - 2] == 0x07);
     m_broken[m_broken.size() - 2] = 0x17;
@@ -433,6 +441,19 @@ TEST_CASE("config message signature", "[config][signing]") {
             config::missing_signature,
             Message("Config signature is missing"));
 
+    // Unless it's the first message and that one is trusted:
+    ConfigMessage m_trusted{
+            {m_unsigned, m_broken},
+            verifier,
+            nullptr,
+            ConfigMessage::DEFAULT_DIFF_LAGS,
+            false,
+            [](size_t i, const auto& exc) { CHECK(i == 1); },
+            true};
+    CHECK(m_trusted.unmerged_index() == 0);
+    CHECK_FALSE(m_trusted.verified_signature());
+    CHECK(m_trusted.verifier);
+
     ConfigMessage m_no_sig{m_unsigned, verifier, nullptr, ConfigMessage::DEFAULT_DIFF_LAGS, true};
     CHECK(m_no_sig.seqno() == 10);
     CHECK(m_no_sig.data() == m.data());
@@ -1143,3 +1164,52 @@ TEST_CASE("config message example 4 - complex conflict resolution", "[config][ex
     CHECK(m_alt1.seqno() == 127);
     CHECK(m_alt1.hash() == m127.hash());
 }
+
+TEST_CASE("config message stale message pruning", "[config][merge][peek]") {
+    MutableConfigMessage m10{10, 5};
+    m10.data()["a"] = 1;
+    auto m11 = m10.increment();
+    m11.data()["b"] = 2;
+    auto m12 = m11.increment();
+    m12.data()["c"] = 3;
+
+    CHECK(config::peek_seqno(m12.serialize()) == 12);
+    CHECK(config::peek_seqno("d1:#i-3ee"_bytes) == -3);
+    CHECK_FALSE(config::peek_seqno("d1:&dee"_bytes));
+    CHECK_FALSE(config::peek_seqno("garbage"_bytes));
+
+    // Invalid, but far too old to matter (and so never parsed):
+    auto stale = "d1:#i3e1:&i5ee"_bytes;
+    // Invalid, and new enough that it has to be parsed:
+    auto bad = "d1:#i12e1:&i5ee"_bytes;
+
+    std::vector<size_t> errors;
+    auto on_error = [&](size_t i, const config::config_error&) { errors.push_back(i); };
+
+    ConfigMessage m{
+            {bad, stale, m10.serialize(), m11.serialize(), m12.serialize()},
+            nullptr,
+            nullptr,
+            5,
+            false,
+            on_error};
+    CHECK(errors == std::vector<size_t>{0});
+    CHECK_FALSE(m.merged());
+    // The index is of the given message, not counting the ones that failed to parse:
+    CHECK(m.unmerged_index() == 4);
+    CHECK(m.seqno() == 12);
+    CHECK(m.hash() == m12.hash());
+
+    // Without the newer message, the stale one still doesn't get parsed:
+    errors.clear();
+    ConfigMessage m_alt{
+            {stale, m11.serialize(), m10.serialize()}, nullptr, nullptr, 5, false, on_error};
+    CHECK(errors.empty());
+    CHECK(m_alt.unmerged_index() == 1);
+    CHECK(m_alt.hash() == m11.hash());
+
+    // ... but it does if there is nothing newer:
+    CHECK_THROWS_AS(
+            ConfigMessage({stale}, nullptr, nullptr, 5, false, on_error), config::config_error);
+    CHECK(errors == std::vector<size_t>{0});
+}
@@ -4,6 +4,8 @@
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_exception.hpp>
+#include <algorithm>
+#include <cstring>
 #include <iterator>
 #include <session/config.hpp>
 #include <session/config/encrypt.hpp>
@@ -39,6 +41,14 @@ TEST_CASE("config message encryption", "[config][encrypt]") {
     CHECK_THROWS_AS(config::decrypt(enc1, key1, "test-suite2"), config::decrypt_error);
     CHECK_THROWS_AS(config::decrypt(enc1, key2, "test-suite1"), config::decrypt_error);
 
+    // Encrypting within a larger buffer gives the same result:
+    ustring buf(5 + message1.size() + config::ENCRYPT_DATA_OVERHEAD + 5, 'x');
+    std::memcpy(buf.data() + 5, message1.data(), message1.size());
+    config::encrypt_inplace(buf.data() + 5, message1.size(), key1, "test-suite1");
+    CHECK(to_hex(buf.substr(5, enc1.size())) == to_hex(enc1));
+    CHECK(buf.substr(0, 5) == "xxxxx"_bytes);
+    CHECK(buf.substr(5 + enc1.size()) == "xxxxx"_bytes);
+
     enc1[3] = '\x42';
     CHECK_THROWS_AS(config::decrypt(enc1, key1, "test-suite1"), config::decrypt_error);
 }
@@ -79,3 +89,211 @@ TEST_CASE("config message padding", "[config][padding]") {
             75_kiB - 24);  // Coincides with max message size
     CHECK(true);
 }
+
+TEST_CASE("config message batch decryption", "[config][encrypt][decrypt_many]") {
+    auto key1 = "abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789"_hexbytes;
+    auto key2 = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"_hexbytes;
+
+    auto msg1 = "message one"_bytes;
+    auto msg2 = "message two"_bytes;
+    auto padded2 = msg2;
+    config::pad_message(padded2);
+    REQUIRE(padded2.size() > msg2.size());
+
+    auto enc1 = config::encrypt(msg1, key1, "test-suite1");
+    auto enc2 = config::encrypt(padded2, key2, "test-suite1");
+    auto enc3 = config::encrypt(msg1, key1, "test-suite2");
+
+    ustring arena;
+    auto results = config::decrypt_many(
+            {enc1, enc2, enc3, "short"_bytes}, {key1, key2}, "test-suite1", arena);
+    REQUIRE(results.size() == 4);
+    CHECK(results[0]);
+    CHECK(results[0].key == 0);
+    CHECK(results[0].plaintext == msg1);
+    CHECK(results[1].key == 1);
+    CHECK(results[1].plaintext == msg2);  // padding stripped
+    CHECK_FALSE(results[2]);
+    CHECK(results[2].plaintext.empty());
+    CHECK_FALSE(results[3]);
+
+    // The plaintexts are views into the arena:
+    CHECK(results[0].plaintext.data() >= arena.data());
+    CHECK(results[1].plaintext.data() + results[1].plaintext.size() <=
+          arena.data() + arena.size());
+
+    CHECK(config::decrypt_many({enc1}, {key2}, "test-suite1", arena)[0].key == -1);
+}
+
+TEST_CASE("config message derived key cache", "[config][encrypt][key_cache]") {
+    auto key1 = "abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789"_hexbytes;
+    auto key2 = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"_hexbytes;
+    auto message1 = "some message 1"_bytes;
+    auto enc1 = config::encrypt(message1, key1, "test-suite1");
+
+    config::derived_key_cache cache{2};
+    CHECK(cache.size() == 0);
+
+    // Encrypting via the cache gives the same result:
+    ustring buf = message1;
+    buf.resize(message1.size() + config::ENCRYPT_DATA_OVERHEAD);
+    config::encrypt_inplace(buf.data(), message1.size(), key1, "test-suite1", &cache, 0);
+    CHECK(to_hex(buf) == to_hex(enc1));
+    CHECK(cache.size() == 1);
+
+    // ... and the same derived key gets reused to decrypt it:
+    ustring arena;
+    auto res = config::decrypt_many({enc1}, {key1}, "test-suite1", arena, &cache);
+    CHECK(res[0].plaintext == message1);
+    CHECK(cache.size() == 1);
+
+    // Different sizes and domains are different derived keys:
+    auto padded = message1;
+    config::pad_message(padded);
+    auto enc2 = config::encrypt(padded, key1, "test-suite1");
+    auto enc3 = config::encrypt(message1, key1, "test-suite2");
+    res = config::decrypt_many({enc2}, {key1}, "test-suite1", arena, &cache);
+    CHECK(res[0].plaintext == message1);
+    CHECK(cache.size() == 2);
+
+    // Full, so this evicts the least recently used (the first):
+    res = config::decrypt_many({enc3}, {key1}, "test-suite2", arena, &cache);
+    CHECK(res[0].plaintext == message1);
+    CHECK(cache.size() == 2);
+    res = config::decrypt_many({enc1, enc2}, {key1}, "test-suite1", arena, &cache);
+    CHECK(res[0].plaintext == message1);
+    CHECK(res[1].plaintext == message1);
+
+    // The ids are the key indices, so changing the keys requires clearing the cache:
+    cache.clear();
+    CHECK(cache.size() == 0);
+    res = config::decrypt_many({enc1}, {key2, key1}, "test-suite1", arena, &cache);
+    CHECK(res[0].key == 1);
+    CHECK(cache.size() == 2);
+
+    CHECK_THROWS_AS(cache.get(5, key1.substr(0, 31), 100, "test-suite1"), std::invalid_argument);
+}
+
+TEST_CASE("config message batch encryption", "[config][encrypt][batch]") {
+    auto key1 = "abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789"_hexbytes;
+    auto key2 = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"_hexbytes;
+
+    std::vector<ustring> plain, batch;
+    std::vector<ustring_view> keys;
+    for (int i = 0; i < 300; i++) {
+        plain.emplace_back(to_usv("message " + std::to_string(i) + std::string(i, 'x')));
+        keys.push_back(i % 2 ? key1 : key2);
+    }
+
+    for (size_t threads : {1, 4, 0}) {
+        INFO("threads = " << threads);
+        batch = plain;
+        config::encrypt_batch(batch, keys, "test-suite1", threads);
+        bool all_match = true;
+        for (size_t i = 0; i < plain.size(); i++)
+            all_match = all_match && batch[i] == config::encrypt(plain[i], keys[i], "test-suite1");
+        CHECK(all_match);
+
+        batch[7][3] ^= 0x42;
+        auto ok = config::decrypt_batch(batch, keys, "test-suite1", threads);
+        REQUIRE(ok.size() == plain.size());
+        for (size_t i = 0; i < plain.size(); i++) {
+            CHECK(ok[i] == (i != 7));
+            CHECK(batch[i] == (i != 7 ? plain[i] : ustring{}));
+        }
+    }
+
+    // A single key for everything:
+    batch = plain;
+    config::encrypt_batch(batch, {key1}, "test-suite2");
+    CHECK(batch[5] == config::encrypt(plain[5], key1, "test-suite2"));
+    auto ok = config::decrypt_batch(batch, {key2}, "test-suite2");
+    CHECK(std::count(ok.begin(), ok.end(), true) == 0);
+    CHECK(batch[5].empty());
+
+    // Invalid input throws without modifying anything:
+    batch = plain;
+    CHECK_THROWS_AS(
+            config::encrypt_batch(batch, {key1, key2}, "test-suite1"), std::invalid_argument);
+    CHECK_THROWS_AS(
+            config::encrypt_batch(batch, {key1.substr(1)}, "test-suite1"), std::invalid_argument);
+    CHECK_THROWS_AS(config::encrypt_batch(batch, {key1}, ""), std::invalid_argument);
+    CHECK(batch == plain);
+}
+
+TEST_CASE("config message streaming encryption", "[config][encrypt][stream]") {
+    auto key1 = "abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789"_hexbytes;
+
+    ustring big;
+    for (int i = 0; big.size() < 300'000; i++)
+        big += to_usv("line " + std::to_string(i) + " of a large config message\n");
+    auto expected = config::encrypt(big, key1, "test-suite1");
+
+    for (size_t chunk : {1, 63, 64, 65, 1000, 4096, 300'000}) {
+        INFO("chunk size " << chunk);
+        // Encrypting from a large input with a small chunk size is slow, so only do the small
+        // chunks on a prefix of the data:
+        ustring_view data{big};
+        if (chunk < 64)
+            data = data.substr(0, 5000);
+        auto exp = chunk < 64 ? config::encrypt(data, key1, "test-suite1") : expected;
+
+        config::stream_encryptor enc{key1, "test-suite1"};
+        // The hashing pass doesn't have to use the same chunks:
+        for (size_t i = 0; i < data.size(); i += 777)
+            enc.hash(data.substr(i, 777));
+        ustring out;
+        for (size_t i = 0; i < data.size(); i += chunk)
+            out += enc.encrypt(data.substr(i, chunk));
+        out += enc.finish();
+        CHECK(out == exp);
+
+        config::stream_decryptor dec{
+                key1, "test-suite1", out.size(), ustring_view{out}.substr(out.size() - 40)};
+        ustring_view ct = ustring_view{out}.substr(0, out.size() - 40);
+        ustring plain;
+        for (size_t i = 0; i < ct.size(); i += chunk)
+            plain += dec.decrypt(ct.substr(i, chunk));
+        CHECK_NOTHROW(dec.finish());
+        CHECK(plain == data);
+    }
+
+    // Tampered data fails authentication:
+    {
+        auto bad = expected;
+        bad[12345] ^= 0x01;
+        config::stream_decryptor dec{
+                key1, "test-suite1", bad.size(), ustring_view{bad}.substr(bad.size() - 40)};
+        dec.decrypt(ustring_view{bad}.substr(0, bad.size() - 40));
+        CHECK_THROWS_AS(dec.finish(), config::decrypt_error);
+    }
+    // As does incomplete data, or too much data:
+    {
+        config::stream_decryptor dec{
+                key1,
+                "test-suite1",
+                expected.size(),
+                ustring_view{expected}.substr(expected.size() - 40)};
+        dec.decrypt(ustring_view{expected}.substr(0, 1000));
+        CHECK_THROWS_AS(dec.finish(), config::decrypt_error);
+        CHECK_THROWS_AS(dec.decrypt(expected), config::decrypt_error);
+    }
+
+    // Encrypting different data than was hashed is refused:
+    {
+        config::stream_encryptor enc{key1, "test-suite1"};
+        enc.hash("hello"_bytes);
+        enc.encrypt("jello"_bytes);
+        CHECK_THROWS_AS(enc.finish(), std::logic_error);
+        CHECK_THROWS_AS(enc.hash("more"_bytes), std::logic_error);
+    }
+
+    // Empty messages work too:
+    config::stream_encryptor enc{key1, "test-suite1"};
+    CHECK(enc.finish() == config::encrypt(ustring{}, key1, "test-suite1"));
+
+    CHECK_THROWS_AS(config::stream_encryptor(key1, ""), std::invalid_argument);
+    CHECK_THROWS_AS(
+            config::stream_decryptor(key1, "test-suite1", 39, ustring(40, 0)),
+            config::decrypt_error);
+}
@@ -2,12 +2,20 @@
 #include <sodium.h>
 #include <sodium/crypto_sign_ed25519.h>
 
+#include <algorithm>
+#include <atomic>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "session/xed25519.h"
 #include "session/xed25519.hpp"
 
 using session::xed25519::ustring_view;
+using namespace std::literals;
 
 constexpr std::array<unsigned char, 64> seed1{
         0xfe, 0xcd, 0x9a, 0x60, 0x34, 0xbc, 0x9a, 0xba, 0x27, 0x39, 0x25, 0xde, 0xe7,
@@ -132,6 +140,269 @@ TEST_CASE("XEd25519 verification", "[xed25519][verify]") {
     REQUIRE(view_hex(xed_sig1b) != view_hex(xed_sig1));
 }
 
+TEST_CASE("XEd25519 signer", "[xed25519][sign][signer]") {
+    std::array<unsigned char, 32> xsk1;
+    int rc = crypto_sign_ed25519_sk_to_curve25519(xsk1.data(), seed1.data());
+    REQUIRE(rc == 0);
+
+    std::array<unsigned char, 32> xsk2;
+    rc = crypto_sign_ed25519_sk_to_curve25519(xsk2.data(), seed2.data());
+    REQUIRE(rc == 0);
+
+    const auto msg = view("hello world");
+
+    session::xed25519::signer signer1{view(xsk1)};
+    session::xed25519::signer signer2{view(xsk2)};
+    CHECK(view_hex(signer1.ed25519_pubkey()) == oxenc::to_hex(pub1));
+    CHECK(view_hex(signer2.ed25519_pubkey()) == view_hex(pub2_abs));
+
+    for (int i = 0; i < 3; i++) {
+        auto sig1 = signer1.sign(msg);
+        auto sig2 = signer2.sign(msg);
+        CHECK(session::xed25519::verify(view(sig1), view(xpub1), msg));
+        CHECK(session::xed25519::verify(view(sig2), view(xpub2), msg));
+        CHECK(0 == crypto_sign_ed25519_verify_detached(
+                           sig2.data(), msg.data(), msg.size(), pub2_abs.data()));
+        CHECK_FALSE(session::xed25519::verify(view(sig1), view(xpub2), msg));
+    }
+
+    auto sig_str = signer1.sign("hello world"sv);
+    std::string_view xpub1_str{reinterpret_cast<const char*>(xpub1.data()), xpub1.size()};
+    CHECK(session::xed25519::verify(sig_str, xpub1_str, "hello world"sv));
+
+    CHECK_THROWS_AS(session::xed25519::signer{view(xsk1).substr(1)}, std::invalid_argument);
+}
+
+TEST_CASE("XEd25519 signer (C wrapper)", "[xed25519][sign][signer][c]") {
+    std::array<unsigned char, 32> xsk2;
+    int rc = crypto_sign_ed25519_sk_to_curve25519(xsk2.data(), seed2.data());
+    REQUIRE(rc == 0);
+
+    const auto msg = view("hello world");
+
+    auto* signer = session_xed25519_signer_new(xsk2.data());
+    REQUIRE(signer);
+    std::array<unsigned char, 32> edpk;
+    session_xed25519_signer_pubkey(signer, edpk.data());
+    CHECK(view_hex(edpk) == view_hex(pub2_abs));
+
+    std::array<unsigned char, 64> sig;
+    rc = session_xed25519_signer_sign(signer, sig.data(), msg.data(), msg.size());
+    REQUIRE(rc == 0);
+    session_xed25519_signer_free(signer);
+
+    rc = session_xed25519_verify(sig.data(), xpub2.data(), msg.data(), msg.size());
+    CHECK(rc == 0);
+}
+
+TEST_CASE("XEd25519 batch verification", "[xed25519][verify][batch]") {
+    // Signers with a mix of positive and negative Ed25519 pubkeys; each signs several messages so
+    // that the batch contains both repeated and distinct pubkeys.
+    std::vector<std::array<unsigned char, 32>> xsks(5), xpks(5);
+    for (size_t k = 0; k < xsks.size(); k++) {
+        std::array<unsigned char, 32> edpk;
+        std::array<unsigned char, 64> edsk;
+        crypto_sign_ed25519_keypair(edpk.data(), edsk.data());
+        REQUIRE(0 == crypto_sign_ed25519_sk_to_curve25519(xsks[k].data(), edsk.data()));
+        REQUIRE(0 == crypto_sign_ed25519_pk_to_curve25519(xpks[k].data(), edpk.data()));
+    }
+
+    std::vector<std::string> msgs;
+    std::vector<std::array<unsigned char, 64>> sigs;
+    std::vector<session::xed25519::verify_item> items;
+    for (int i = 0; i < 20; i++)
+        msgs.push_back("message " + std::to_string(i));
+    for (size_t i = 0; i < msgs.size(); i++)
+        sigs.push_back(session::xed25519::sign(view(xsks[i % 5]), view(msgs[i])));
+    for (size_t i = 0; i < msgs.size(); i++)
+        items.push_back({view(sigs[i]), view(xpks[i % 5]), view(msgs[i])});
+
+    auto result = session::xed25519::verify_batch(items);
+    REQUIRE(result.size() == items.size());
+    CHECK(std::count(result.begin(), result.end(), true) == 20);
+
+    // Break a few of them in different ways: a corrupted signature, a wrong message, a wrong
+    // pubkey, and a short signature.
+    auto bad_sig = sigs[3];
+    bad_sig[10] ^= 0x01;
+    items[3].signature = view(bad_sig);
+    items[7].msg = view(msgs[8]);
+    items[11].curve25519_pubkey = view(xpks[2]);
+    items[16].signature = view(sigs[16]).substr(0, 63);
+
+    result = session::xed25519::verify_batch(items);
+    for (size_t i = 0; i < items.size(); i++) {
+        INFO("item " << i);
+        bool expected = i != 3 && i != 7 && i != 11 && i != 16;
+        CHECK(result[i] == expected);
+        if (i != 16)
+            CHECK(result[i] ==
+                  session::xed25519::verify(
+                          items[i].signature, items[i].curve25519_pubkey, items[i].msg));
+    }
+
+    CHECK(session::xed25519::verify_batch(std::vector<session::xed25519::verify_item>{}).empty());
+
+    // A pubkey of u = -1 (which has no Ed25519 equivalent) fails, but mustn't affect the others:
+    std::array<unsigned char, 32> minus_one;
+    minus_one.fill(0xff);
+    minus_one[0] = 0xec;
+    minus_one[31] = 0x7f;
+    items[3] = {view(sigs[3]), view(minus_one), view(msgs[3])};
+    result = session::xed25519::verify_batch(items);
+    CHECK_FALSE(result[3]);
+    CHECK(result[0]);
+    CHECK(result[19]);
+
+    // Single-pubkey version:
+    std::vector<std::pair<ustring_view, ustring_view>> data_sigs;
+    for (size_t i = 1; i < msgs.size(); i += 5)
+        data_sigs.emplace_back(view(msgs[i]), view(sigs[i]));
+    data_sigs.emplace_back(view(msgs[0]), view(sigs[0]));  // Signed by a different key
+    result = session::xed25519::verify_batch(view(xpks[1]), data_sigs);
+    CHECK(result == std::vector<bool>{true, true, true, true, false});
+    CHECK_THROWS_AS(
+            session::xed25519::verify_batch(view(xpks[1]).substr(1), data_sigs),
+            std::invalid_argument);
+}
+
+TEST_CASE("XEd25519 batch verification (C wrapper)", "[xed25519][verify][batch][c]") {
+    std::array<unsigned char, 32> xsk1, xsk2;
+    REQUIRE(0 == crypto_sign_ed25519_sk_to_curve25519(xsk1.data(), seed1.data()));
+    REQUIRE(0 == crypto_sign_ed25519_sk_to_curve25519(xsk2.data(), seed2.data()));
+
+    const auto msg1 = view("hello world");
+    const auto msg2 = view("goodbye world");
+    auto sig1 = session::xed25519::sign(view(xsk1), msg1);
+    auto sig2 = session::xed25519::sign(view(xsk2), msg2);
+
+    const unsigned char* sigs[] = {sig1.data(), sig2.data(), sig1.data()};
+    const unsigned char* pubkeys[] = {xpub1.data(), xpub2.data(), xpub2.data()};
+    const unsigned char* msgs[] = {msg1.data(), msg2.data(), msg1.data()};
+    const size_t lens[] = {msg1.size(), msg2.size(), msg1.size()};
+    unsigned char results[3];
+
+    CHECK(session_xed25519_verify_batch(results, sigs, pubkeys, msgs, lens, 2) == 0);
+    CHECK(results[0] == 1);
+    CHECK(results[1] == 1);
+    CHECK(session_xed25519_verify_batch(nullptr, sigs, pubkeys, msgs, lens, 2) == 0);
+
+    CHECK(session_xed25519_verify_batch(results, sigs, pubkeys, msgs, lens, 3) != 0);
+    CHECK(results[0] == 1);
+    CHECK(results[1] == 1);
+    CHECK(results[2] == 0);
+}
+
+TEST_CASE("XEd25519 verifier", "[xed25519][verify][verifier]") {
+    std::array<unsigned char, 32> xsk1, xsk2;
+    REQUIRE(0 == crypto_sign_ed25519_sk_to_curve25519(xsk1.data(), seed1.data()));
+    REQUIRE(0 == crypto_sign_ed25519_sk_to_curve25519(xsk2.data(), seed2.data()));
+
+    const auto msg = view("hello world");
+    auto sig1 = session::xed25519::sign(view(xsk1), msg);
+    auto sig2 = session::xed25519::sign(view(xsk2), msg);
+
+    session::xed25519::verifier verifier1{view(xpub1)};
+    session::xed25519::verifier verifier2{view(xpub2)};
+    CHECK(oxenc::to_hex(view(verifier1.ed25519_pubkey())) == oxenc::to_hex(pub1));
+    CHECK(view_hex(verifier2.ed25519_pubkey()) == view_hex(pub2_abs));
+
+    CHECK(verifier1.verify(view(sig1), msg));
+    CHECK(verifier2.verify(view(sig2), msg));
+    CHECK_FALSE(verifier1.verify(view(sig2), msg));
+    CHECK_FALSE(verifier2.verify(view(sig2), view("hello World")));
+    CHECK_FALSE(verifier2.verify(view(sig2).substr(1), msg));
+
+    // Usable as a ConfigMessage::verify_callable:
+    std::function<bool(ustring_view data, ustring_view signature)> verify_callable = verifier2;
+    CHECK(verify_callable(msg, view(sig2)));
+    CHECK_FALSE(verify_callable(msg, view(sig1)));
+
+    CHECK(verifier2.verify_batch({{msg, view(sig2)}, {msg, view(sig1)}}) ==
+          std::vector<bool>{true, false});
+
+    CHECK_THROWS_AS(session::xed25519::verifier{view(xpub1).substr(1)}, std::invalid_argument);
+}
+
+TEST_CASE("XEd25519 verifier (C wrapper)", "[xed25519][verify][verifier][c]") {
+    std::array<unsigned char, 32> xsk2;
+    REQUIRE(0 == crypto_sign_ed25519_sk_to_curve25519(xsk2.data(), seed2.data()));
+
+    const auto msg = view("hello world");
+    auto sig = session::xed25519::sign(view(xsk2), msg);
+
+    auto* verifier = session_xed25519_verifier_new(xpub2.data());
+    REQUIRE(verifier);
+    CHECK(session_xed25519_verifier_verify(verifier, sig.data(), msg.data(), msg.size()) == 0);
+    sig[0] ^= 0x80;
+    CHECK(session_xed25519_verifier_verify(verifier, sig.data(), msg.data(), msg.size()) != 0);
+    session_xed25519_verifier_free(verifier);
+}
+
+TEST_CASE("XEd25519 pubkey conversion cache", "[xed25519][pubkey][cache]") {
+    // Convert more distinct pubkeys than the cache holds, twice over, so that we go through both
+    // cache hits and evictions; every conversion has to match the (sign-stripped) actual pubkey.
+    const size_t n = session::xed25519::PUBKEY_CACHE_SIZE + 10;
+    std::vector<std::array<unsigned char, 32>> edpks(n), xpks(n);
+    for (size_t i = 0; i < n; i++) {
+        std::array<unsigned char, 64> edsk;
+        crypto_sign_ed25519_keypair(edpks[i].data(), edsk.data());
+        edpks[i][31] &= 0x7f;
+        REQUIRE(0 == crypto_sign_ed25519_pk_to_curve25519(xpks[i].data(), edpks[i].data()));
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < n; i++)
+            CHECK(session::xed25519::pubkey(view(xpks[i])) == edpks[i]);
+        for (size_t i = n; i-- > 0;)
+            CHECK(session::xed25519::pubkey(view(xpks[i])) == edpks[i]);
+    }
+
+    // Concurrent verification (and thus cache access) from several threads, each using a mix of
+    // the same few pubkeys along with ones of its own:
+    std::array<unsigned char, 32> xsk1, xsk2;
+    REQUIRE(0 == crypto_sign_ed25519_sk_to_curve25519(xsk1.data(), seed1.data()));
+    REQUIRE(0 == crypto_sign_ed25519_sk_to_curve25519(xsk2.data(), seed2.data()));
+    const auto msg = view("hello world");
+    auto sig1 = session::xed25519::sign(view(xsk1), msg);
+    auto sig2 = session::xed25519::sign(view(xsk2), msg);
+
+    std::atomic<int> good{0}, bad{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            for (size_t i = 0; i < 200; i++) {
+                bool ok = session::xed25519::verify(view(sig1), view(xpub1), msg) &&
+                          session::xed25519::verify(view(sig2), view(xpub2), msg) &&
+                          !session::xed25519::verify(view(sig1), view(xpub2), msg) &&
+                          session::xed25519::pubkey(view(xpks[(t * 200 + i) % n])) ==
+                                  edpks[(t * 200 + i) % n];
+                (ok ? good : bad)++;
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    CHECK(good == 800);
+    CHECK(bad == 0);
+}
+
+TEST_CASE("XEd25519 signing benchmark", "[.][benchmark][xed25519][sign]") {
+    std::array<unsigned char, 32> xsk1;
+    int rc = crypto_sign_ed25519_sk_to_curve25519(xsk1.data(), seed1.data());
+    REQUIRE(rc == 0);
+
+    const auto msg = view("a config message of a fairly typical size, signed by a group admin");
+    session::xed25519::signer signer{view(xsk1)};
+
+    // Catch2 reports the mean time per signature; signatures/sec is the reciprocal.
+    BENCHMARK("xed25519::sign") {
+        return session::xed25519::sign(view(xsk1), msg);
+    };
+    BENCHMARK("xed25519::signer::sign") {
+        return signer.sign(msg);
+    };
+}
+
 TEST_CASE("XEd25519 pubkey conversion (C wrapper)", "[xed25519][pubkey][c]") {
     auto xed1 = session::xed25519::pubkey(view(xpub1));
     REQUIRE(view_hex(xed1) == oxenc::to_hex(pub1));